@@ -4,7 +4,7 @@ set -e -v
 
 CC32="i686-pc-mingw32-gcc -mwin32 -shared -I include"
 CC64="x86_64-w64-mingw32-gcc -shared -I include"
-SOURCES="src/lsx_sha256.c src/lsx_twofish.c src/lsx_bzero.c src/lualsx.c -Wl,src/lualsx.def"
+SOURCES="src/lsx_sha256.c src/lsx_sha256_x86.c src/lsx_sha256_fixed.c src/lsx_sha256_tree.c src/lsx_sha256_merkle.c src/lsx_sha256_pieces.c src/lsx_sha256_file.c src/lsx_sha256_cdc.c src/lsx_sha512.c src/lsx_hmac_sha256.c src/lsx_pbkdf2.c src/lsx_hkdf_sha256.c src/lsx_codec.c src/lsx_codec_x86.c src/lsx_cpu.c src/lsx_twofish.c src/lsx_twofish_x86.c src/lsx_bzero.c src/lsx_thread.c src/lsx_io.c src/lualsx.c -Wl,src/lualsx.def"
 
 $CC32 -Os $SOURCES -o winbin/lsx.3251.dll \
 winbin/lua-5.1.5_Win32_dllw4_lib/lua5.1.dll \
@@ -7,6 +7,39 @@ extern "C" {
 
 #include <stdlib.h> /* for size_t */
 #include <stdint.h> /* for uintX_t */
+/* One buffer of scatter/gather input. Where there's a POSIX `struct iovec`,
+   this is it; elsewhere, it's a struct of our own with the same layout. */
+#ifdef _WIN32
+typedef struct lsx_iovec {
+  void* iov_base;
+  size_t iov_len;
+} lsx_iovec;
+#else
+#include <sys/uio.h> /* for struct iovec */
+typedef struct iovec lsx_iovec;
+#endif
+
+/* The most threads any function in this library will use at once */
+#define LSX_MAX_THREADS 64
+
+/* Sanitization policies. Under the SECRET policy, every temporary that held
+   message data or state (message schedules, padding buffers, contexts inside
+   one-shot functions) is wiped with `lsx_explicit_bzero` before it goes out
+   of scope. Under the PUBLIC policy, those wipes are skipped, which makes
+   short messages noticeably cheaper to hash; use it only for data that isn't
+   secret (content addressing, checksums of public files...). Contexts you
+   own are never wiped behind your back either way; that's still what the
+   destroy functions are for.
+   Keyed constructions (HMAC, HKDF, PBKDF2) and Twofish always use SECRET.
+   `LSX_DEFAULT_POLICY` is what new contexts and the plain one-shot functions
+   use. Define it when compiling the library to change it.
+   SECRET is zero, so a context that was zeroed instead of set up fails
+   safe. */
+#define LSX_POLICY_SECRET 0
+#define LSX_POLICY_PUBLIC 1
+#ifndef LSX_DEFAULT_POLICY
+#define LSX_DEFAULT_POLICY LSX_POLICY_SECRET
+#endif
 
 /* Why is this not present on all OSes? */
 extern void lsx_explicit_bzero(void* p, size_t n);
@@ -23,6 +56,44 @@ extern void lsx_get_random(void* p, size_t n);
    Caveat user. */
 extern void lsx_get_extremely_random(void* p, size_t n);
 
+/*** HEX AND BASE64 ***/
+
+/* Text encodings for digests, keys, and anything else binary. Hex output is
+   lowercase. Base64 is the standard alphabet from RFC 4648, with `=`
+   padding. Encoders write exactly this many characters, with no terminating
+   NUL: */
+#define LSX_HEX_CHARS(bytes) ((bytes) * 2)
+#define LSX_BASE64_CHARS(bytes) (((bytes) + 2) / 3 * 4)
+extern void lsx_hex_encode(const void* in, size_t bytes, char* out);
+extern void lsx_base64_encode(const void* in, size_t bytes, char* out);
+/* Decoders return the number of bytes written to `out`, or (size_t)-1 if `in`
+   isn't valid, in which case `out` may have been partly written. Hex may be
+   in either case, and must have an even length. Base64 must be padded, with
+   no whitespace, and unused bits in the last group must be zero. At most
+   `chars` / 2 (hex) or `chars` / 4 * 3 (base64) bytes are written. */
+extern size_t lsx_hex_decode(const char* in, size_t chars, void* out);
+extern size_t lsx_base64_decode(const char* in, size_t chars, void* out);
+/* Encode `count` items of `bytes` bytes each, stored one after another (such
+   as an array of digests), into `count` strings of `LSX_HEX_CHARS(bytes)` or
+   `LSX_BASE64_CHARS(bytes)` characters each, also one after another. */
+#define lsx_hex_encode_many(in, bytes, count, out) \
+  lsx_hex_encode(in, (bytes) * (count), out)
+extern void lsx_base64_encode_many(const void* in, size_t bytes, size_t count,
+                                   char* out);
+/* By default, the fastest implementation this CPU supports is chosen the
+   first time it's needed. You only need these if you're testing or
+   benchmarking them. */
+#define LSX_CODEC_IMPL_AUTO 0
+/* Portable C */
+#define LSX_CODEC_IMPL_SCALAR 1
+/* x86 SSSE3, 16 bytes at a time */
+#define LSX_CODEC_IMPL_SSSE3 2
+/* x86 AVX2, 32 bytes at a time */
+#define LSX_CODEC_IMPL_AVX2 3
+/* As with `lsx_set_sha256_implementation` */
+extern int lsx_set_codec_implementation(int impl);
+extern int lsx_get_codec_implementation(void);
+
 /*** TWOFISH ***/
 
 /* Defines for people to use if they're nice */
@@ -73,6 +144,61 @@ extern void lsx_decrypt_twofish(lsx_twofish_context* ctx,
 #define lsx_decrypt_twofish192 lsx_decrypt_twofish
 #define lsx_decrypt_twofish256 lsx_decrypt_twofish
 
+/* Modes of operation, many blocks per call. In all of them, `in` and `out`
+   may point to the same memory, but must not otherwise overlap. */
+/* Encrypt/decrypt `blocks` blocks, each on its own. (You probably want one of
+   the other modes; see the README.) */
+extern void lsx_twofish_ecb_encrypt(lsx_twofish_context* ctx,
+                                    const void* in, void* out, size_t blocks);
+extern void lsx_twofish_ecb_decrypt(lsx_twofish_context* ctx,
+                                    const void* in, void* out, size_t blocks);
+/* Encrypt/decrypt `blocks` blocks in CBC mode. On return, `iv` holds the last
+   ciphertext block, so that a message may be processed in several calls. */
+extern void lsx_twofish_cbc_encrypt(lsx_twofish_context* ctx,
+                                    uint8_t iv[TWOFISH_BLOCKBYTES],
+                                    const void* in, void* out, size_t blocks);
+extern void lsx_twofish_cbc_decrypt(lsx_twofish_context* ctx,
+                                    uint8_t iv[TWOFISH_BLOCKBYTES],
+                                    const void* in, void* out, size_t blocks);
+/* Encrypt OR decrypt `bytes` bytes (any number) in CTR mode. The counter
+   block for the Nth block of the stream is `nonce` + N, as 128-bit big-endian
+   integers. `counter` is the number of the block that `in` starts with; to
+   continue a message in another call, pass the number of whole blocks done so
+   far. */
+extern void lsx_twofish_ctr_xor(lsx_twofish_context* ctx,
+                                const uint8_t nonce[TWOFISH_BLOCKBYTES],
+                                uint64_t counter, const void* in, void* out,
+                                size_t bytes);
+/* The same, with up to `threads` threads (counting the calling thread; 0
+   means 1) sharing the work. The message is split into spans of
+   `min_span_bytes` (rounded up to whole blocks; 0 means
+   `LSX_TWOFISH_CTR_SPAN_BYTES`), and each thread takes one span at a time.
+   A message no longer than one span is done entirely on the calling thread,
+   so small messages never wait on other threads. The output is exactly what
+   `lsx_twofish_ctr_xor` gives, whatever `threads` and `min_span_bytes`
+   are. */
+#define LSX_TWOFISH_CTR_SPAN_BYTES (256 * 1024)
+extern void lsx_twofish_ctr_xor_parallel(lsx_twofish_context* ctx,
+                                         const uint8_t
+                                         nonce[TWOFISH_BLOCKBYTES],
+                                         uint64_t counter, const void* in,
+                                         void* out, size_t bytes,
+                                         unsigned threads,
+                                         size_t min_span_bytes);
+/* The implementation behind the modes above that can work on many blocks at
+   once (ECB, CBC decryption, and CTR). You only need these if you're testing
+   or benchmarking them. */
+#define LSX_TWOFISH_IMPL_AUTO 0
+/* Portable C, four blocks at a time; the default */
+#define LSX_TWOFISH_IMPL_SCALAR 1
+/* x86 AVX2 gathers, eight blocks at a time; never chosen automatically */
+#define LSX_TWOFISH_IMPL_AVX2 2
+/* x86 AVX-512 gathers, sixteen blocks at a time; never chosen automatically */
+#define LSX_TWOFISH_IMPL_AVX512 3
+/* As with `lsx_set_sha256_implementation` */
+extern int lsx_set_twofish_implementation(int impl);
+extern int lsx_get_twofish_implementation(void);
+
 /* Convenience function to destroy key-dependent data. When you're finished
    with a context, you should either call this on it or re-use it immediately
    for a different key. */
@@ -99,9 +225,14 @@ extern void lsx_decrypt_twofish(lsx_twofish_context* ctx,
 typedef struct lsx_sha256_expert_context {
   uint32_t h[8];
   uint64_t bytes_so_far;
+  /* LSX_POLICY_SECRET or LSX_POLICY_PUBLIC */
+  int policy;
 } lsx_sha256_expert_context;
-/* Set up the initial state */
+/* Set up the initial state, with the default policy */
 extern void lsx_setup_sha256_expert(lsx_sha256_expert_context* ctx);
+/* Change the sanitization policy of a context that has been set up (setup,
+   and import, go back to `LSX_DEFAULT_POLICY`) */
+#define lsx_set_sha256_expert_policy(ctx, p) ((ctx)->policy = (p))
 /* Add complete blocks of message data
    (number of bytes = `SHA256_BLOCKBYTES` * `blocks`) */
 extern void lsx_input_sha256_expert(lsx_sha256_expert_context* ctx,
@@ -115,7 +246,7 @@ extern void lsx_finish_sha256_expert(lsx_sha256_expert_context* ctx,
 /* Convenience function to destroy any remaining important data. */
 /* destroy is the backwards-compatible name for this function */
 #define lsx_destroy_sha256_expert(ctx) lsx_explicit_bzero(ctx, sizeof(*(ctx)))
-#define lsx_sanitize_sha256_expert lua_destroy_sha256_expert
+#define lsx_sanitize_sha256_expert lsx_destroy_sha256_expert
 
 /* This is the easy interface. It's a thin layer on the above. If all you want
    to do is hash a complete message in memory, there's an even easier interface
@@ -125,11 +256,22 @@ typedef struct lsx_sha256_context {
   uint8_t buf[SHA256_BLOCKBYTES];
   unsigned int num_buffered_bytes;
 } lsx_sha256_context;
-/* Set up the initial state */
+/* Set up the initial state, with the default policy */
 extern void lsx_setup_sha256(lsx_sha256_context* ctx);
+#define lsx_set_sha256_policy(ctx, p) ((ctx)->expert.policy = (p))
 /* Add message data */
 extern void lsx_input_sha256(lsx_sha256_context* ctx,
                              const void* input, size_t bytes);
+/* Add message data from `cnt` separate buffers, in order. Whole blocks go
+   straight from the buffers to the kernel; only a block that straddles two
+   buffers is assembled in `ctx->buf`. */
+extern void lsx_input_sha256v(lsx_sha256_context* ctx,
+                              const lsx_iovec* iov, int cnt);
+/* Copy `bytes` from `src` to `dst` and add them to the message, in one pass:
+   each piece is hashed right after it's copied, while it's still in cache.
+   `src` and `dst` must not overlap. */
+extern void lsx_sha256_copy_input(lsx_sha256_context* ctx, void* dst,
+                                  const void* src, size_t bytes);
 /* Calculate the hash.
    This leaves `ctx` in an unusable state. Call `lsx_setup_sha256` on it
    if you want to use it again, or `lsx_destroy_sha256` if you don't. */
@@ -140,11 +282,562 @@ extern void lsx_finish_sha256(lsx_sha256_context* ctx,
 #define lsx_destroy_sha256(ctx) lsx_explicit_bzero(ctx, sizeof(*(ctx)))
 #define lsx_sanitize_sha256 lsx_destroy_sha256
 
+/* Saving and restoring a message in progress. This lets you hash a common
+   prefix once and then fork from it for each message. */
+/* Contexts contain no pointers, so cloning one is a plain copy */
+#define lsx_clone_sha256_expert(dst, src) (*(dst) = *(src))
+#define lsx_clone_sha256(dst, src) (*(dst) = *(src))
+/* The state can also be serialized, to a blob whose format will stay the same
+   across versions and platforms: a four-byte "lsxS" tag, a version byte (1),
+   a kind byte (1 = expert, 2 = easy), the number of buffered bytes, a zero
+   byte, the eight state words and the 64-bit byte count (big-endian), and
+   then (easy only) a 64-byte buffer, zero-padded. An expert context has no
+   buffer, so its blob is shorter. */
+#define LSX_SHA256_EXPERT_STATE_BYTES 48
+#define LSX_SHA256_STATE_BYTES (LSX_SHA256_EXPERT_STATE_BYTES+SHA256_BLOCKBYTES)
+extern void lsx_export_sha256_expert(const lsx_sha256_expert_context* ctx,
+                                     uint8_t
+                                     out[LSX_SHA256_EXPERT_STATE_BYTES]);
+extern void lsx_export_sha256(const lsx_sha256_context* ctx,
+                              uint8_t out[LSX_SHA256_STATE_BYTES]);
+/* Restore a state exported above. Returns nonzero on success, or zero
+   (leaving `ctx` alone) if the blob is not a valid state of the right kind.
+   `lsx_import_sha256` also accepts an expert blob. */
+extern int lsx_import_sha256_expert(lsx_sha256_expert_context* ctx,
+                                    const uint8_t* in, size_t in_bytes);
+extern int lsx_import_sha256(lsx_sha256_context* ctx,
+                             const uint8_t* in, size_t in_bytes);
+
 /* This is the easiest interface. If your message does not already reside
    entirely in memory, or if it is particularly long, please use one of the
    above interfaces instead of reading it all in at once. */
 extern void lsx_calculate_sha256(const void* message, size_t bytes,
                                  uint8_t out[SHA256_HASHBYTES]);
+/* The same, with a given policy instead of the default */
+extern void lsx_calculate_sha256_policy(const void* message, size_t bytes,
+                                        int policy,
+                                        uint8_t out[SHA256_HASHBYTES]);
+
+/* Hash a file, or everything from a file descriptor's current position to
+   its end. Regular files are memory mapped, with a hint that they'll be read
+   sequentially. Anything else (pipes, sockets...) is read in big chunks by
+   a second thread, while the calling thread hashes the previous chunk.
+   Returns zero, with errno set, if the file couldn't be opened or read.
+   A mapped file that is truncated while it's being hashed crashes the
+   program (SIGBUS); define LSX_NO_MMAP when compiling to always read. */
+extern int lsx_sha256_fd(int fd, uint8_t out[SHA256_HASHBYTES]);
+extern int lsx_sha256_file(const char* path, uint8_t out[SHA256_HASHBYTES]);
+
+/* Hash `count` independent messages. `msgs[n]` points to `lens[n]` bytes of
+   message, and its hash is written to `out[n]`. Where the CPU allows, several
+   messages are hashed at once in parallel SIMD lanes, which is much faster
+   than calling `lsx_calculate_sha256` on each one when there are lots of
+   short messages. Lengths can be mixed freely. Uses the default policy. */
+extern void lsx_calculate_sha256_many(const void* const msgs[],
+                                      const size_t lens[], size_t count,
+                                      uint8_t (*out)[SHA256_HASHBYTES]);
+/* The same, with a given policy instead of the default */
+extern void lsx_calculate_sha256_many_policy(const void* const msgs[],
+                                             const size_t lens[],
+                                             size_t count, int policy,
+                                             uint8_t (*out)[SHA256_HASHBYTES]);
+
+/* Fixed-length shortcuts, for Merkle trees and hash chains. These skip the
+   buffering and padding logic of the functions above. */
+/* Hash exactly 64 bytes (say, two child digests) down to 32 */
+extern void lsx_sha256_64to32(const uint8_t in[SHA256_BLOCKBYTES],
+                              uint8_t out[SHA256_HASHBYTES]);
+/* The same, for `count` independent inputs, several at a time in parallel
+   SIMD lanes where the CPU allows. `in` and `out` may overlap only if they
+   are the same array, e.g. one level of a tree hashed in place. */
+extern void lsx_sha256_64to32_many(const uint8_t (*in)[SHA256_BLOCKBYTES],
+                                   uint8_t (*out)[SHA256_HASHBYTES],
+                                   size_t count);
+/* Hash a 32-byte seed, then hash the result, `n` times in all. With `n` = 0,
+   `out` is a copy of `seed`. */
+extern void lsx_sha256_iterate(const uint8_t seed[SHA256_HASHBYTES],
+                               uint64_t n, uint8_t out[SHA256_HASHBYTES]);
+/* The same for `count` independent chains of the same length, several at a
+   time in parallel SIMD lanes where the CPU allows */
+extern void lsx_sha256_iterate_many(const uint8_t (*seeds)[SHA256_HASHBYTES],
+                                    size_t count, uint64_t n,
+                                    uint8_t (*out)[SHA256_HASHBYTES]);
+
+/* Tree hashing. This is NOT SHA-256, and its digests never match SHA-256
+   digests: it's a different hash, built from SHA-256, whose work can be spread
+   across threads. The message is split into `leaf_bytes`-byte leaves, each
+   leaf is hashed with SHA-256, the leaf digests are combined pairwise into a
+   Merkle tree, and the root is hashed once more together with `leaf_bytes`
+   and the message length. The exact format is in README.md.
+   Up to `threads` threads (counting the calling thread; 0 means 1) share the
+   work. The digest depends on `leaf_bytes`, but never on `threads`. Returns
+   zero (writing nothing) if `leaf_bytes` is zero. Leaves of 64KiB or more
+   keep the threads busy with very little overhead. */
+extern int lsx_calculate_sha256_tree(const void* message, size_t bytes,
+                                     size_t leaf_bytes, unsigned threads,
+                                     uint8_t out[SHA256_HASHBYTES]);
+/* The same, with a given policy instead of the default */
+extern int lsx_calculate_sha256_tree_policy(const void* message, size_t bytes,
+                                            size_t leaf_bytes,
+                                            unsigned threads, int policy,
+                                            uint8_t out[SHA256_HASHBYTES]);
+
+/* The single-message functions above share one compression kernel. By
+   default, the fastest one this CPU supports is chosen the first time any
+   SHA-256 function is called. You only need these if you're testing or
+   benchmarking the kernels. */
+#define LSX_SHA256_IMPL_AUTO 0
+/* Portable C, the original implementation */
+#define LSX_SHA256_IMPL_SCALAR 1
+/* x86 SHA extensions */
+#define LSX_SHA256_IMPL_SHANI 2
+/* x86 SSSE3 message schedule, one block at a time */
+#define LSX_SHA256_IMPL_SSSE3 3
+/* x86 AVX2 message schedule, two blocks at a time */
+#define LSX_SHA256_IMPL_AVX2 4
+/* Portable C, unrolled; the default where there's nothing better */
+#define LSX_SHA256_IMPL_UNROLLED 5
+/* Force a particular kernel (or go back to automatic selection). Returns
+   nonzero on success, or zero (changing nothing) if this build or this CPU
+   can't run the requested kernel. Not thread safe; call it before any other
+   thread might be hashing. */
+extern int lsx_set_sha256_implementation(int impl);
+/* Returns the kernel that is (or will be) in use. Never returns AUTO. */
+extern int lsx_get_sha256_implementation(void);
+/* The same, for the kernel used by `lsx_calculate_sha256_many` */
+#define LSX_SHA256_MANY_AUTO 0
+/* One message at a time, using the kernel chosen above */
+#define LSX_SHA256_MANY_SERIAL 1
+/* x86 SSE2, four messages at a time */
+#define LSX_SHA256_MANY_SSE2 2
+/* x86 AVX2, eight messages at a time */
+#define LSX_SHA256_MANY_AVX2 3
+extern int lsx_set_sha256_many_implementation(int impl);
+extern int lsx_get_sha256_many_implementation(void);
+
+/*** SHA-256 PIECES ***/
+
+/* Plain SHA-256 digests of every `piece_bytes`-byte piece of a file or
+   buffer, as BitTorrent-style distribution wants. The last piece may be
+   short; an empty buffer has no pieces. */
+#define lsx_sha256_count_pieces(bytes, piece_bytes) \
+  ((bytes) / (piece_bytes) + ((bytes) % (piece_bytes) != 0))
+/* Hash all of `buf`'s pieces, writing piece `n`'s digest to `out[n]`. Several
+   pieces are hashed at once in SIMD lanes where the CPU allows, and up to
+   `threads` threads (counting the calling thread; 0 means 1) share the
+   work. Returns zero (writing nothing) if `piece_bytes` is zero. */
+extern int lsx_sha256_pieces(const void* buf, size_t bytes, size_t piece_bytes,
+                             unsigned threads,
+                             uint8_t (*out)[SHA256_HASHBYTES]);
+/* The same, with a given policy instead of the default */
+extern int lsx_sha256_pieces_policy(const void* buf, size_t bytes,
+                                    size_t piece_bytes, unsigned threads,
+                                    int policy,
+                                    uint8_t (*out)[SHA256_HASHBYTES]);
+/* The same, reading from file descriptor `fd` until end of file. `buf` is
+   scratch space of `buf_bytes` bytes, at least one piece; the more pieces it
+   holds, the more can be hashed at once. At most `max_pieces` digests are
+   written. Returns the number of pieces, or (size_t)-1 if `read` failed,
+   there were more than `max_pieces` pieces, or `buf` is too small. */
+extern size_t lsx_sha256_pieces_fd(int fd, size_t piece_bytes,
+                                   unsigned threads,
+                                   void* buf, size_t buf_bytes,
+                                   uint8_t (*out)[SHA256_HASHBYTES],
+                                   size_t max_pieces);
+
+/* For pieces that turn up one at a time, in any order (a download, say).
+   The digests and a bit per piece saying which are done live in memory you
+   provide, so they can be saved and the job resumed later. */
+typedef struct lsx_sha256_pieces_context {
+  uint8_t (*digests)[SHA256_HASHBYTES];
+  uint8_t* done;
+  uint64_t bytes;
+  size_t piece_bytes, pieces;
+  /* how many pieces haven't been hashed yet */
+  size_t remaining;
+  /* LSX_POLICY_SECRET or LSX_POLICY_PUBLIC */
+  int policy;
+} lsx_sha256_pieces_context;
+/* How big `done` has to be */
+#define LSX_SHA256_PIECES_DONE_BYTES(pieces) (((pieces) + 7) / 8)
+/* Start on an object of `bytes` bytes, with nothing done. `digests` has room
+   for every piece's digest. Returns zero if `piece_bytes` is zero or there
+   are too many pieces to address. */
+extern int lsx_setup_sha256_pieces(lsx_sha256_pieces_context* ctx,
+                                   uint8_t (*digests)[SHA256_HASHBYTES],
+                                   uint8_t* done, uint64_t bytes,
+                                   size_t piece_bytes);
+/* The same, but pick up where an earlier context left off: `digests` and
+   `done` hold what it had when it was saved. */
+extern int lsx_resume_sha256_pieces(lsx_sha256_pieces_context* ctx,
+                                    uint8_t (*digests)[SHA256_HASHBYTES],
+                                    uint8_t* done, uint64_t bytes,
+                                    size_t piece_bytes);
+/* The length of piece `index` (only the last one is ever short), or 0 if
+   there is no such piece */
+extern size_t lsx_sha256_piece_bytes(const lsx_sha256_pieces_context* ctx,
+                                     size_t index);
+/* Hash piece `index`, whose contents are at `data`, and mark it done. A
+   piece can be hashed again. Returns zero if there's no such piece or
+   `bytes` isn't its length. */
+extern int lsx_input_sha256_piece(lsx_sha256_pieces_context* ctx,
+                                  size_t index, const void* data,
+                                  size_t bytes);
+/* Hash `count` pieces at once, in SIMD lanes where the CPU allows. Piece
+   `indices[n]` is at `data[n]`, and must be whole. Returns how many pieces
+   were hashed; bad ones are skipped. */
+extern size_t lsx_input_sha256_pieces(lsx_sha256_pieces_context* ctx,
+                                      const size_t indices[],
+                                      const void* const data[], size_t count);
+#define lsx_sha256_piece_done(ctx, index) \
+  (((ctx)->done[(index) >> 3] >> ((index) & 7)) & 1)
+/* Change the sanitization policy, after setup (setup, and resume, go back to
+   `LSX_DEFAULT_POLICY`) */
+#define lsx_set_sha256_pieces_policy(ctx, p) ((ctx)->policy = (p))
+
+/*** SHA-256 CONTENT-DEFINED CHUNKING ***/
+
+/* Splits a stream into chunks wherever its content says to (FastCDC, with a
+   Gear rolling hash), and gives the SHA-256 digest of each chunk, in one
+   pass. Boundaries depend only on the bytes near them, so an insertion or
+   deletion only changes the chunks around it; that's what deduplicating
+   backups want. */
+typedef struct lsx_sha256_cdc_chunk {
+  /* where it starts in the stream */
+  uint64_t offset;
+  size_t bytes;
+  uint8_t digest[SHA256_HASHBYTES];
+} lsx_sha256_cdc_chunk;
+/* Receives chunks, `count` at a time, in order */
+typedef void (*lsx_sha256_cdc_func)(void* arg,
+                                    const lsx_sha256_cdc_chunk* chunks,
+                                    size_t count);
+typedef struct lsx_sha256_cdc {
+  /* the part of the chunk in progress that earlier calls were given */
+  lsx_sha256_context partial;
+  /* where that chunk starts, and how much of it there is so far */
+  uint64_t offset;
+  size_t pending;
+  uint64_t gear, mask_small, mask_large;
+  size_t min_bytes, avg_bytes, max_bytes;
+  lsx_sha256_cdc_func emit;
+  void* arg;
+} lsx_sha256_cdc;
+/* Chunks will be between `min_bytes` and `max_bytes` long (except maybe the
+   last), and about `avg_bytes` on average; the average is rounded down to a
+   power of two. Finished chunks go to `emit(arg, ...)`. Returns zero unless
+   0 < `min_bytes` <= `avg_bytes` <= `max_bytes`. */
+extern int lsx_setup_sha256_cdc(lsx_sha256_cdc* ctx, size_t min_bytes,
+                                size_t avg_bytes, size_t max_bytes,
+                                lsx_sha256_cdc_func emit, void* arg);
+/* Feed the stream in, in pieces of any size. Chunks that end within one
+   call are hashed several at once, in SIMD lanes where the CPU allows, so
+   bigger calls are faster. */
+extern void lsx_input_sha256_cdc(lsx_sha256_cdc* ctx, const void* data,
+                                 size_t bytes);
+/* Feed in everything from a file descriptor, read a megabyte at a time on
+   a second thread. Returns zero, with errno set, if reading failed. */
+extern int lsx_input_sha256_cdc_fd(lsx_sha256_cdc* ctx, int fd);
+/* Emit the last chunk. The context is then unusable until it's set up
+   again. */
+extern void lsx_finish_sha256_cdc(lsx_sha256_cdc* ctx);
+#define lsx_destroy_sha256_cdc(ctx) lsx_explicit_bzero(ctx, sizeof(*(ctx)))
+/* Change the sanitization policy, after setup (setup goes back to
+   `LSX_DEFAULT_POLICY`). It's kept in `partial`, and covers every chunk. */
+#define lsx_set_sha256_cdc_policy(ctx, p) \
+  lsx_set_sha256_policy(&(ctx)->partial, p)
+#define lsx_sha256_cdc_policy(ctx) ((ctx)->partial.expert.policy)
+
+/*** SHA-256 MERKLE TREES ***/
+
+/* A Merkle tree over an object (a file, a disk image...) split into
+   `chunk_bytes`-byte chunks, for keeping the object's digest up to date
+   without rehashing all of it after every write. Mark the chunks you change,
+   and `lsx_sha256_merkle_commit` rehashes only those and their ancestors.
+   The digest is the same as `lsx_calculate_sha256_tree` of the whole object
+   with `leaf_bytes` = `chunk_bytes`; like that, it is NOT SHA-256.
+   The nodes are stored level by level, leaves first, in memory you provide;
+   the two children of a node are always adjacent. */
+typedef struct lsx_sha256_merkle {
+  uint8_t* storage;
+  uint64_t object_bytes;
+  size_t chunk_bytes, chunks, nodes;
+  /* how many nodes are marked for rehashing */
+  size_t marked;
+} lsx_sha256_merkle;
+/* How much storage a tree needs, or 0 if `chunk_bytes` is zero or there are
+   too many chunks to address. This is roughly 2 * 32.125 bytes per chunk. */
+extern size_t lsx_sha256_merkle_storage_bytes(uint64_t object_bytes,
+                                              size_t chunk_bytes);
+/* Set up a tree in `storage`, which must stay valid as long as the tree is in
+   use. Every chunk starts out marked, so the first commit hashes the whole
+   object. Returns zero if `storage_bytes` is too small or `chunk_bytes` is
+   zero. An empty object has one empty chunk. */
+extern int lsx_setup_sha256_merkle(lsx_sha256_merkle* tree, void* storage,
+                                   size_t storage_bytes,
+                                   uint64_t object_bytes, size_t chunk_bytes);
+/* Mark chunk `index` as changed. Returns zero if there's no such chunk. */
+extern int lsx_sha256_merkle_touch(lsx_sha256_merkle* tree, size_t index);
+/* Mark every chunk that overlaps `bytes` bytes at `offset` in the object.
+   Returns zero (marking nothing) if the range goes past the end. */
+extern int lsx_sha256_merkle_touch_range(lsx_sha256_merkle* tree,
+                                         uint64_t offset, uint64_t bytes);
+/* Supplies the current contents of chunk `index` to a commit: returns a
+   pointer to its `bytes` bytes (only the last chunk is ever short), which
+   only has to stay valid until the next call. Returning NULL stops the
+   commit. */
+typedef const void* (*lsx_sha256_merkle_read_func)(void* arg, size_t index,
+                                                   size_t bytes);
+/* Rehash the marked chunks, then every node above them. If `read` is NULL,
+   `arg` instead points to the whole object in memory. Returns zero if `read`
+   returned NULL; the chunks hashed so far stay hashed, and the rest stay
+   marked for the next commit. */
+extern int lsx_sha256_merkle_commit(lsx_sha256_merkle* tree,
+                                    lsx_sha256_merkle_read_func read,
+                                    void* arg);
+/* The object's digest, as of the last commit. Returns zero (writing
+   nothing) if there are marked chunks that haven't been committed. */
+extern int lsx_sha256_merkle_digest(const lsx_sha256_merkle* tree,
+                                    uint8_t out[SHA256_HASHBYTES]);
+/* Save a tree, marks and all, so that it can be loaded later instead of
+   rehashing the object. The blob is portable between platforms. */
+#define LSX_SHA256_MERKLE_HEADER_BYTES 24
+extern size_t lsx_sha256_merkle_export_bytes(const lsx_sha256_merkle* tree);
+extern void lsx_sha256_merkle_export(const lsx_sha256_merkle* tree,
+                                     uint8_t* out);
+/* Load a saved tree into `storage`, as `lsx_setup_sha256_merkle` would set
+   it up. Returns zero if the blob is malformed or `storage` is too small.
+   The nodes are taken on trust; nothing is rehashed. */
+extern int lsx_sha256_merkle_import(lsx_sha256_merkle* tree, void* storage,
+                                    size_t storage_bytes,
+                                    const uint8_t* in, size_t in_bytes);
+
+/* Inclusion proofs, for checking part of an object against its digest
+   without the rest of the object. A proof for a run of chunks is the
+   sibling nodes needed to climb from those chunks to the root, at most two
+   per level. */
+#define LSX_SHA256_MERKLE_MAX_PROOF_BYTES (2 * 64 * SHA256_HASHBYTES)
+/* Write the proof for the `count` chunks starting at chunk `first` to `out`
+   (which must have room for LSX_SHA256_MERKLE_MAX_PROOF_BYTES), and its
+   length to `*out_bytes`. Returns zero if the range is empty or past the
+   end, or if there are uncommitted changes. */
+extern int lsx_sha256_merkle_prove(const lsx_sha256_merkle* tree,
+                                   size_t first, size_t count,
+                                   uint8_t* out, size_t* out_bytes);
+/* Check `data_bytes` bytes of `data`, the contents of one or more whole
+   chunks starting at chunk `first`, against `digest`, the digest of an
+   object of `object_bytes` bytes split into `chunk_bytes`-byte chunks.
+   Only the given chunks and the proof are hashed. Returns nonzero if they
+   match. */
+extern int lsx_sha256_merkle_verify(const uint8_t digest[SHA256_HASHBYTES],
+                                    uint64_t object_bytes, size_t chunk_bytes,
+                                    size_t first, const void* data,
+                                    size_t data_bytes, const uint8_t* proof,
+                                    size_t proof_bytes);
+
+/*** HMAC-SHA256 ***/
+
+/* A key, prepared for use. This holds the SHA-256 states left after hashing
+   the ipad and opad blocks, so each MAC only has to hash the message itself
+   (plus one block for the outer hash). It's as sensitive as the key. */
+typedef struct lsx_hmac_sha256_key {
+  lsx_sha256_expert_context inner, outer;
+} lsx_hmac_sha256_key;
+/* Prepare a key. Keys longer than `SHA256_BLOCKBYTES` are hashed first, as
+   HMAC requires. */
+extern void lsx_setup_hmac_sha256_key(lsx_hmac_sha256_key* key,
+                                      const void* key_data, size_t key_bytes);
+#define lsx_destroy_hmac_sha256_key(key) lsx_explicit_bzero(key, sizeof(*(key)))
+#define lsx_sanitize_hmac_sha256_key lsx_destroy_hmac_sha256_key
+
+/* One message in progress. Set up from a prepared key, which is not
+   modified and can be shared by any number of messages. */
+typedef struct lsx_hmac_sha256_context {
+  lsx_sha256_context inner;
+  lsx_sha256_expert_context outer;
+} lsx_hmac_sha256_context;
+extern void lsx_setup_hmac_sha256(lsx_hmac_sha256_context* ctx,
+                                  const lsx_hmac_sha256_key* key);
+extern void lsx_input_hmac_sha256(lsx_hmac_sha256_context* ctx,
+                                  const void* input, size_t bytes);
+/* Calculate the MAC.
+   This leaves `ctx` in an unusable state. Call `lsx_setup_hmac_sha256` on it
+   if you want to use it again, or `lsx_destroy_hmac_sha256` if you don't. */
+extern void lsx_finish_hmac_sha256(lsx_hmac_sha256_context* ctx,
+                                   uint8_t out[SHA256_HASHBYTES]);
+#define lsx_destroy_hmac_sha256(ctx) lsx_explicit_bzero(ctx, sizeof(*(ctx)))
+#define lsx_sanitize_hmac_sha256 lsx_destroy_hmac_sha256
+
+/* MAC a message that's entirely in memory */
+extern void lsx_calculate_hmac_sha256(const lsx_hmac_sha256_key* key,
+                                      const void* message, size_t bytes,
+                                      uint8_t out[SHA256_HASHBYTES]);
+/* Compute the MAC of a message and compare it against `mac`, in constant
+   time. Returns nonzero if they match. */
+extern int lsx_verify_hmac_sha256(const lsx_hmac_sha256_key* key,
+                                  const void* message, size_t bytes,
+                                  const uint8_t mac[SHA256_HASHBYTES]);
+
+/*** PBKDF2-HMAC-SHA256 ***/
+
+/* Derive `out_bytes` bytes of key from a password and salt, as in RFC 8018.
+   An `iterations` of 0 is treated as 1. Where the CPU allows, the 32-byte
+   output blocks are computed in parallel SIMD lanes. */
+extern void lsx_pbkdf2_hmac_sha256(const void* password, size_t password_bytes,
+                                   const void* salt, size_t salt_bytes,
+                                   uint32_t iterations,
+                                   uint8_t* out, size_t out_bytes);
+/* Derive a 32-byte key from each of `count` (password, salt) pairs, all with
+   the same iteration count. Several pairs are worked on at once in parallel
+   SIMD lanes, which is much faster than one at a time. */
+extern void lsx_pbkdf2_hmac_sha256_many(const void* const passwords[],
+                                        const size_t password_lens[],
+                                        const void* const salts[],
+                                        const size_t salt_lens[],
+                                        size_t count, uint32_t iterations,
+                                        uint8_t (*out)[SHA256_HASHBYTES]);
+/* As above, but compare each derived key against `expected[n]` (in constant
+   time) instead of returning it. `results[n]` is set nonzero for each pair
+   that matches, and the number of matches is returned. */
+extern size_t lsx_verify_pbkdf2_hmac_sha256_many(const void* const passwords[],
+                                                 const size_t password_lens[],
+                                                 const void* const salts[],
+                                                 const size_t salt_lens[],
+                                                 size_t count,
+                                                 uint32_t iterations,
+                                                 const uint8_t
+                                                 (*expected)[SHA256_HASHBYTES],
+                                                 int results[]);
+
+/*** HKDF-SHA256 ***/
+
+/* The pseudorandom key produced by the extract step (RFC 5869), kept as a
+   prepared HMAC key so every expand can start from its midstates. It's as
+   sensitive as the keying material it came from. */
+#define lsx_hkdf_sha256_prk lsx_hmac_sha256_key
+#define lsx_destroy_hkdf_sha256_prk lsx_destroy_hmac_sha256_key
+#define lsx_sanitize_hkdf_sha256_prk lsx_destroy_hmac_sha256_key
+/* The most that one expand can produce */
+#define LSX_HKDF_SHA256_MAX_BYTES (255 * SHA256_HASHBYTES)
+/* Extract a PRK from input keying material. `salt` may be NULL with
+   `salt_bytes` = 0. */
+extern void lsx_hkdf_sha256_extract(lsx_hkdf_sha256_prk* prk,
+                                    const void* salt, size_t salt_bytes,
+                                    const void* ikm, size_t ikm_bytes);
+/* If you already have a PRK (say, from another implementation), prepare it
+   with this instead of extracting one. */
+#define lsx_hkdf_sha256_setup_prk lsx_setup_hmac_sha256_key
+/* Expand the PRK into `out_bytes` of keying material for the purpose named
+   by `info`, which may be NULL with `info_bytes` = 0. The PRK isn't
+   modified, so it can be expanded any number of times. Returns zero (writing
+   nothing) if `out_bytes` is more than `LSX_HKDF_SHA256_MAX_BYTES`, nonzero
+   otherwise. */
+extern int lsx_hkdf_sha256_expand(const lsx_hkdf_sha256_prk* prk,
+                                  const void* info, size_t info_bytes,
+                                  uint8_t* out, size_t out_bytes);
+/* Expand a 16, 24, or 32 byte key and set up a Twofish context with it,
+   without the key passing through your buffers. Returns zero (doing nothing)
+   if `key_bytes` isn't a valid Twofish key length. */
+extern int lsx_hkdf_sha256_expand_twofish(const lsx_hkdf_sha256_prk* prk,
+                                          const void* info, size_t info_bytes,
+                                          lsx_twofish_context* twofish,
+                                          size_t key_bytes);
+
+/*** SHA-512 ***/
+
+/* SHA-512, and its truncated variants SHA-384 and SHA-512/256, all share one
+   set of contexts and functions; only the setup differs. On 64-bit machines,
+   they're faster per byte than SHA-256. */
+#define SHA512_HASHBYTES 64
+#define SHA384_HASHBYTES 48
+#define SHA512_256_HASHBYTES 32
+#define SHA512_BLOCKBYTES 128
+#define SHA384_BLOCKBYTES SHA512_BLOCKBYTES
+#define SHA512_256_BLOCKBYTES SHA512_BLOCKBYTES
+
+/* The "expert" interface, as for SHA-256 */
+typedef struct lsx_sha512_expert_context {
+  uint64_t h[8];
+  uint64_t bytes_so_far;
+  /* how many bytes `finish` will output; this is what tells the variants
+     apart once they've been set up */
+  unsigned int hash_bytes;
+  /* LSX_POLICY_SECRET or LSX_POLICY_PUBLIC */
+  int policy;
+} lsx_sha512_expert_context;
+#define lsx_sha384_expert_context lsx_sha512_expert_context
+#define lsx_sha512_256_expert_context lsx_sha512_expert_context
+/* Set up the initial state for the desired variant, with the default
+   policy */
+extern void lsx_setup_sha512_expert(lsx_sha512_expert_context* ctx);
+extern void lsx_setup_sha384_expert(lsx_sha512_expert_context* ctx);
+extern void lsx_setup_sha512_256_expert(lsx_sha512_expert_context* ctx);
+/* Change the sanitization policy, after setup */
+#define lsx_set_sha512_expert_policy(ctx, p) ((ctx)->policy = (p))
+/* Add complete blocks of message data
+   (number of bytes = `SHA512_BLOCKBYTES` * `blocks`) */
+extern void lsx_input_sha512_expert(lsx_sha512_expert_context* ctx,
+                                    const void* input, size_t blocks);
+#define lsx_input_sha384_expert lsx_input_sha512_expert
+#define lsx_input_sha512_256_expert lsx_input_sha512_expert
+/* Add any remaining data and compute the hash. Writes `SHA512_HASHBYTES`,
+   `SHA384_HASHBYTES`, or `SHA512_256_HASHBYTES` bytes to `out`, depending on
+   which variant `ctx` was set up for.
+   This leaves `ctx` in an unusable state. Call a setup function on it if you
+   want to use it again, or `lsx_destroy_sha512_expert` if you don't. */
+extern void lsx_finish_sha512_expert(lsx_sha512_expert_context* ctx,
+                                     const void* input, size_t bytes,
+                                     uint8_t* out);
+#define lsx_finish_sha384_expert lsx_finish_sha512_expert
+#define lsx_finish_sha512_256_expert lsx_finish_sha512_expert
+/* Convenience function to destroy any remaining important data. */
+#define lsx_destroy_sha512_expert(ctx) lsx_explicit_bzero(ctx, sizeof(*(ctx)))
+#define lsx_sanitize_sha512_expert lsx_destroy_sha512_expert
+#define lsx_destroy_sha384_expert lsx_destroy_sha512_expert
+#define lsx_sanitize_sha384_expert lsx_destroy_sha512_expert
+#define lsx_destroy_sha512_256_expert lsx_destroy_sha512_expert
+#define lsx_sanitize_sha512_256_expert lsx_destroy_sha512_expert
+
+/* The easy interface, as for SHA-256 */
+typedef struct lsx_sha512_context {
+  lsx_sha512_expert_context expert;
+  uint8_t buf[SHA512_BLOCKBYTES];
+  unsigned int num_buffered_bytes;
+} lsx_sha512_context;
+#define lsx_sha384_context lsx_sha512_context
+#define lsx_sha512_256_context lsx_sha512_context
+/* Set up the initial state for the desired variant, with the default
+   policy */
+extern void lsx_setup_sha512(lsx_sha512_context* ctx);
+extern void lsx_setup_sha384(lsx_sha512_context* ctx);
+extern void lsx_setup_sha512_256(lsx_sha512_context* ctx);
+#define lsx_set_sha512_policy(ctx, p) ((ctx)->expert.policy = (p))
+/* Add message data */
+extern void lsx_input_sha512(lsx_sha512_context* ctx,
+                             const void* input, size_t bytes);
+#define lsx_input_sha384 lsx_input_sha512
+#define lsx_input_sha512_256 lsx_input_sha512
+/* Calculate the hash, writing as many bytes as the variant calls for.
+   This leaves `ctx` in an unusable state. Call a setup function on it if you
+   want to use it again, or `lsx_destroy_sha512` if you don't. */
+extern void lsx_finish_sha512(lsx_sha512_context* ctx, uint8_t* out);
+#define lsx_finish_sha384 lsx_finish_sha512
+#define lsx_finish_sha512_256 lsx_finish_sha512
+/* Convenience function to destroy any remaining important data. */
+#define lsx_destroy_sha512(ctx) lsx_explicit_bzero(ctx, sizeof(*(ctx)))
+#define lsx_sanitize_sha512 lsx_destroy_sha512
+#define lsx_destroy_sha384 lsx_destroy_sha512
+#define lsx_sanitize_sha384 lsx_destroy_sha512
+#define lsx_destroy_sha512_256 lsx_destroy_sha512
+#define lsx_sanitize_sha512_256 lsx_destroy_sha512
+
+/* The easiest interface */
+extern void lsx_calculate_sha512(const void* message, size_t bytes,
+                                 uint8_t out[SHA512_HASHBYTES]);
+extern void lsx_calculate_sha384(const void* message, size_t bytes,
+                                 uint8_t out[SHA384_HASHBYTES]);
+extern void lsx_calculate_sha512_256(const void* message, size_t bytes,
+                                     uint8_t out[SHA512_256_HASHBYTES]);
 
 #ifdef __cplusplus
 }
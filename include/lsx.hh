@@ -5,7 +5,80 @@
 
 #include "lsx.h"
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 202002L
+#include <span>
+#define LSX_HAVE_SPAN 1
+#endif
+
+#if __cplusplus >= 201402L
+#include <array>
+#include <utility>
+#define LSX_HAVE_CONSTEXPR_SHA256 1
+#endif
+
 namespace lsx {
+  class hkdf_sha256;
+  /*** HEX AND BASE64 ***/
+  /* Thin wrappers around `lsx_hex_*` and `lsx_base64_*`; see lsx.h. The
+     `std::string` forms allocate, the others write to your buffer. */
+  namespace hex {
+    constexpr size_t chars(size_t bytes) {
+      return LSX_HEX_CHARS(bytes);
+    }
+    inline void encode(const void* in, size_t bytes, char* out) {
+      lsx_hex_encode(in, bytes, out);
+    }
+    inline void encode_many(const void* in, size_t bytes, size_t count,
+                            char* out) {
+      lsx_hex_encode_many(in, bytes, count, out);
+    }
+    inline std::string encode(const void* in, size_t bytes) {
+      std::string ret(chars(bytes), '\0');
+      if(bytes) lsx_hex_encode(in, bytes, &ret[0]);
+      return ret;
+    }
+    /* Returns the number of bytes written, or (size_t)-1 if `in` is bad */
+    inline size_t decode(const char* in, size_t chars, void* out) {
+      return lsx_hex_decode(in, chars, out);
+    }
+    /* Returns false, leaving `out` empty, if `in` is bad */
+    inline bool decode(const std::string& in, std::vector<uint8_t>& out) {
+      out.resize(in.size() / 2 + 1);
+      size_t bytes = lsx_hex_decode(in.data(), in.size(), out.data());
+      out.resize(bytes == (size_t)-1 ? 0 : bytes);
+      return bytes != (size_t)-1;
+    }
+  }
+  namespace base64 {
+    constexpr size_t chars(size_t bytes) {
+      return LSX_BASE64_CHARS(bytes);
+    }
+    inline void encode(const void* in, size_t bytes, char* out) {
+      lsx_base64_encode(in, bytes, out);
+    }
+    inline void encode_many(const void* in, size_t bytes, size_t count,
+                            char* out) {
+      lsx_base64_encode_many(in, bytes, count, out);
+    }
+    inline std::string encode(const void* in, size_t bytes) {
+      std::string ret(chars(bytes), '\0');
+      if(bytes) lsx_base64_encode(in, bytes, &ret[0]);
+      return ret;
+    }
+    inline size_t decode(const char* in, size_t chars, void* out) {
+      return lsx_base64_decode(in, chars, out);
+    }
+    inline bool decode(const std::string& in, std::vector<uint8_t>& out) {
+      out.resize(in.size() / 4 * 3 + 1);
+      size_t bytes = lsx_base64_decode(in.data(), in.size(), out.data());
+      out.resize(bytes == (size_t)-1 ? 0 : bytes);
+      return bytes != (size_t)-1;
+    }
+  }
   /*** TWOFISH ***/
   /* All variants of Twofish are identical except for the key schedule.
      There are two ways to use this interface:
@@ -18,6 +91,7 @@ namespace lsx {
      You can explicitly `rekey*()`/`sanitize()` no matter which class you
      instantiate if you really want to. */
   class twofish : protected lsx_twofish_context {
+    friend class hkdf_sha256;
   protected:
     inline twofish() {}
   public:
@@ -33,6 +107,40 @@ namespace lsx {
       lsx_decrypt_twofish(this, in, out);
       return *this;
     }
+    /* Many blocks at once; see `lsx_twofish_ecb_encrypt` and friends */
+    inline twofish& ecb_encrypt(const void* in, void* out, size_t blocks) {
+      lsx_twofish_ecb_encrypt(this, in, out, blocks);
+      return *this;
+    }
+    inline twofish& ecb_decrypt(const void* in, void* out, size_t blocks) {
+      lsx_twofish_ecb_decrypt(this, in, out, blocks);
+      return *this;
+    }
+    inline twofish& cbc_encrypt(uint8_t iv[TWOFISH_BLOCKBYTES],
+                                const void* in, void* out, size_t blocks) {
+      lsx_twofish_cbc_encrypt(this, iv, in, out, blocks);
+      return *this;
+    }
+    inline twofish& cbc_decrypt(uint8_t iv[TWOFISH_BLOCKBYTES],
+                                const void* in, void* out, size_t blocks) {
+      lsx_twofish_cbc_decrypt(this, iv, in, out, blocks);
+      return *this;
+    }
+    inline twofish& ctr_xor(const uint8_t nonce[TWOFISH_BLOCKBYTES],
+                            uint64_t counter, const void* in, void* out,
+                            size_t bytes) {
+      lsx_twofish_ctr_xor(this, nonce, counter, in, out, bytes);
+      return *this;
+    }
+    inline twofish& ctr_xor_parallel(const uint8_t nonce[TWOFISH_BLOCKBYTES],
+                                     uint64_t counter, const void* in,
+                                     void* out, size_t bytes,
+                                     unsigned threads,
+                                     size_t min_span_bytes = 0) {
+      lsx_twofish_ctr_xor_parallel(this, nonce, counter, in, out, bytes,
+                                   threads, min_span_bytes);
+      return *this;
+    }
     inline twofish& rekey128(const uint8_t key[TWOFISH128_KEYBYTES]) {
       lsx_setup_twofish128(this, key);
       return *this;
@@ -78,6 +186,81 @@ namespace lsx {
     inline twofish_uninitialized() {}
   };
   /*** SHA-256 ***/
+#if LSX_HAVE_CONSTEXPR_SHA256
+  /* A plain SHA-256 that the compiler can run, behind `sha256::ct_sum`. It's
+     slow, but it only runs while compiling. */
+  namespace ct_sha256 {
+    constexpr uint32_t k[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+      0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+      0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+      0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+      0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+      0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+      0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+      0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+      0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+    /* arrays can't be returned, but structs holding them can */
+    struct state { uint32_t h[8]; };
+    constexpr uint32_t rotr(uint32_t x, unsigned n) {
+      return (x >> n) | (x << (32 - n));
+    }
+    /* byte `i` of the padded message, which is `total` bytes long */
+    constexpr uint8_t padded_byte(const char* message, size_t bytes,
+                                  size_t total, size_t i) {
+      return i < bytes ? static_cast<uint8_t>(message[i])
+        : i == bytes ? 0x80
+        : i >= total - 8
+          ? static_cast<uint8_t>(static_cast<uint64_t>(bytes) * 8
+                                 >> ((total - 1 - i) * 8))
+        : 0;
+    }
+    constexpr state hash(const char* message, size_t bytes) {
+      state st = {{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}};
+      uint32_t w[64] = {};
+      const size_t total = (bytes + 8) / SHA256_BLOCKBYTES * SHA256_BLOCKBYTES
+        + SHA256_BLOCKBYTES;
+      for(size_t block = 0; block < total; block += SHA256_BLOCKBYTES) {
+        for(unsigned i = 0; i < 64; ++i) {
+          if(i < 16) {
+            w[i] = 0;
+            for(unsigned j = 0; j < 4; ++j)
+              w[i] = (w[i] << 8)
+                | padded_byte(message, bytes, total, block + i * 4 + j);
+          }
+          else
+            w[i] = w[i-16] + w[i-7]
+              + (rotr(w[i-15], 7) ^ rotr(w[i-15], 18) ^ (w[i-15] >> 3))
+              + (rotr(w[i-2], 17) ^ rotr(w[i-2], 19) ^ (w[i-2] >> 10));
+        }
+        uint32_t a = st.h[0], b = st.h[1], c = st.h[2], d = st.h[3];
+        uint32_t e = st.h[4], f = st.h[5], g = st.h[6], h = st.h[7];
+        for(unsigned i = 0; i < 64; ++i) {
+          uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25))
+            + ((e & f) ^ (~e & g)) + k[i] + w[i];
+          uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22))
+            + ((a & b) ^ (a & c) ^ (b & c));
+          h = g; g = f; f = e; e = d + t1;
+          d = c; c = b; b = a; a = t1 + t2;
+        }
+        st.h[0] += a; st.h[1] += b; st.h[2] += c; st.h[3] += d;
+        st.h[4] += e; st.h[5] += f; st.h[6] += g; st.h[7] += h;
+      }
+      return st;
+    }
+    /* std::array's non-const operator[] isn't constexpr until C++17, so the
+       digest is built all at once */
+    template<size_t... I>
+    constexpr std::array<uint8_t, SHA256_HASHBYTES>
+    digest(const state& st, std::index_sequence<I...>) {
+      return {{static_cast<uint8_t>(st.h[I / 4] >> (24 - I % 4 * 8))...}};
+    }
+  }
+#endif
   /* "expert" interface: provide all data but the terminating data in blocks */
   class sha256_expert : protected lsx_sha256_expert_context {
   public:
@@ -107,12 +290,31 @@ namespace lsx {
       lsx_setup_sha256_expert(this);
       return *this;
     }
+    /* Change the sanitization policy (`LSX_POLICY_SECRET` or
+       `LSX_POLICY_PUBLIC`) until the next `reinit` */
+    inline sha256_expert& set_policy(int policy) {
+      lsx_set_sha256_expert_policy(this, policy);
+      return *this;
+    }
     /* This is explicitly called by the destructor, so you don't need to call
        it unless the instance will continue existing. */
     inline sha256_expert& sanitize() {
       lsx_destroy_sha256_expert(this);
       return *this;
     }
+    /* Copying an instance forks the message in progress; so does this */
+    inline sha256_expert clone() const { return *this; }
+    static const unsigned state_bytes = LSX_SHA256_EXPERT_STATE_BYTES;
+    /* Serialize the message in progress; see `lsx_export_sha256_expert` */
+    inline const sha256_expert& export_state(uint8_t out[state_bytes]) const {
+      lsx_export_sha256_expert(this, out);
+      return *this;
+    }
+    /* Restore a serialized state. Returns false, changing nothing, if the
+       blob isn't valid. */
+    inline bool import_state(const uint8_t* in, size_t in_bytes) {
+      return lsx_import_sha256_expert(this, in, in_bytes) != 0;
+    }
   };
   /* easy interface; provide message data in any quantities you want */
   class sha256 : protected lsx_sha256_context {
@@ -128,6 +330,37 @@ namespace lsx {
       lsx_input_sha256(this, input, bytes);
       return *this;
     }
+    /* Add message data from several buffers at once */
+    inline sha256& input(const lsx_iovec* iov, int cnt) {
+      lsx_input_sha256v(this, iov, cnt);
+      return *this;
+    }
+#if LSX_HAVE_SPAN
+    inline sha256& input(std::span<const lsx_iovec> iov) {
+      lsx_input_sha256v(this, iov.data(), (int)iov.size());
+      return *this;
+    }
+    inline sha256& input(std::span<const std::span<const uint8_t>> buffers) {
+      /* handed to the C side a handful at a time */
+      lsx_iovec iov[16];
+      int cnt = 0;
+      for(auto& buffer : buffers) {
+        iov[cnt].iov_base = const_cast<uint8_t*>(buffer.data());
+        iov[cnt].iov_len = buffer.size();
+        if(++cnt == 16) {
+          lsx_input_sha256v(this, iov, cnt);
+          cnt = 0;
+        }
+      }
+      if(cnt > 0) lsx_input_sha256v(this, iov, cnt);
+      return *this;
+    }
+#endif
+    /* Copy message data from `src` to `dst`, hashing it along the way */
+    inline sha256& copy_input(void* dst, const void* src, size_t bytes) {
+      lsx_sha256_copy_input(this, dst, src, bytes);
+      return *this;
+    }
     /* Compute the hash.
        This leaves the instance in an unusable state. Call `reinit` on it if
        you want to use it again before destruction. */
@@ -140,18 +373,572 @@ namespace lsx {
       lsx_setup_sha256(this);
       return *this;
     }
+    /* Change the sanitization policy (`LSX_POLICY_SECRET` or
+       `LSX_POLICY_PUBLIC`) until the next `reinit` */
+    inline sha256& set_policy(int policy) {
+      lsx_set_sha256_policy(this, policy);
+      return *this;
+    }
     /* This is explicitly called by the destructor, so you don't need to call
        it unless the instance will continue existing. */
     inline sha256& sanitize() {
       lsx_destroy_sha256(this);
       return *this;
     }
+    /* Copying an instance forks the message in progress; so does this */
+    inline sha256 clone() const { return *this; }
+    static const unsigned state_bytes = LSX_SHA256_STATE_BYTES;
+    /* Serialize the message in progress; see `lsx_export_sha256` */
+    inline const sha256& export_state(uint8_t out[state_bytes]) const {
+      lsx_export_sha256(this, out);
+      return *this;
+    }
+    /* Restore a serialized state. Returns false, changing nothing, if the
+       blob isn't valid. */
+    inline bool import_state(const uint8_t* in, size_t in_bytes) {
+      return lsx_import_sha256(this, in, in_bytes) != 0;
+    }
     /* "lazy" interface; pass in all message data at once */
     static inline void sum(const void* message, size_t bytes,
                            uint8_t out[hash_bytes]) {
       lsx_calculate_sha256(message, bytes, out);
     }
+    static inline void sum(const void* message, size_t bytes,
+                           uint8_t out[hash_bytes], int policy) {
+      lsx_calculate_sha256_policy(message, bytes, policy, out);
+    }
+#if LSX_HAVE_CONSTEXPR_SHA256
+    /* "lazy" interface, at compile time: the same digest `sum` would give,
+       for a string literal (not counting its terminating NUL) or for `bytes`
+       bytes of a constant string. Needs C++14. */
+    static constexpr std::array<uint8_t, hash_bytes>
+    ct_sum(const char* message, size_t bytes) {
+      return ct_sha256::digest(ct_sha256::hash(message, bytes),
+                               std::make_index_sequence<hash_bytes>());
+    }
+    template<size_t N>
+    static constexpr std::array<uint8_t, hash_bytes>
+    ct_sum(const char (&literal)[N]) {
+      return ct_sum(literal, N - 1);
+    }
+#endif
+    /* The first eight bytes of a digest (a raw array, or one from `ct_sum`)
+       as a big-endian integer, for `switch` labels and the like */
+    template<class DIGEST>
+    static constexpr uint64_t digest_prefix64(const DIGEST& digest) {
+      return (uint64_t)digest[0] << 56 | (uint64_t)digest[1] << 48
+        | (uint64_t)digest[2] << 40 | (uint64_t)digest[3] << 32
+        | (uint64_t)digest[4] << 24 | (uint64_t)digest[5] << 16
+        | (uint64_t)digest[6] << 8 | (uint64_t)digest[7];
+    }
+    /* "lazy" interface for a whole file; false, with errno set, if it
+       couldn't be read. See `lsx_sha256_fd`. */
+    static inline bool sum_file(const char* path, uint8_t out[hash_bytes]) {
+      return lsx_sha256_file(path, out) != 0;
+    }
+    static inline bool sum_fd(int fd, uint8_t out[hash_bytes]) {
+      return lsx_sha256_fd(fd, out) != 0;
+    }
+    /* "lazy" interface for lots of independent messages at once; faster than
+       calling `sum` on each one */
+    static inline void sum_many(const void* const messages[],
+                                const size_t bytes[], size_t count,
+                                uint8_t (*out)[hash_bytes]) {
+      lsx_calculate_sha256_many(messages, bytes, count, out);
+    }
+    static inline void sum_many(const void* const messages[],
+                                const size_t bytes[], size_t count,
+                                uint8_t (*out)[hash_bytes], int policy) {
+      lsx_calculate_sha256_many_policy(messages, bytes, count, policy, out);
+    }
+    /* Fixed-length shortcuts for Merkle trees and hash chains; see
+       `lsx_sha256_64to32` and friends */
+    static inline void sum_64to32(const uint8_t in[block_bytes],
+                                  uint8_t out[hash_bytes]) {
+      lsx_sha256_64to32(in, out);
+    }
+    static inline void sum_64to32_many(const uint8_t (*in)[block_bytes],
+                                       uint8_t (*out)[hash_bytes],
+                                       size_t count) {
+      lsx_sha256_64to32_many(in, out, count);
+    }
+    static inline void iterate(const uint8_t seed[hash_bytes], uint64_t n,
+                               uint8_t out[hash_bytes]) {
+      lsx_sha256_iterate(seed, n, out);
+    }
+    static inline void iterate_many(const uint8_t (*seeds)[hash_bytes],
+                                    size_t count, uint64_t n,
+                                    uint8_t (*out)[hash_bytes]) {
+      lsx_sha256_iterate_many(seeds, count, n, out);
+    }
+    /* A tree hash spread over `threads` threads. NOT SHA-256; see
+       `lsx_calculate_sha256_tree`. */
+    static inline bool sum_tree(const void* message, size_t bytes,
+                                size_t leaf_bytes, unsigned threads,
+                                uint8_t out[hash_bytes]) {
+      return lsx_calculate_sha256_tree(message, bytes, leaf_bytes, threads,
+                                       out) != 0;
+    }
+    static inline bool sum_tree(const void* message, size_t bytes,
+                                size_t leaf_bytes, unsigned threads,
+                                uint8_t out[hash_bytes], int policy) {
+      return lsx_calculate_sha256_tree_policy(message, bytes, leaf_bytes,
+                                              threads, policy, out) != 0;
+    }
+    /* Plain digests of fixed-size pieces; see `lsx_sha256_pieces` */
+    static inline bool sum_pieces(const void* buf, size_t bytes,
+                                  size_t piece_bytes, unsigned threads,
+                                  uint8_t (*out)[hash_bytes]) {
+      return lsx_sha256_pieces(buf, bytes, piece_bytes, threads, out) != 0;
+    }
+    static inline bool sum_pieces(const void* buf, size_t bytes,
+                                  size_t piece_bytes, unsigned threads,
+                                  uint8_t (*out)[hash_bytes], int policy) {
+      return lsx_sha256_pieces_policy(buf, bytes, piece_bytes, threads,
+                                      policy, out) != 0;
+    }
+    static inline size_t sum_pieces_fd(int fd, size_t piece_bytes,
+                                       unsigned threads, void* buf,
+                                       size_t buf_bytes,
+                                       uint8_t (*out)[hash_bytes],
+                                       size_t max_pieces) {
+      return lsx_sha256_pieces_fd(fd, piece_bytes, threads, buf, buf_bytes,
+                                  out, max_pieces);
+    }
+  };
+  /*** SHA-256 PIECES ***/
+  /* Pieces hashed as they turn up, in any order, holding its own storage */
+  class sha256_pieces : protected lsx_sha256_pieces_context {
+    std::vector<uint8_t> digest_buffer, done_buffer;
+    inline bool allocate(uint64_t bytes, size_t piece_bytes) {
+      if(piece_bytes == 0) return false;
+      uint64_t count = lsx_sha256_count_pieces(bytes, (uint64_t)piece_bytes);
+      if(count > SIZE_MAX / SHA256_HASHBYTES) return false;
+      digest_buffer.resize((size_t)count * SHA256_HASHBYTES);
+      done_buffer.resize(LSX_SHA256_PIECES_DONE_BYTES((size_t)count));
+      return true;
+    }
+  public:
+    /* a copy's `digests` and `done` would still point at our vectors */
+    sha256_pieces(const sha256_pieces&) = delete;
+    sha256_pieces& operator=(const sha256_pieces&) = delete;
+    static const unsigned hash_bytes = SHA256_HASHBYTES;
+    /* Call `setup` or `resume` before using it */
+    inline sha256_pieces() {
+      digests = NULL;
+      done = NULL;
+      bytes = 0;
+      piece_bytes = pieces = remaining = 0;
+      policy = LSX_DEFAULT_POLICY;
+    }
+    /* False if `piece_bytes` is zero or there are too many pieces */
+    inline bool setup(uint64_t bytes, size_t piece_bytes) {
+      if(!allocate(bytes, piece_bytes)) return false;
+      return lsx_setup_sha256_pieces(this, digests_data(), done_buffer.data(),
+                                     bytes, piece_bytes) != 0;
+    }
+    /* Pick up where an earlier one left off, given its `digests_bytes()`
+       and `done_bytes()` */
+    inline bool resume(uint64_t bytes, size_t piece_bytes,
+                       const uint8_t* saved_digests,
+                       const uint8_t* saved_done) {
+      if(!allocate(bytes, piece_bytes)) return false;
+      std::copy(saved_digests, saved_digests + digest_buffer.size(),
+                digest_buffer.begin());
+      std::copy(saved_done, saved_done + done_buffer.size(),
+                done_buffer.begin());
+      return lsx_resume_sha256_pieces(this, digests_data(),
+                                      done_buffer.data(), bytes,
+                                      piece_bytes) != 0;
+    }
+    /* Change the sanitization policy (`LSX_POLICY_SECRET` or
+       `LSX_POLICY_PUBLIC`) until the next `setup` or `resume` */
+    inline sha256_pieces& set_policy(int policy) {
+      lsx_set_sha256_pieces_policy(this, policy);
+      return *this;
+    }
+    inline bool input(size_t index, const void* data, size_t bytes) {
+      return lsx_input_sha256_piece(this, index, data, bytes) != 0;
+    }
+    inline size_t input(const size_t indices[], const void* const data[],
+                        size_t count) {
+      return lsx_input_sha256_pieces(this, indices, data, count);
+    }
+    inline size_t piece_count() const { return pieces; }
+    inline size_t pieces_remaining() const { return remaining; }
+    inline size_t piece_size(size_t index) const {
+      return lsx_sha256_piece_bytes(this, index);
+    }
+    inline bool is_done(size_t index) const {
+      return index < pieces && lsx_sha256_piece_done(this, index);
+    }
+    /* `piece_count()` digests, one after another */
+    inline const uint8_t* digests_bytes() const {
+      return digest_buffer.data();
+    }
+    /* `LSX_SHA256_PIECES_DONE_BYTES(piece_count())` bytes */
+    inline const uint8_t* done_bytes() const { return done_buffer.data(); }
+  private:
+    inline uint8_t (*digests_data())[SHA256_HASHBYTES] {
+      return reinterpret_cast<uint8_t(*)[SHA256_HASHBYTES]>
+        (digest_buffer.data());
+    }
+  };
+  /*** SHA-256 CONTENT-DEFINED CHUNKING ***/
+  /* See `lsx_setup_sha256_cdc` */
+  class sha256_cdc : protected lsx_sha256_cdc {
+  public:
+    typedef lsx_sha256_cdc_chunk chunk;
+    /* Call `setup` before using it */
+    inline sha256_cdc() { lsx_explicit_bzero(this, sizeof(*this)); }
+    inline ~sha256_cdc() { sanitize(); }
+    /* False unless 0 < `min_bytes` <= `avg_bytes` <= `max_bytes` */
+    inline bool setup(size_t min_bytes, size_t avg_bytes, size_t max_bytes,
+                      lsx_sha256_cdc_func emit, void* arg) {
+      return lsx_setup_sha256_cdc(this, min_bytes, avg_bytes, max_bytes,
+                                  emit, arg) != 0;
+    }
+    /* Change the sanitization policy (`LSX_POLICY_SECRET` or
+       `LSX_POLICY_PUBLIC`) until the next `setup` */
+    inline sha256_cdc& set_policy(int policy) {
+      lsx_set_sha256_cdc_policy(this, policy);
+      return *this;
+    }
+    inline sha256_cdc& input(const void* data, size_t bytes) {
+      lsx_input_sha256_cdc(this, data, bytes);
+      return *this;
+    }
+    /* False, with errno set, if reading failed */
+    inline bool input_fd(int fd) {
+      return lsx_input_sha256_cdc_fd(this, fd) != 0;
+    }
+    /* Emits the last chunk. Call `setup` again before reusing it. */
+    inline sha256_cdc& finish() {
+      lsx_finish_sha256_cdc(this);
+      return *this;
+    }
+    inline sha256_cdc& sanitize() {
+      lsx_destroy_sha256_cdc(this);
+      return *this;
+    }
+  };
+  /*** SHA-256 MERKLE TREES ***/
+  /* An incrementally updated Merkle tree over a large object, holding its own
+     storage. The digest is NOT SHA-256; see `lsx_setup_sha256_merkle`. */
+  class sha256_merkle : protected lsx_sha256_merkle {
+    std::vector<uint8_t> buffer;
+  public:
+    /* `storage` is `buffer.data()`; a copy would go on writing to ours */
+    sha256_merkle(const sha256_merkle&) = delete;
+    sha256_merkle& operator=(const sha256_merkle&) = delete;
+    static const unsigned hash_bytes = SHA256_HASHBYTES;
+    /* Call `setup` or `import_state` before using it */
+    inline sha256_merkle() {
+      storage = NULL;
+      object_bytes = 0;
+      chunk_bytes = chunks = nodes = marked = 0;
+    }
+    /* Start over with every chunk marked. False if `chunk_bytes` is zero or
+       there are too many chunks. */
+    inline bool setup(uint64_t object_bytes, size_t chunk_bytes) {
+      size_t bytes = lsx_sha256_merkle_storage_bytes(object_bytes,
+                                                     chunk_bytes);
+      if(bytes == 0) return false;
+      buffer.resize(bytes);
+      return lsx_setup_sha256_merkle(this, &buffer[0], bytes, object_bytes,
+                                     chunk_bytes) != 0;
+    }
+    /* Mark a chunk, or the chunks overlapping a byte range, as changed */
+    inline bool touch(size_t index) {
+      return lsx_sha256_merkle_touch(this, index) != 0;
+    }
+    inline bool touch_range(uint64_t offset, uint64_t bytes) {
+      return lsx_sha256_merkle_touch_range(this, offset, bytes) != 0;
+    }
+    /* Rehash what's marked; see `lsx_sha256_merkle_commit` */
+    inline bool commit(lsx_sha256_merkle_read_func read, void* arg) {
+      return lsx_sha256_merkle_commit(this, read, arg) != 0;
+    }
+    inline bool commit(const void* object) {
+      return lsx_sha256_merkle_commit(this, NULL, const_cast<void*>(object))
+        != 0;
+    }
+    /* False if there are uncommitted changes */
+    inline bool digest(uint8_t out[hash_bytes]) const {
+      return lsx_sha256_merkle_digest(this, out) != 0;
+    }
+    inline size_t state_bytes() const {
+      return lsx_sha256_merkle_export_bytes(this);
+    }
+    inline const sha256_merkle& export_state(uint8_t* out) const {
+      lsx_sha256_merkle_export(this, out);
+      return *this;
+    }
+    inline bool import_state(const uint8_t* in, size_t in_bytes) {
+      /* the blob is exactly as big as the storage, plus a header */
+      if(in_bytes < LSX_SHA256_MERKLE_HEADER_BYTES) return false;
+      std::vector<uint8_t> loaded(in_bytes - LSX_SHA256_MERKLE_HEADER_BYTES);
+      if(loaded.empty()
+         || !lsx_sha256_merkle_import(this, &loaded[0], loaded.size(), in,
+                                      in_bytes))
+        return false;
+      buffer.swap(loaded);
+      return true;
+    }
+    /* Inclusion proofs; see `lsx_sha256_merkle_prove` */
+    static const size_t max_proof_bytes = LSX_SHA256_MERKLE_MAX_PROOF_BYTES;
+    inline bool prove(size_t first, size_t count, uint8_t* out,
+                      size_t& out_bytes) const {
+      return lsx_sha256_merkle_prove(this, first, count, out, &out_bytes)
+        != 0;
+    }
+    static inline bool verify(const uint8_t digest[hash_bytes],
+                              uint64_t object_bytes, size_t chunk_bytes,
+                              size_t first, const void* data,
+                              size_t data_bytes, const uint8_t* proof,
+                              size_t proof_bytes) {
+      return lsx_sha256_merkle_verify(digest, object_bytes, chunk_bytes,
+                                      first, data, data_bytes, proof,
+                                      proof_bytes) != 0;
+    }
+  };
+  /*** HMAC-SHA256 ***/
+  /* A prepared key. Preparing the key does the ipad/opad hashing once, so
+     each MAC computed with it only has to hash the message. */
+  class hmac_sha256 : protected lsx_hmac_sha256_key {
+    friend class hmac_sha256_message;
+  public:
+    static const unsigned block_bytes = SHA256_BLOCKBYTES;
+    static const unsigned mac_bytes = SHA256_HASHBYTES;
+    inline hmac_sha256(const void* key, size_t key_bytes) {
+      rekey(key, key_bytes);
+    }
+    inline ~hmac_sha256() { sanitize(); }
+    inline hmac_sha256& rekey(const void* key, size_t key_bytes) {
+      lsx_setup_hmac_sha256_key(this, key, key_bytes);
+      return *this;
+    }
+    /* MAC a message that's entirely in memory */
+    inline const hmac_sha256& sum(const void* message, size_t bytes,
+                                  uint8_t out[mac_bytes]) const {
+      lsx_calculate_hmac_sha256(this, message, bytes, out);
+      return *this;
+    }
+    /* Constant time comparison against an expected MAC */
+    inline bool verify(const void* message, size_t bytes,
+                       const uint8_t mac[mac_bytes]) const {
+      return lsx_verify_hmac_sha256(this, message, bytes, mac) != 0;
+    }
+    /* This is explicitly called by the destructor, so you don't need to call
+       it unless the instance will outlive the usefulness of the current key */
+    inline hmac_sha256& sanitize() {
+      lsx_destroy_hmac_sha256_key(this);
+      return *this;
+    }
+  };
+  /* one message in progress; provide message data in any quantities */
+  class hmac_sha256_message : protected lsx_hmac_sha256_context {
+  public:
+    static const unsigned mac_bytes = SHA256_HASHBYTES;
+    inline hmac_sha256_message(const hmac_sha256& key) {
+      reinit(key);
+    }
+    inline ~hmac_sha256_message() { sanitize(); }
+    /* Add message data */
+    inline hmac_sha256_message& input(const void* input, size_t bytes) {
+      lsx_input_hmac_sha256(this, input, bytes);
+      return *this;
+    }
+    /* Compute the MAC.
+       This leaves the instance in an unusable state. Call `reinit` on it if
+       you want to use it again before destruction. */
+    inline hmac_sha256_message& finish(uint8_t out[mac_bytes]) {
+      lsx_finish_hmac_sha256(this, out);
+      return *this;
+    }
+    /* Start a new message. The key may be the same one or a different one. */
+    inline hmac_sha256_message& reinit(const hmac_sha256& key) {
+      lsx_setup_hmac_sha256(this, &key);
+      return *this;
+    }
+    /* This is explicitly called by the destructor, so you don't need to call
+       it unless the instance will continue existing. */
+    inline hmac_sha256_message& sanitize() {
+      lsx_destroy_hmac_sha256(this);
+      return *this;
+    }
+  };
+  /*** PBKDF2-HMAC-SHA256 ***/
+  inline void pbkdf2_hmac_sha256(const void* password, size_t password_bytes,
+                                 const void* salt, size_t salt_bytes,
+                                 uint32_t iterations,
+                                 uint8_t* out, size_t out_bytes) {
+    lsx_pbkdf2_hmac_sha256(password, password_bytes, salt, salt_bytes,
+                           iterations, out, out_bytes);
+  }
+  /* many (password, salt) pairs at once; faster than one at a time */
+  inline void pbkdf2_hmac_sha256_many(const void* const passwords[],
+                                      const size_t password_lens[],
+                                      const void* const salts[],
+                                      const size_t salt_lens[],
+                                      size_t count, uint32_t iterations,
+                                      uint8_t (*out)[SHA256_HASHBYTES]) {
+    lsx_pbkdf2_hmac_sha256_many(passwords, password_lens, salts, salt_lens,
+                                count, iterations, out);
+  }
+  inline size_t verify_pbkdf2_hmac_sha256_many(const void* const passwords[],
+                                               const size_t password_lens[],
+                                               const void* const salts[],
+                                               const size_t salt_lens[],
+                                               size_t count,
+                                               uint32_t iterations,
+                                               const uint8_t
+                                               (*expected)[SHA256_HASHBYTES],
+                                               int results[]) {
+    return lsx_verify_pbkdf2_hmac_sha256_many(passwords, password_lens,
+                                              salts, salt_lens, count,
+                                              iterations, expected, results);
+  }
+  /*** HKDF-SHA256 ***/
+  /* An extracted pseudorandom key, ready to be expanded any number of times */
+  class hkdf_sha256 : protected lsx_hkdf_sha256_prk {
+  public:
+    static const size_t max_bytes = LSX_HKDF_SHA256_MAX_BYTES;
+    inline hkdf_sha256(const void* salt, size_t salt_bytes,
+                       const void* ikm, size_t ikm_bytes) {
+      extract(salt, salt_bytes, ikm, ikm_bytes);
+    }
+    inline ~hkdf_sha256() { sanitize(); }
+    /* Replace the PRK with a newly extracted one */
+    inline hkdf_sha256& extract(const void* salt, size_t salt_bytes,
+                                const void* ikm, size_t ikm_bytes) {
+      lsx_hkdf_sha256_extract(this, salt, salt_bytes, ikm, ikm_bytes);
+      return *this;
+    }
+    /* Returns false (writing nothing) if `out_bytes` > `max_bytes` */
+    inline bool expand(const void* info, size_t info_bytes,
+                       uint8_t* out, size_t out_bytes) const {
+      return lsx_hkdf_sha256_expand(this, info, info_bytes,
+                                    out, out_bytes) != 0;
+    }
+    /* Rekey `cipher` with a `key_bytes` long key. Returns false (doing
+       nothing) if that's not a valid Twofish key length. */
+    inline bool expand(const void* info, size_t info_bytes,
+                       twofish& cipher, size_t key_bytes) const {
+      return lsx_hkdf_sha256_expand_twofish(this, info, info_bytes,
+                                            &cipher, key_bytes) != 0;
+    }
+    /* This is explicitly called by the destructor, so you don't need to call
+       it unless the instance will outlive the usefulness of the current key */
+    inline hkdf_sha256& sanitize() {
+      lsx_destroy_hkdf_sha256_prk(this);
+      return *this;
+    }
+  };
+  /*** SHA-512, SHA-384, SHA-512/256 ***/
+  /* These share everything but the initial state and the hash length, so the
+     classes below are all instantiations of these two templates. */
+  template<void(*setup_func)(lsx_sha512_expert_context*),
+           unsigned HASH_BYTES>
+  class sha512_expert_variant : protected lsx_sha512_expert_context {
+  public:
+    static const unsigned block_bytes = SHA512_BLOCKBYTES;
+    static const unsigned hash_bytes = HASH_BYTES;
+    inline sha512_expert_variant(bool initialize = true) {
+      if(initialize) reinit();
+    }
+    inline ~sha512_expert_variant() { sanitize(); }
+    /* Add complete blocks of message data
+       (number of bytes = `block_bytes` * blocks */
+    inline sha512_expert_variant& input(const void* input, size_t blocks) {
+      lsx_input_sha512_expert(this, input, blocks);
+      return *this;
+    }
+    /* Add any remaining data and compute the hash.
+       This leaves the instance in an unusable state. Call `reinit` on it if
+       you want to use it again before destruction. */
+    inline sha512_expert_variant& finish(uint8_t out[hash_bytes],
+                                         const void* input = nullptr,
+                                         size_t bytes = 0) {
+      lsx_finish_sha512_expert(this, input, bytes, out);
+      return *this;
+    }
+    /* Initialize the instance for a new message. */
+    inline sha512_expert_variant& reinit() {
+      setup_func(this);
+      return *this;
+    }
+    /* Change the sanitization policy (`LSX_POLICY_SECRET` or
+       `LSX_POLICY_PUBLIC`) until the next `reinit` */
+    inline sha512_expert_variant& set_policy(int policy) {
+      lsx_set_sha512_expert_policy(this, policy);
+      return *this;
+    }
+    /* This is explicitly called by the destructor, so you don't need to call
+       it unless the instance will continue existing. */
+    inline sha512_expert_variant& sanitize() {
+      lsx_destroy_sha512_expert(this);
+      return *this;
+    }
+  };
+  template<void(*setup_func)(lsx_sha512_context*),
+           void(*calculate_func)(const void*, size_t, uint8_t*),
+           unsigned HASH_BYTES>
+  class sha512_variant : protected lsx_sha512_context {
+  public:
+    static const unsigned block_bytes = SHA512_BLOCKBYTES;
+    static const unsigned hash_bytes = HASH_BYTES;
+    inline sha512_variant(bool initialize = true) {
+      if(initialize) reinit();
+    }
+    inline ~sha512_variant() { sanitize(); }
+    /* Add message data */
+    inline sha512_variant& input(const void* input, size_t bytes) {
+      lsx_input_sha512(this, input, bytes);
+      return *this;
+    }
+    /* Compute the hash.
+       This leaves the instance in an unusable state. Call `reinit` on it if
+       you want to use it again before destruction. */
+    inline sha512_variant& finish(uint8_t out[hash_bytes]) {
+      lsx_finish_sha512(this, out);
+      return *this;
+    }
+    /* Initialize the instance for a new message. */
+    inline sha512_variant& reinit() {
+      setup_func(this);
+      return *this;
+    }
+    /* Change the sanitization policy (`LSX_POLICY_SECRET` or
+       `LSX_POLICY_PUBLIC`) until the next `reinit` */
+    inline sha512_variant& set_policy(int policy) {
+      lsx_set_sha512_policy(this, policy);
+      return *this;
+    }
+    /* This is explicitly called by the destructor, so you don't need to call
+       it unless the instance will continue existing. */
+    inline sha512_variant& sanitize() {
+      lsx_destroy_sha512(this);
+      return *this;
+    }
+    /* "lazy" interface; pass in all message data at once */
+    static inline void sum(const void* message, size_t bytes,
+                           uint8_t out[hash_bytes]) {
+      calculate_func(message, bytes, out);
+    }
   };
+  typedef sha512_expert_variant<lsx_setup_sha512_expert, SHA512_HASHBYTES>
+    sha512_expert;
+  typedef sha512_expert_variant<lsx_setup_sha384_expert, SHA384_HASHBYTES>
+    sha384_expert;
+  typedef sha512_expert_variant<lsx_setup_sha512_256_expert,
+                                SHA512_256_HASHBYTES> sha512_256_expert;
+  typedef sha512_variant<lsx_setup_sha512, lsx_calculate_sha512,
+                         SHA512_HASHBYTES> sha512;
+  typedef sha512_variant<lsx_setup_sha384, lsx_calculate_sha384,
+                         SHA384_HASHBYTES> sha384;
+  typedef sha512_variant<lsx_setup_sha512_256, lsx_calculate_sha512_256,
+                         SHA512_256_HASHBYTES> sha512_256;
 }
 
 #endif
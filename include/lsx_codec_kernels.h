@@ -0,0 +1,37 @@
+#ifndef LSX_CODEC_KERNELS_H
+#define LSX_CODEC_KERNELS_H
+
+/* Internal header. The vectorized hex and base64 kernels, shared between
+   lsx_codec.c and the instruction-set-specific file. */
+
+#include "lsx.h"
+#include "lsx_cpu.h"
+
+/* Each kernel does as much of the job as it can a whole vector at a time,
+   and returns how many input bytes (encoders) or characters (decoders) it
+   consumed; the portable code does the rest. Decoders stop short of the first
+   vector holding an invalid character, so that the portable code is the one
+   to find it. Kernels may read up to a vector past what they consume, but
+   never past the end of the input or output. */
+typedef size_t (*lsx_encode_func)(const uint8_t* in, size_t bytes, char* out);
+typedef size_t (*lsx_decode_func)(const char* in, size_t chars, uint8_t* out);
+
+#if LSX_X86
+extern size_t lsx_hex_encode_ssse3(const uint8_t* in, size_t bytes,
+                                   char* out);
+extern size_t lsx_hex_decode_ssse3(const char* in, size_t chars,
+                                   uint8_t* out);
+extern size_t lsx_base64_encode_ssse3(const uint8_t* in, size_t bytes,
+                                      char* out);
+extern size_t lsx_base64_decode_ssse3(const char* in, size_t chars,
+                                      uint8_t* out);
+extern size_t lsx_hex_encode_avx2(const uint8_t* in, size_t bytes, char* out);
+extern size_t lsx_hex_decode_avx2(const char* in, size_t chars,
+                                  uint8_t* out);
+extern size_t lsx_base64_encode_avx2(const uint8_t* in, size_t bytes,
+                                     char* out);
+extern size_t lsx_base64_decode_avx2(const char* in, size_t chars,
+                                     uint8_t* out);
+#endif
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef LSX_CPU_H
+#define LSX_CPU_H
+
+/* Internal header. Runtime CPU feature detection, for choosing between the
+   portable C kernels and the ones that need instruction set extensions. */
+
+#include <stdint.h>
+
+/* The x86 kernels use GCC-style `target` attributes and <immintrin.h>, so
+   they're only built by GCC-compatible compilers. Define LSX_NO_X86 to leave
+   them out regardless. */
+#if !defined(LSX_NO_X86) && (defined(__GNUC__) || defined(__clang__)) \
+  && (defined(__x86_64__) || defined(__i386__))
+#define LSX_X86 1
+#else
+#define LSX_X86 0
+#endif
+
+#define LSX_CPU_SSE2    0x0001
+#define LSX_CPU_SSSE3   0x0002
+#define LSX_CPU_SSE41   0x0004
+#define LSX_CPU_SHA     0x0008
+#define LSX_CPU_AVX2    0x0010
+#define LSX_CPU_BMI2    0x0020
+#define LSX_CPU_AVX512F 0x0040
+
+/* Returns a mask of the above. Always zero when LSX_X86 is zero. AVX2 and
+   AVX-512 are only reported if the OS saves the relevant registers. */
+extern unsigned lsx_cpu_features(void);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef LSX_IO_H
+#define LSX_IO_H
+
+/* Internal header. Reading whole file descriptors, for the functions that
+   hash files. */
+
+#include "lsx_thread.h"
+
+/* Read until `bytes` bytes have been read or end of file is reached,
+   retrying interrupted reads. Returns how many were read, or (size_t)-1 (with
+   errno set) on error. */
+extern size_t lsx_read_fully(int fd, void* buf, size_t bytes);
+
+/* Read `fd` to its end through a pair of 1MiB buffers, filled on a thread of
+   their own with `lsx_double_buffer`, passing each one to `drain`. Returns
+   zero, with errno set, if reading failed or the buffers couldn't be
+   allocated. */
+extern int lsx_drain_fd(int fd, lsx_drain_func drain, void* arg);
+
+#endif
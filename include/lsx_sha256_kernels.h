@@ -0,0 +1,60 @@
+#ifndef LSX_SHA256_KERNELS_H
+#define LSX_SHA256_KERNELS_H
+
+/* Internal header. The SHA-256 compression kernels, shared between
+   lsx_sha256.c and the instruction-set-specific files. */
+
+#include "lsx.h"
+#include "lsx_cpu.h"
+
+/* Compress `blocks` complete 64-byte blocks into the eight-word state `h`.
+   Kernels don't touch `bytes_so_far`; the caller does that. If `wipe` is
+   nonzero, the kernel wipes its message schedule before returning. */
+typedef void (*lsx_sha256_blocks_func)(uint32_t h[8], const uint8_t* input,
+                                       size_t blocks, int wipe);
+
+/* Compress one block from each of `lanes` independent messages. Word `i` of
+   lane `l`'s state is at `state[i * lanes + l]`. `wipe` is as above. */
+typedef void (*lsx_sha256_lanes_func)(uint32_t* state,
+                                      const uint8_t* const* blocks, int wipe);
+/* The most lanes any lanes kernel uses */
+#define LSX_SHA256_MAX_LANES 8
+
+/* For other parts of the library that build their own blocks: the kernel
+   picked by `lsx_set_sha256_implementation`, and the lanes kernel picked by
+   `lsx_set_sha256_many_implementation` (NULL, with `*lanes` = 1, if that's
+   SERIAL). `policy` is the sanitization policy to compress under. */
+extern void lsx_sha256_compress(uint32_t h[8], const uint8_t* input,
+                                size_t blocks, int policy);
+extern lsx_sha256_lanes_func lsx_sha256_get_lanes_kernel(unsigned* lanes);
+
+/* The last step of the tree hash (see `lsx_calculate_sha256_tree`): turn the
+   root of the leaf tree into the digest */
+extern void lsx_sha256_tree_digest(const uint8_t root[SHA256_HASHBYTES],
+                                   uint64_t leaf_bytes, uint64_t bytes,
+                                   int policy,
+                                   uint8_t out[SHA256_HASHBYTES]);
+
+/* The round constants, and the initial state */
+extern const uint32_t lsx_sha256_k[64];
+extern const uint32_t lsx_sha256_iv[8];
+
+#if LSX_X86
+/* SHA extensions (needs LSX_CPU_SHA and LSX_CPU_SSE41) */
+extern void lsx_sha256_blocks_shani(uint32_t h[8], const uint8_t* input,
+                                    size_t blocks, int wipe);
+/* Vectorized message schedule, scalar rounds. SSSE3 does one block at a time,
+   AVX2 (which also wants LSX_CPU_BMI2) two. */
+extern void lsx_sha256_blocks_ssse3(uint32_t h[8], const uint8_t* input,
+                                    size_t blocks, int wipe);
+extern void lsx_sha256_blocks_avx2(uint32_t h[8], const uint8_t* input,
+                                   size_t blocks, int wipe);
+/* SSE2, 4 lanes */
+extern void lsx_sha256_lanes4(uint32_t state[8*4],
+                              const uint8_t* const blocks[4], int wipe);
+/* AVX2, 8 lanes */
+extern void lsx_sha256_lanes8(uint32_t state[8*8],
+                              const uint8_t* const blocks[8], int wipe);
+#endif
+
+#endif
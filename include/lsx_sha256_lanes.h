@@ -0,0 +1,65 @@
+/* Included by lsx_sha256_x86.c once per vector width. Before including it,
+   define `lanes`, `lanes_target`, `vec`, the V_* operations, and
+   V_LOAD_MESSAGE (which loads sixteen vectors, each containing the same
+   big-endian word from every lane's block). This
+   compresses one block in each of `lanes` independent SHA-256 states, with
+   word `i` of lane `l`'s state at `state[i * lanes + l]`, and wipes the
+   message schedule afterward if `wipe` is nonzero. */
+#define V_ROTR(x,n) V_OR(V_SRL(x,n), V_SLL(x,32-(n)))
+#define V_S0(x) V_XOR(V_XOR(V_ROTR(x,2), V_ROTR(x,13)), V_ROTR(x,22))
+#define V_S1(x) V_XOR(V_XOR(V_ROTR(x,6), V_ROTR(x,11)), V_ROTR(x,25))
+#define V_s0(x) V_XOR(V_XOR(V_ROTR(x,7), V_ROTR(x,18)), V_SRL(x,3))
+#define V_s1(x) V_XOR(V_XOR(V_ROTR(x,17), V_ROTR(x,19)), V_SRL(x,10))
+#define V_CH(e,f,g) V_XOR(V_AND(e,f), V_ANDNOT(e,g))
+#define V_MAJ(a,b,c) V_OR(V_AND(a,b), V_AND(c, V_OR(a,b)))
+#define V_ROUND(a,b,c,d,e,f,g,h,i) \
+  t = V_ADD(V_ADD(V_ADD(h, V_S1(e)), V_ADD(V_CH(e,f,g), w[(i)&15])), \
+            V_SET1(lsx_sha256_k[i])); \
+  d = V_ADD(d, t); \
+  h = V_ADD(V_ADD(t, V_S0(a)), V_MAJ(a,b,c))
+#define V_SCHEDULE(i) \
+  w[(i)&15] = V_ADD(V_ADD(w[(i)&15], V_s0(w[((i)+1)&15])), \
+                    V_ADD(w[((i)+9)&15], V_s1(w[((i)+14)&15])))
+#define V_EIGHT_ROUNDS(i) \
+  V_ROUND(a,b,c,d,e,f,g,h,(i)+0); V_ROUND(h,a,b,c,d,e,f,g,(i)+1); \
+  V_ROUND(g,h,a,b,c,d,e,f,(i)+2); V_ROUND(f,g,h,a,b,c,d,e,(i)+3); \
+  V_ROUND(e,f,g,h,a,b,c,d,(i)+4); V_ROUND(d,e,f,g,h,a,b,c,(i)+5); \
+  V_ROUND(c,d,e,f,g,h,a,b,(i)+6); V_ROUND(b,c,d,e,f,g,h,a,(i)+7)
+lanes_target
+void paste(lsx_sha256_lanes,lanes)(uint32_t state[8*lanes],
+                                   const uint8_t* const blocks[lanes],
+                                   int wipe) {
+  vec a, b, c, d, e, f, g, h, t, w[16];
+  unsigned i;
+  V_LOAD_MESSAGE(w, blocks);
+  a = V_LOAD(state + 0 * lanes); b = V_LOAD(state + 1 * lanes);
+  c = V_LOAD(state + 2 * lanes); d = V_LOAD(state + 3 * lanes);
+  e = V_LOAD(state + 4 * lanes); f = V_LOAD(state + 5 * lanes);
+  g = V_LOAD(state + 6 * lanes); h = V_LOAD(state + 7 * lanes);
+  V_EIGHT_ROUNDS(0);
+  V_EIGHT_ROUNDS(8);
+  for(i = 16; i < 64; i += 8) {
+    V_SCHEDULE(i+0); V_SCHEDULE(i+1); V_SCHEDULE(i+2); V_SCHEDULE(i+3);
+    V_SCHEDULE(i+4); V_SCHEDULE(i+5); V_SCHEDULE(i+6); V_SCHEDULE(i+7);
+    V_EIGHT_ROUNDS(i);
+  }
+  V_STORE(state + 0 * lanes, V_ADD(a, V_LOAD(state + 0 * lanes)));
+  V_STORE(state + 1 * lanes, V_ADD(b, V_LOAD(state + 1 * lanes)));
+  V_STORE(state + 2 * lanes, V_ADD(c, V_LOAD(state + 2 * lanes)));
+  V_STORE(state + 3 * lanes, V_ADD(d, V_LOAD(state + 3 * lanes)));
+  V_STORE(state + 4 * lanes, V_ADD(e, V_LOAD(state + 4 * lanes)));
+  V_STORE(state + 5 * lanes, V_ADD(f, V_LOAD(state + 5 * lanes)));
+  V_STORE(state + 6 * lanes, V_ADD(g, V_LOAD(state + 6 * lanes)));
+  V_STORE(state + 7 * lanes, V_ADD(h, V_LOAD(state + 7 * lanes)));
+  if(wipe) lsx_explicit_bzero(w, sizeof(w));
+}
+#undef V_ROTR
+#undef V_S0
+#undef V_S1
+#undef V_s0
+#undef V_s1
+#undef V_CH
+#undef V_MAJ
+#undef V_ROUND
+#undef V_SCHEDULE
+#undef V_EIGHT_ROUNDS
@@ -56,3 +56,46 @@ static inline int _test_32bit_table(const uint32_t* known, size_t known_size,
 #define test_32bit_table(known,ours) \
 _test_32bit_table(known, sizeof(known)/4, ours, sizeof(ours)/4, #ours)
 
+/* Runs `test` under every implementation (other than 0, automatic) that
+   `set_impl` accepts, then goes back to automatic. `names` has an entry for
+   every implementation number; `what` is what to call them in messages.
+   Returns nonzero if any run failed. */
+static inline int _for_each_impl(int (*set_impl)(int),
+                                 const char* const* names, size_t count,
+                                 const char* what, int (*test)(void)) {
+  int ret = 0;
+  for(int impl = 1; impl < (int)count; ++impl) {
+    if(!set_impl(impl)) {
+      fprintf(stderr, "(skipping %s %s, not supported here)\n",
+              names[impl], what);
+      continue;
+    }
+    if(test()) {
+      fprintf(stderr, "(the above failure was in the %s %s)\n",
+              names[impl], what);
+      ret = 1;
+    }
+  }
+  set_impl(0);
+  return ret;
+}
+
+#define for_each_impl(set_impl, names, what, test) \
+_for_each_impl(set_impl, names, elementcount(names), what, test)
+
+/* Fills `buf` with bytes from an LCG started at `seed`. Any old LCG will do;
+   the tests only need data that doesn't repeat and that they can remake. */
+static inline void fill_pseudorandom(void* buf, size_t bytes, uint32_t seed) {
+  uint8_t* p = (uint8_t*)buf;
+  for(size_t i = 0; i < bytes; ++i) {
+    seed = seed * 1103515245 + 12345;
+    p[i] = (uint8_t)(seed >> 16);
+  }
+}
+
+/* Most of the SHA-256 constructions go through the multi-buffer kernels */
+static inline int for_each_sha256_many_impl(int (*test)(void)) {
+  static const char* const names[] = {"auto", "serial", "SSE2", "AVX2"};
+  return for_each_impl(lsx_set_sha256_many_implementation, names,
+                       "multi-buffer kernel", test);
+}
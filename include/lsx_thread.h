@@ -0,0 +1,35 @@
+#ifndef LSX_THREAD_H
+#define LSX_THREAD_H
+
+/* Internal header. Just enough threading to spread independent pieces of one
+   big job across cores: POSIX threads, or Win32 threads on Windows. Define
+   LSX_NO_THREADS to build without either, in which case everything runs on
+   the calling thread. */
+
+#include "lsx.h"
+
+typedef void (*lsx_parallel_func)(void* arg, size_t index);
+
+/* Call `func(arg, n)` for every `n` from 0 to `count`-1, on up to `threads`
+   threads (counting the calling thread, and capped at LSX_MAX_THREADS), and
+   return once every call has returned. Indices are handed out in order, one
+   at a time, to whichever thread is free. If some threads can't be started,
+   the rest (at least the calling thread) do all the work. */
+extern void lsx_parallel_for(size_t count, unsigned threads,
+                             lsx_parallel_func func, void* arg);
+
+/* Fill a buffer of up to `bytes` bytes. Returns how many were filled, 0 at
+   the end, or (size_t)-1 on error. */
+typedef size_t (*lsx_fill_func)(void* arg, void* buf, size_t bytes);
+typedef void (*lsx_drain_func)(void* arg, const void* buf, size_t bytes);
+
+/* Double buffering: `fill` runs on a thread of its own, filling `bufs[0]`
+   and `bufs[1]` in turn, while the calling thread passes each one to `drain`
+   as soon as it's full. Ends when `fill` returns 0 or (size_t)-1, and
+   returns zero in the latter case. If the thread can't be started, the two
+   take turns on the calling thread. */
+extern int lsx_double_buffer(void* const bufs[2], size_t bytes,
+                             lsx_fill_func fill, lsx_drain_func drain,
+                             void* arg);
+
+#endif
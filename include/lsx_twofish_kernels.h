@@ -0,0 +1,32 @@
+#ifndef LSX_TWOFISH_KERNELS_H
+#define LSX_TWOFISH_KERNELS_H
+
+/* Internal header. The vectorized Twofish kernels behind the bulk modes,
+   shared between lsx_twofish.c and the instruction-set-specific file. */
+
+#include "lsx.h"
+#include "lsx_cpu.h"
+
+/* Each kernel encrypts or decrypts as many blocks as it can a whole vector at
+   a time, and returns how many it did; the portable code does the rest. `in`
+   and `out` may be the same. */
+typedef size_t (*lsx_twofish_blocks_func)(lsx_twofish_context* ctx,
+                                          const uint8_t* in, uint8_t* out,
+                                          size_t blocks);
+
+#if LSX_X86
+extern size_t lsx_twofish_encrypt_avx2(lsx_twofish_context* ctx,
+                                       const uint8_t* in, uint8_t* out,
+                                       size_t blocks);
+extern size_t lsx_twofish_decrypt_avx2(lsx_twofish_context* ctx,
+                                       const uint8_t* in, uint8_t* out,
+                                       size_t blocks);
+extern size_t lsx_twofish_encrypt_avx512(lsx_twofish_context* ctx,
+                                         const uint8_t* in, uint8_t* out,
+                                         size_t blocks);
+extern size_t lsx_twofish_decrypt_avx512(lsx_twofish_context* ctx,
+                                         const uint8_t* in, uint8_t* out,
+                                         size_t blocks);
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+#include "lsx.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) \
+  && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+#define elementcount(arr) (sizeof(arr) / sizeof(*(arr)))
+
+static const char* const impl_names[] = {
+  "auto", "scalar", "SHA-NI", "SSSE3", "AVX2", "unrolled",
+};
+
+/* big enough to fall out of L1, small enough to stay in L2 */
+static uint8_t buf[SHA256_BLOCKBYTES * 4096];
+
+static double seconds(void) {
+  return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/* Hash `buf` in calls of `blocks` blocks each, over and over, for at least a
+   second. Prints MB/s, and (where we can count them) cycles per byte. */
+static void bench(size_t blocks) {
+  lsx_sha256_expert_context ctx;
+  size_t calls = sizeof(buf) / (blocks * SHA256_BLOCKBYTES), n;
+  unsigned long long bytes = 0;
+#if HAVE_RDTSC
+  unsigned long long cycles = __rdtsc();
+#endif
+  double start = seconds(), elapsed;
+  lsx_setup_sha256_expert(&ctx);
+  do {
+    for(n = 0; n < calls; ++n)
+      lsx_input_sha256_expert(&ctx, buf + n * blocks * SHA256_BLOCKBYTES,
+                              blocks);
+    bytes += calls * blocks * SHA256_BLOCKBYTES;
+  } while((elapsed = seconds() - start) < 1.0);
+#if HAVE_RDTSC
+  cycles = __rdtsc() - cycles;
+  printf("  %4u blocks/call: %8.1f MB/s %6.2f cycles/byte\n",
+         (unsigned)blocks, bytes / elapsed / 1e6, (double)cycles / bytes);
+#else
+  printf("  %4u blocks/call: %8.1f MB/s\n",
+         (unsigned)blocks, bytes / elapsed / 1e6);
+#endif
+  lsx_destroy_sha256_expert(&ctx);
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  memset(buf, 0xA5, sizeof(buf));
+  for(int impl = 1; impl < (int)elementcount(impl_names); ++impl) {
+    if(!lsx_set_sha256_implementation(impl)) continue;
+    printf("SHA-256, %s:\n", impl_names[impl]);
+    bench(1);
+    bench(16);
+    bench(4096);
+  }
+  return 0;
+}
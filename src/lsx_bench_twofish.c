@@ -0,0 +1,96 @@
+#include "lsx.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) \
+  && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+#define elementcount(arr) (sizeof(arr) / sizeof(*(arr)))
+
+static const char* const impl_names[] = {
+  "auto", "scalar", "AVX2", "AVX-512",
+};
+
+/* big enough to fall out of L1, small enough to stay in L2 */
+static uint8_t buf[TWOFISH_BLOCKBYTES * 4096];
+static lsx_twofish_context ctx;
+static uint8_t iv[TWOFISH_BLOCKBYTES];
+
+static double seconds(void) {
+  return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static void one_at_a_time(void) {
+  size_t n;
+  for(n = 0; n < sizeof(buf); n += TWOFISH_BLOCKBYTES)
+    lsx_encrypt_twofish(&ctx, buf + n, buf + n);
+}
+
+static void ecb_encrypt(void) {
+  lsx_twofish_ecb_encrypt(&ctx, buf, buf, sizeof(buf) / TWOFISH_BLOCKBYTES);
+}
+
+static void ecb_decrypt(void) {
+  lsx_twofish_ecb_decrypt(&ctx, buf, buf, sizeof(buf) / TWOFISH_BLOCKBYTES);
+}
+
+static void cbc_encrypt(void) {
+  lsx_twofish_cbc_encrypt(&ctx, iv, buf, buf,
+                          sizeof(buf) / TWOFISH_BLOCKBYTES);
+}
+
+static void cbc_decrypt(void) {
+  lsx_twofish_cbc_decrypt(&ctx, iv, buf, buf,
+                          sizeof(buf) / TWOFISH_BLOCKBYTES);
+}
+
+static void ctr(void) {
+  lsx_twofish_ctr_xor(&ctx, iv, 0, buf, buf, sizeof(buf));
+}
+
+/* Run `func` over and over, for at least a second. Prints MB/s, and (where we
+   can count them) cycles per byte. */
+static void bench(const char* name, void(*func)(void)) {
+  unsigned long long bytes = 0;
+#if HAVE_RDTSC
+  unsigned long long cycles = __rdtsc();
+#endif
+  double start = seconds(), elapsed;
+  do {
+    func();
+    bytes += sizeof(buf);
+  } while((elapsed = seconds() - start) < 1.0);
+#if HAVE_RDTSC
+  cycles = __rdtsc() - cycles;
+  printf("  %-16s %8.1f MB/s %6.2f cycles/byte\n",
+         name, bytes / elapsed / 1e6, (double)cycles / bytes);
+#else
+  printf("  %-16s %8.1f MB/s\n", name, bytes / elapsed / 1e6);
+#endif
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  uint8_t key[TWOFISH256_KEYBYTES];
+  memset(key, 0x5A, sizeof(key));
+  memset(buf, 0xA5, sizeof(buf));
+  lsx_setup_twofish256(&ctx, key);
+  printf("Twofish:\n");
+  bench("one block/call", one_at_a_time);
+  bench("CBC encrypt", cbc_encrypt);
+  for(int impl = 1; impl < (int)elementcount(impl_names); ++impl) {
+    if(!lsx_set_twofish_implementation(impl)) continue;
+    printf("Twofish, %s:\n", impl_names[impl]);
+    bench("ECB encrypt", ecb_encrypt);
+    bench("ECB decrypt", ecb_decrypt);
+    bench("CBC decrypt", cbc_decrypt);
+    bench("CTR", ctr);
+  }
+  lsx_destroy_twofish(&ctx);
+  return 0;
+}
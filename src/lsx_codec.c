@@ -0,0 +1,228 @@
+#include "lsx.h"
+#include "lsx_codec_kernels.h"
+
+static const char hex_digits[16] = "0123456789abcdef";
+static const char base64_digits[64] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* -1 if `c` isn't a digit */
+static int hex_value(unsigned char c) {
+  if(c >= '0' && c <= '9') return c - '0';
+  c |= 0x20;
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+static int base64_value(unsigned char c) {
+  if(c >= 'A' && c <= 'Z') return c - 'A';
+  if(c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if(c >= '0' && c <= '9') return c - '0' + 52;
+  if(c == '+') return 62;
+  if(c == '/') return 63;
+  return -1;
+}
+
+static void hex_encode_scalar(const uint8_t* in, size_t bytes, char* out) {
+  while(bytes-- > 0) {
+    *out++ = hex_digits[*in >> 4];
+    *out++ = hex_digits[*in++ & 15];
+  }
+}
+
+static size_t hex_decode_scalar(const char* in, size_t chars, uint8_t* out) {
+  size_t n;
+  for(n = 0; n < chars; n += 2) {
+    int hi = hex_value((unsigned char)in[n]);
+    int lo = hex_value((unsigned char)in[n+1]);
+    if(hi < 0 || lo < 0) return (size_t)-1;
+    *out++ = (uint8_t)(hi << 4 | lo);
+  }
+  return chars / 2;
+}
+
+static void base64_encode_scalar(const uint8_t* in, size_t bytes, char* out) {
+  for(; bytes >= 3; bytes -= 3, in += 3, out += 4) {
+    uint32_t group = (uint32_t)in[0] << 16 | (uint32_t)in[1] << 8 | in[2];
+    out[0] = base64_digits[group >> 18];
+    out[1] = base64_digits[(group >> 12) & 63];
+    out[2] = base64_digits[(group >> 6) & 63];
+    out[3] = base64_digits[group & 63];
+  }
+  if(bytes > 0) {
+    uint32_t group = (uint32_t)in[0] << 16
+      | (bytes > 1 ? (uint32_t)in[1] << 8 : 0);
+    out[0] = base64_digits[group >> 18];
+    out[1] = base64_digits[(group >> 12) & 63];
+    out[2] = bytes > 1 ? base64_digits[(group >> 6) & 63] : '=';
+    out[3] = '=';
+  }
+}
+
+static size_t base64_decode_scalar(const char* in, size_t chars,
+                                   uint8_t* out) {
+  size_t n, bytes = 0;
+  for(n = 0; n < chars; n += 4) {
+    int a = base64_value((unsigned char)in[n]);
+    int b = base64_value((unsigned char)in[n+1]);
+    int c = base64_value((unsigned char)in[n+2]);
+    int d = base64_value((unsigned char)in[n+3]);
+    if(a < 0 || b < 0) return (size_t)-1;
+    if((c < 0 || d < 0) && n + 4 == chars) {
+      /* the padded last group */
+      if(d >= 0 || in[n+3] != '=') return (size_t)-1;
+      if(c < 0) {
+        if(in[n+2] != '=' || (b & 15)) return (size_t)-1;
+        out[bytes++] = (uint8_t)(a << 2 | b >> 4);
+      }
+      else {
+        if(c & 3) return (size_t)-1;
+        out[bytes++] = (uint8_t)(a << 2 | b >> 4);
+        out[bytes++] = (uint8_t)(b << 4 | c >> 2);
+      }
+      break;
+    }
+    if(c < 0 || d < 0) return (size_t)-1;
+    out[bytes++] = (uint8_t)(a << 2 | b >> 4);
+    out[bytes++] = (uint8_t)(b << 4 | c >> 2);
+    out[bytes++] = (uint8_t)(c << 6 | d);
+  }
+  return bytes;
+}
+
+/* The portable code does the whole job */
+static size_t encode_none(const uint8_t* in, size_t bytes, char* out) {
+  (void)in; (void)bytes; (void)out;
+  return 0;
+}
+
+static size_t decode_none(const char* in, size_t chars, uint8_t* out) {
+  (void)in; (void)chars; (void)out;
+  return 0;
+}
+
+static size_t hex_encode_resolve(const uint8_t* in, size_t bytes, char* out);
+static size_t hex_decode_resolve(const char* in, size_t chars, uint8_t* out);
+static size_t base64_encode_resolve(const uint8_t* in, size_t bytes,
+                                    char* out);
+static size_t base64_decode_resolve(const char* in, size_t chars,
+                                    uint8_t* out);
+/* The vectorized part of each job. Each starts out pointing at a function
+   that picks the best kernels and then calls the new one, like the SHA-256
+   block function; every one is always safe to call on its own, so nothing
+   depends on the order in which another thread sees them change. */
+static lsx_encode_func hex_encode_kernel = hex_encode_resolve;
+static lsx_decode_func hex_decode_kernel = hex_decode_resolve;
+static lsx_encode_func base64_encode_kernel = base64_encode_resolve;
+static lsx_decode_func base64_decode_kernel = base64_decode_resolve;
+static int codec_impl = LSX_CODEC_IMPL_AUTO;
+
+int lsx_set_codec_implementation(int impl) {
+  if(impl == LSX_CODEC_IMPL_AUTO) {
+#if LSX_X86
+    if(lsx_set_codec_implementation(LSX_CODEC_IMPL_AVX2)) return 1;
+    if(lsx_set_codec_implementation(LSX_CODEC_IMPL_SSSE3)) return 1;
+#endif
+    return lsx_set_codec_implementation(LSX_CODEC_IMPL_SCALAR);
+  }
+  switch(impl) {
+  case LSX_CODEC_IMPL_SCALAR:
+    hex_encode_kernel = encode_none;
+    hex_decode_kernel = decode_none;
+    base64_encode_kernel = encode_none;
+    base64_decode_kernel = decode_none;
+    break;
+#if LSX_X86
+  case LSX_CODEC_IMPL_SSSE3:
+    if(!(lsx_cpu_features() & LSX_CPU_SSSE3)) return 0;
+    hex_encode_kernel = lsx_hex_encode_ssse3;
+    hex_decode_kernel = lsx_hex_decode_ssse3;
+    base64_encode_kernel = lsx_base64_encode_ssse3;
+    base64_decode_kernel = lsx_base64_decode_ssse3;
+    break;
+  case LSX_CODEC_IMPL_AVX2:
+    /* the AVX2 kernels finish up with the SSSE3 ones */
+    if((lsx_cpu_features() & (LSX_CPU_AVX2 | LSX_CPU_SSSE3))
+       != (LSX_CPU_AVX2 | LSX_CPU_SSSE3)) return 0;
+    hex_encode_kernel = lsx_hex_encode_avx2;
+    hex_decode_kernel = lsx_hex_decode_avx2;
+    base64_encode_kernel = lsx_base64_encode_avx2;
+    base64_decode_kernel = lsx_base64_decode_avx2;
+    break;
+#endif
+  default:
+    return 0;
+  }
+  codec_impl = impl;
+  return 1;
+}
+
+int lsx_get_codec_implementation(void) {
+  if(codec_impl == LSX_CODEC_IMPL_AUTO)
+    lsx_set_codec_implementation(LSX_CODEC_IMPL_AUTO);
+  return codec_impl;
+}
+
+static size_t hex_encode_resolve(const uint8_t* in, size_t bytes, char* out) {
+  lsx_set_codec_implementation(LSX_CODEC_IMPL_AUTO);
+  return hex_encode_kernel(in, bytes, out);
+}
+
+static size_t hex_decode_resolve(const char* in, size_t chars, uint8_t* out) {
+  lsx_set_codec_implementation(LSX_CODEC_IMPL_AUTO);
+  return hex_decode_kernel(in, chars, out);
+}
+
+static size_t base64_encode_resolve(const uint8_t* in, size_t bytes,
+                                    char* out) {
+  lsx_set_codec_implementation(LSX_CODEC_IMPL_AUTO);
+  return base64_encode_kernel(in, bytes, out);
+}
+
+static size_t base64_decode_resolve(const char* in, size_t chars,
+                                    uint8_t* out) {
+  lsx_set_codec_implementation(LSX_CODEC_IMPL_AUTO);
+  return base64_decode_kernel(in, chars, out);
+}
+
+void lsx_hex_encode(const void* in, size_t bytes, char* out) {
+  const uint8_t* p = (const uint8_t*)in;
+  size_t done = hex_encode_kernel(p, bytes, out);
+  hex_encode_scalar(p + done, bytes - done, out + done * 2);
+}
+
+size_t lsx_hex_decode(const char* in, size_t chars, void* out) {
+  uint8_t* p = (uint8_t*)out;
+  size_t done, rest;
+  if(chars % 2) return (size_t)-1;
+  done = hex_decode_kernel(in, chars, p);
+  rest = hex_decode_scalar(in + done, chars - done, p + done / 2);
+  return rest == (size_t)-1 ? rest : chars / 2;
+}
+
+void lsx_base64_encode(const void* in, size_t bytes, char* out) {
+  const uint8_t* p = (const uint8_t*)in;
+  size_t done = base64_encode_kernel(p, bytes, out);
+  base64_encode_scalar(p + done, bytes - done, out + done / 3 * 4);
+}
+
+size_t lsx_base64_decode(const char* in, size_t chars, void* out) {
+  uint8_t* p = (uint8_t*)out;
+  size_t done, rest;
+  if(chars % 4) return (size_t)-1;
+  done = base64_decode_kernel(in, chars, p);
+  rest = base64_decode_scalar(in + done, chars - done, p + done / 4 * 3);
+  return rest == (size_t)-1 ? rest : done / 4 * 3 + rest;
+}
+
+void lsx_base64_encode_many(const void* in, size_t bytes, size_t count,
+                            char* out) {
+  const uint8_t* p = (const uint8_t*)in;
+  size_t n;
+  /* whole groups line up with the item boundaries, so it's one long job */
+  if(bytes % 3 == 0) {
+    lsx_base64_encode(in, bytes * count, out);
+    return;
+  }
+  for(n = 0; n < count; ++n)
+    lsx_base64_encode(p + n * bytes, bytes, out + n * LSX_BASE64_CHARS(bytes));
+}
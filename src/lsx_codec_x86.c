@@ -0,0 +1,293 @@
+/* Hex and base64 kernels that use x86 instruction set extensions. Nothing in
+   here is called unless lsx_cpu_features() says the CPU can run it. The
+   base64 ones follow Muła and Lemire, "Faster Base64 Encoding and Decoding
+   using AVX2 Instructions". */
+
+#include "lsx_codec_kernels.h"
+
+#if LSX_X86
+
+#include <immintrin.h>
+
+/*** SSSE3 ***/
+
+/* The hex digits for the high and low nibbles of each byte of `x` */
+__attribute__((target("ssse3")))
+static inline void hex_digits_ssse3(__m128i x, __m128i* hi, __m128i* lo) {
+  const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                       '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  *hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(x, 4), nibble));
+  *lo = _mm_shuffle_epi8(digits, _mm_and_si128(x, nibble));
+}
+
+/* The values of sixteen hex digits, with `*valid` set to 0xFF where there
+   really was a digit */
+__attribute__((target("ssse3")))
+static inline __m128i hex_values_ssse3(__m128i c, __m128i* valid) {
+  __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+  __m128i l = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)),
+                           _mm_set1_epi8('a'));
+  __m128i is_d = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+  __m128i is_l = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+  *valid = _mm_or_si128(is_d, is_l);
+  return _mm_or_si128(_mm_and_si128(is_d, d),
+                      _mm_and_si128(is_l, _mm_add_epi8(l, _mm_set1_epi8(10))));
+}
+
+__attribute__((target("ssse3")))
+size_t lsx_hex_encode_ssse3(const uint8_t* in, size_t bytes, char* out) {
+  size_t n;
+  for(n = 0; n + 16 <= bytes; n += 16) {
+    __m128i hi, lo;
+    hex_digits_ssse3(_mm_loadu_si128((const __m128i*)(in + n)), &hi, &lo);
+    _mm_storeu_si128((__m128i*)(out + n * 2), _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128((__m128i*)(out + n * 2 + 16), _mm_unpackhi_epi8(hi, lo));
+  }
+  return n;
+}
+
+__attribute__((target("ssse3")))
+size_t lsx_hex_decode_ssse3(const char* in, size_t chars, uint8_t* out) {
+  /* high nibble times 16, plus low nibble */
+  const __m128i weights = _mm_set1_epi16(0x0110);
+  size_t n;
+  for(n = 0; n + 32 <= chars; n += 32) {
+    __m128i valid0, valid1;
+    __m128i v0 = hex_values_ssse3(_mm_loadu_si128((const __m128i*)(in + n)),
+                                  &valid0);
+    __m128i v1 = hex_values_ssse3(_mm_loadu_si128((const __m128i*)(in+n+16)),
+                                  &valid1);
+    if(_mm_movemask_epi8(_mm_and_si128(valid0, valid1)) != 0xFFFF) break;
+    _mm_storeu_si128((__m128i*)(out + n / 2),
+                     _mm_packus_epi16(_mm_maddubs_epi16(v0, weights),
+                                      _mm_maddubs_epi16(v1, weights)));
+  }
+  return n;
+}
+
+/* Spread twelve bytes of input into sixteen six-bit indices */
+__attribute__((target("ssse3")))
+static inline __m128i base64_split_ssse3(__m128i in) {
+  __m128i t0, t1, t2, t3;
+  in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                         4, 5, 3, 4, 1, 2, 0, 1));
+  t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(t1, t3);
+}
+
+/* Turn six-bit indices into their digits. Each range of the alphabet is the
+   index plus a constant; this works out which range, and so which constant,
+   with one table lookup. */
+__attribute__((target("ssse3")))
+static inline __m128i base64_digits_ssse3(__m128i indices) {
+  const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                        '/' - 63, 'A', 0, 0);
+  __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+  return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+/* The six-bit values of sixteen base64 digits, or zero if any of them isn't
+   a digit. The two tables classify each character by its low and high
+   nibbles; a character is valid if the two classes have no bit in common. */
+__attribute__((target("ssse3")))
+static inline int base64_values_ssse3(__m128i c, __m128i* values) {
+  const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                       0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,
+                                       0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08,
+                                       0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+                                       0x10, 0x10, 0x10, 0x10);
+  const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                         0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  __m128i hi = _mm_and_si128(_mm_srli_epi32(c, 4), nibble);
+  __m128i lo = _mm_and_si128(c, nibble);
+  __m128i clash = _mm_and_si128(_mm_shuffle_epi8(lut_lo, lo),
+                                _mm_shuffle_epi8(lut_hi, hi));
+  if(_mm_movemask_epi8(_mm_cmpeq_epi8(clash, _mm_setzero_si128())) != 0xFFFF)
+    return 0;
+  /* '/' shares its high nibble with '+', and needs a different offset */
+  hi = _mm_add_epi8(hi, _mm_cmpeq_epi8(c, _mm_set1_epi8('/')));
+  *values = _mm_add_epi8(c, _mm_shuffle_epi8(lut_roll, hi));
+  return 1;
+}
+
+/* Pack sixteen six-bit values into twelve bytes, at the bottom */
+__attribute__((target("ssse3")))
+static inline __m128i base64_join_ssse3(__m128i values) {
+  __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+  return _mm_shuffle_epi8(groups, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                                14, 13, 12, -1, -1, -1, -1));
+}
+
+__attribute__((target("ssse3")))
+size_t lsx_base64_encode_ssse3(const uint8_t* in, size_t bytes, char* out) {
+  size_t n;
+  /* each step reads sixteen bytes, but only uses twelve */
+  for(n = 0; n + 16 <= bytes; n += 12) {
+    __m128i indices = base64_split_ssse3(
+      _mm_loadu_si128((const __m128i*)(in + n)));
+    _mm_storeu_si128((__m128i*)(out + n / 3 * 4),
+                     base64_digits_ssse3(indices));
+  }
+  return n;
+}
+
+__attribute__((target("ssse3")))
+size_t lsx_base64_decode_ssse3(const char* in, size_t chars, uint8_t* out) {
+  size_t n;
+  /* each step writes sixteen bytes, but only twelve are meant; stopping this
+     far from the end keeps the other four inside the output */
+  for(n = 0; n + 24 <= chars; n += 16) {
+    __m128i values;
+    if(!base64_values_ssse3(_mm_loadu_si128((const __m128i*)(in + n)),
+                            &values)) break;
+    _mm_storeu_si128((__m128i*)(out + n / 4 * 3), base64_join_ssse3(values));
+  }
+  return n;
+}
+
+/*** AVX2 ***/
+
+/* The same as the above, on both 128-bit halves at once */
+
+__attribute__((target("avx2")))
+static inline __m256i hex_values_avx2(__m256i c, __m256i* valid) {
+  __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+  __m256i l = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)),
+                              _mm256_set1_epi8('a'));
+  __m256i is_d = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+  __m256i is_l = _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(5)), l);
+  *valid = _mm256_or_si256(is_d, is_l);
+  return _mm256_or_si256(_mm256_and_si256(is_d, d),
+                         _mm256_and_si256(is_l, _mm256_add_epi8(l,
+                                            _mm256_set1_epi8(10))));
+}
+
+__attribute__((target("avx2")))
+size_t lsx_hex_encode_avx2(const uint8_t* in, size_t bytes, char* out) {
+  const __m256i digits = _mm256_setr_epi8(
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e',
+    'f', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd',
+    'e', 'f');
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  size_t n;
+  for(n = 0; n + 32 <= bytes; n += 32) {
+    /* unpacking works within each half, so put bytes 0-7 and 8-15 in the low
+       quarters of the halves, and 16-23 and 24-31 in the high ones */
+    __m256i x = _mm256_permute4x64_epi64(
+      _mm256_loadu_si256((const __m256i*)(in + n)), 0xD8);
+    __m256i hi = _mm256_shuffle_epi8(digits,
+      _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+    __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(x, nibble));
+    _mm256_storeu_si256((__m256i*)(out + n * 2),
+                        _mm256_unpacklo_epi8(hi, lo));
+    _mm256_storeu_si256((__m256i*)(out + n * 2 + 32),
+                        _mm256_unpackhi_epi8(hi, lo));
+  }
+  return n + lsx_hex_encode_ssse3(in + n, bytes - n, out + n * 2);
+}
+
+__attribute__((target("avx2")))
+size_t lsx_hex_decode_avx2(const char* in, size_t chars, uint8_t* out) {
+  const __m256i weights = _mm256_set1_epi16(0x0110);
+  size_t n;
+  for(n = 0; n + 64 <= chars; n += 64) {
+    __m256i valid0, valid1;
+    __m256i v0 = hex_values_avx2(_mm256_loadu_si256((const __m256i*)(in + n)),
+                                 &valid0);
+    __m256i v1 = hex_values_avx2(
+      _mm256_loadu_si256((const __m256i*)(in + n + 32)), &valid1);
+    if(_mm256_movemask_epi8(_mm256_and_si256(valid0, valid1)) != -1) break;
+    /* packing also works within each half; put the quarters back in order */
+    _mm256_storeu_si256((__m256i*)(out + n / 2), _mm256_permute4x64_epi64(
+      _mm256_packus_epi16(_mm256_maddubs_epi16(v0, weights),
+                          _mm256_maddubs_epi16(v1, weights)), 0xD8));
+  }
+  return n + lsx_hex_decode_ssse3(in + n, chars - n, out + n / 2);
+}
+
+__attribute__((target("avx2")))
+size_t lsx_base64_encode_avx2(const uint8_t* in, size_t bytes, char* out) {
+  const __m256i offsets = _mm256_setr_epi8(
+    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  size_t n;
+  /* twelve bytes for each half; the second half's sixteen-byte read is what
+     limits how close to the end this can go */
+  for(n = 0; n + 28 <= bytes; n += 24) {
+    __m256i x = _mm256_inserti128_si256(_mm256_castsi128_si256(
+      _mm_loadu_si128((const __m128i*)(in + n))),
+      _mm_loadu_si128((const __m128i*)(in + n + 12)), 1);
+    __m256i t0, t1, t2, t3, indices, range, upper;
+    x = _mm256_shuffle_epi8(x, _mm256_set_epi8(
+      10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+      10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    t0 = _mm256_and_si256(x, _mm256_set1_epi32(0x0fc0fc00));
+    t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    t2 = _mm256_and_si256(x, _mm256_set1_epi32(0x003f03f0));
+    t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    indices = _mm256_or_si256(t1, t3);
+    range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    range = _mm256_or_si256(range,
+                            _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+    _mm256_storeu_si256((__m256i*)(out + n / 3 * 4), _mm256_add_epi8(
+      _mm256_shuffle_epi8(offsets, range), indices));
+  }
+  return n + lsx_base64_encode_ssse3(in + n, bytes - n, out + n / 3 * 4);
+}
+
+__attribute__((target("avx2")))
+size_t lsx_base64_decode_avx2(const char* in, size_t chars, uint8_t* out) {
+  const __m256i lut_lo = _mm256_setr_epi8(
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,
+    0x1B, 0x1B, 0x1B, 0x1A, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+    0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m256i lut_hi = _mm256_setr_epi8(
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8(
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  size_t n;
+  /* as with SSSE3, eight of the 32 bytes written each step are junk */
+  for(n = 0; n + 48 <= chars; n += 32) {
+    __m256i c = _mm256_loadu_si256((const __m256i*)(in + n));
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi32(c, 4), nibble);
+    __m256i lo = _mm256_and_si256(c, nibble);
+    __m256i clash = _mm256_and_si256(_mm256_shuffle_epi8(lut_lo, lo),
+                                     _mm256_shuffle_epi8(lut_hi, hi));
+    __m256i values, pairs, groups;
+    if(_mm256_movemask_epi8(_mm256_cmpeq_epi8(clash,
+                                              _mm256_setzero_si256())) != -1)
+      break;
+    hi = _mm256_add_epi8(hi, _mm256_cmpeq_epi8(c, _mm256_set1_epi8('/')));
+    values = _mm256_add_epi8(c, _mm256_shuffle_epi8(lut_roll, hi));
+    pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    groups = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    groups = _mm256_shuffle_epi8(groups, _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    /* each half has twelve bytes at the bottom; close the gap */
+    _mm256_storeu_si256((__m256i*)(out + n / 4 * 3),
+                        _mm256_permutevar8x32_epi32(groups,
+                          _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7)));
+  }
+  return n + lsx_base64_decode_ssse3(in + n, chars - n, out + n / 4 * 3);
+}
+
+#endif
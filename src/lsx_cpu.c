@@ -0,0 +1,53 @@
+#include "lsx_cpu.h"
+
+#if LSX_X86
+
+#include <cpuid.h>
+#include <stddef.h> /* NULL */
+
+/* set once detection has run, so that "no features" can be cached too */
+#define DETECTED 0x80000000u
+
+static unsigned detect(void) {
+  unsigned eax, ebx, ecx, edx, max_leaf, ret = 0;
+  uint64_t xcr0 = 0;
+  max_leaf = __get_cpuid_max(0, NULL);
+  if(max_leaf < 1) return 0;
+  __cpuid(1, eax, ebx, ecx, edx);
+  if(edx & (1u << 26)) ret |= LSX_CPU_SSE2;
+  if(ecx & (1u << 9)) ret |= LSX_CPU_SSSE3;
+  if(ecx & (1u << 19)) ret |= LSX_CPU_SSE41;
+  if(ecx & (1u << 27)) {
+    /* OSXSAVE; find out which register files the OS will preserve for us */
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    xcr0 = ((uint64_t)hi << 32) | lo;
+  }
+  if(max_leaf >= 7) {
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if(ebx & (1u << 29)) ret |= LSX_CPU_SHA;
+    if(ebx & (1u << 8)) ret |= LSX_CPU_BMI2;
+    if((ebx & (1u << 5)) && (xcr0 & 0x06) == 0x06) ret |= LSX_CPU_AVX2;
+    if((ebx & (1u << 16)) && (xcr0 & 0xE6) == 0xE6) ret |= LSX_CPU_AVX512F;
+  }
+  return ret;
+}
+
+unsigned lsx_cpu_features(void) {
+  /* racing threads will all compute the same answer, so no locking needed */
+  static volatile unsigned features = 0;
+  unsigned ret = features;
+  if(!(ret & DETECTED)) {
+    ret = detect() | DETECTED;
+    features = ret;
+  }
+  return ret & ~DETECTED;
+}
+
+#else
+
+unsigned lsx_cpu_features(void) {
+  return 0;
+}
+
+#endif
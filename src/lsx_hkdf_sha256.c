@@ -0,0 +1,64 @@
+#include "lsx.h"
+
+#include <string.h> /* memcpy */
+
+void lsx_hkdf_sha256_extract(lsx_hkdf_sha256_prk* prk,
+                             const void* salt, size_t salt_bytes,
+                             const void* ikm, size_t ikm_bytes) {
+  /* No salt means a salt of 32 zeroes. HMAC pads its key with zeroes anyway,
+     so that's the same thing as an empty key and needs no special case. */
+  lsx_hmac_sha256_key salt_key;
+  uint8_t prk_bytes[SHA256_HASHBYTES];
+  lsx_setup_hmac_sha256_key(&salt_key, salt, salt_bytes);
+  lsx_calculate_hmac_sha256(&salt_key, ikm, ikm_bytes, prk_bytes);
+  lsx_setup_hmac_sha256_key(prk, prk_bytes, sizeof(prk_bytes));
+  lsx_destroy_hmac_sha256_key(&salt_key);
+  lsx_explicit_bzero(prk_bytes, sizeof(prk_bytes));
+}
+
+int lsx_hkdf_sha256_expand(const lsx_hkdf_sha256_prk* prk,
+                           const void* info, size_t info_bytes,
+                           uint8_t* out, size_t out_bytes) {
+  lsx_hmac_sha256_context ctx;
+  uint8_t t[SHA256_HASHBYTES];
+  uint8_t counter = 0;
+  if(out_bytes > LSX_HKDF_SHA256_MAX_BYTES) return 0;
+  while(out_bytes > 0) {
+    size_t n = out_bytes < sizeof(t) ? out_bytes : sizeof(t);
+    /* T(i) = HMAC-Hash(PRK, T(i-1) | info | i), with T(0) empty */
+    lsx_setup_hmac_sha256(&ctx, prk);
+    if(counter > 0) lsx_input_hmac_sha256(&ctx, t, sizeof(t));
+    if(info_bytes > 0) lsx_input_hmac_sha256(&ctx, info, info_bytes);
+    ++counter;
+    lsx_input_hmac_sha256(&ctx, &counter, 1);
+    lsx_finish_hmac_sha256(&ctx, t);
+    memcpy(out, t, n);
+    out += n;
+    out_bytes -= n;
+  }
+  lsx_destroy_hmac_sha256(&ctx);
+  lsx_explicit_bzero(t, sizeof(t));
+  return 1;
+}
+
+int lsx_hkdf_sha256_expand_twofish(const lsx_hkdf_sha256_prk* prk,
+                                   const void* info, size_t info_bytes,
+                                   lsx_twofish_context* twofish,
+                                   size_t key_bytes) {
+  uint8_t key[TWOFISH256_KEYBYTES];
+  switch(key_bytes) {
+  case TWOFISH128_KEYBYTES: case TWOFISH192_KEYBYTES:
+  case TWOFISH256_KEYBYTES:
+    break;
+  default:
+    return 0;
+  }
+  lsx_hkdf_sha256_expand(prk, info, info_bytes, key, key_bytes);
+  switch(key_bytes) {
+  case TWOFISH128_KEYBYTES: lsx_setup_twofish128(twofish, key); break;
+  case TWOFISH192_KEYBYTES: lsx_setup_twofish192(twofish, key); break;
+  default: lsx_setup_twofish256(twofish, key); break;
+  }
+  lsx_explicit_bzero(key, sizeof(key));
+  return 1;
+}
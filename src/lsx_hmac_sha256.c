@@ -0,0 +1,80 @@
+#include "lsx.h"
+
+#include <string.h> /* memcpy */
+
+#define IPAD 0x36
+#define OPAD 0x5C
+
+void lsx_setup_hmac_sha256_key(lsx_hmac_sha256_key* key,
+                               const void* key_data, size_t key_bytes) {
+  uint8_t block[SHA256_BLOCKBYTES];
+  unsigned n;
+  /* K0: the key, or its hash if it's too long, padded out with zeroes */
+  memset(block, 0, sizeof(block));
+  if(key_bytes > SHA256_BLOCKBYTES)
+    lsx_calculate_sha256_policy(key_data, key_bytes, LSX_POLICY_SECRET,
+                                block);
+  else if(key_bytes > 0)
+    memcpy(block, key_data, key_bytes);
+  for(n = 0; n < SHA256_BLOCKBYTES; ++n) block[n] ^= IPAD;
+  /* keys are secret, whatever the default; every context set up from this
+     key inherits that */
+  lsx_setup_sha256_expert(&key->inner);
+  key->inner.policy = LSX_POLICY_SECRET;
+  lsx_input_sha256_expert(&key->inner, block, 1);
+  for(n = 0; n < SHA256_BLOCKBYTES; ++n) block[n] ^= IPAD ^ OPAD;
+  lsx_setup_sha256_expert(&key->outer);
+  key->outer.policy = LSX_POLICY_SECRET;
+  lsx_input_sha256_expert(&key->outer, block, 1);
+  lsx_explicit_bzero(block, sizeof(block));
+}
+
+void lsx_setup_hmac_sha256(lsx_hmac_sha256_context* ctx,
+                           const lsx_hmac_sha256_key* key) {
+  ctx->inner.expert = key->inner;
+  ctx->inner.num_buffered_bytes = 0;
+  ctx->outer = key->outer;
+}
+
+void lsx_input_hmac_sha256(lsx_hmac_sha256_context* ctx,
+                           const void* input, size_t bytes) {
+  lsx_input_sha256(&ctx->inner, input, bytes);
+}
+
+void lsx_finish_hmac_sha256(lsx_hmac_sha256_context* ctx,
+                            uint8_t out[SHA256_HASHBYTES]) {
+  uint8_t inner_hash[SHA256_HASHBYTES];
+  lsx_finish_sha256(&ctx->inner, inner_hash);
+  lsx_finish_sha256_expert(&ctx->outer, inner_hash, sizeof(inner_hash), out);
+  lsx_explicit_bzero(inner_hash, sizeof(inner_hash));
+}
+
+void lsx_calculate_hmac_sha256(const lsx_hmac_sha256_key* key,
+                               const void* message, size_t bytes,
+                               uint8_t out[SHA256_HASHBYTES]) {
+  /* no buffering needed; whole blocks go straight from the message */
+  lsx_sha256_expert_context ctx;
+  uint8_t inner_hash[SHA256_HASHBYTES];
+  size_t blocks = bytes / SHA256_BLOCKBYTES;
+  ctx = key->inner;
+  if(blocks > 0) lsx_input_sha256_expert(&ctx, message, blocks);
+  lsx_finish_sha256_expert(&ctx,
+                           (const uint8_t*)message + blocks*SHA256_BLOCKBYTES,
+                           bytes - blocks*SHA256_BLOCKBYTES, inner_hash);
+  ctx = key->outer;
+  lsx_finish_sha256_expert(&ctx, inner_hash, sizeof(inner_hash), out);
+  lsx_destroy_sha256_expert(&ctx);
+  lsx_explicit_bzero(inner_hash, sizeof(inner_hash));
+}
+
+int lsx_verify_hmac_sha256(const lsx_hmac_sha256_key* key,
+                           const void* message, size_t bytes,
+                           const uint8_t mac[SHA256_HASHBYTES]) {
+  uint8_t expected[SHA256_HASHBYTES];
+  uint8_t diff = 0;
+  unsigned n;
+  lsx_calculate_hmac_sha256(key, message, bytes, expected);
+  for(n = 0; n < SHA256_HASHBYTES; ++n) diff |= expected[n] ^ mac[n];
+  lsx_explicit_bzero(expected, sizeof(expected));
+  return diff == 0;
+}
@@ -0,0 +1,76 @@
+#include "lsx_io.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <io.h>
+#define read_fd(fd, buf, bytes) _read(fd, buf, (unsigned)(bytes))
+/* _read takes an unsigned int count */
+#define MAX_READ 0x40000000
+#else
+#include <unistd.h>
+#define read_fd(fd, buf, bytes) read(fd, buf, bytes)
+#define MAX_READ ((size_t)-1 >> 1)
+#endif
+
+/* Each of `lsx_drain_fd`'s buffers. Big enough that per-read overhead
+   vanishes, small enough to stay in L2 cache between the reading thread and
+   the other one. */
+#define READ_BUFFER_BYTES (1 << 20)
+
+size_t lsx_read_fully(int fd, void* buf, size_t bytes) {
+  size_t got = 0;
+  while(got < bytes) {
+    size_t want = bytes - got < MAX_READ ? bytes - got : MAX_READ;
+    long red = (long)read_fd(fd, (uint8_t*)buf + got, want);
+    if(red < 0) {
+      if(errno == EINTR) continue;
+      return (size_t)-1;
+    }
+    if(red == 0) break;
+    got += (size_t)red;
+  }
+  return got;
+}
+
+struct fd_drainer {
+  int fd;
+  /* errno from the read that failed */
+  int error;
+  lsx_drain_func drain;
+  void* arg;
+};
+
+static size_t fill_from_fd(void* arg, void* buf, size_t bytes) {
+  struct fd_drainer* d = (struct fd_drainer*)arg;
+  size_t got = lsx_read_fully(d->fd, buf, bytes);
+  if(got == (size_t)-1) d->error = errno;
+  return got;
+}
+
+static void drain_for_fd(void* arg, const void* buf, size_t bytes) {
+  struct fd_drainer* d = (struct fd_drainer*)arg;
+  d->drain(d->arg, buf, bytes);
+}
+
+int lsx_drain_fd(int fd, lsx_drain_func drain, void* arg) {
+  struct fd_drainer d;
+  void* bufs[2];
+  int ret;
+  bufs[0] = malloc(READ_BUFFER_BYTES * 2);
+  if(bufs[0] == NULL) {
+    errno = ENOMEM;
+    return 0;
+  }
+  bufs[1] = (uint8_t*)bufs[0] + READ_BUFFER_BYTES;
+  d.fd = fd;
+  d.error = 0;
+  d.drain = drain;
+  d.arg = arg;
+  ret = lsx_double_buffer(bufs, READ_BUFFER_BYTES, fill_from_fd, drain_for_fd,
+                          &d);
+  lsx_explicit_bzero(bufs[0], READ_BUFFER_BYTES * 2);
+  free(bufs[0]);
+  if(!ret) errno = d.error;
+  return ret;
+}
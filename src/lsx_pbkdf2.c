@@ -0,0 +1,200 @@
+#include "lsx.h"
+#include "lsx_sha256_kernels.h"
+
+#include <string.h> /* memcpy, memset */
+
+/* sha256 is big-endian */
+#define bytes_to_word(p) (((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) | ((uint32_t)(p)[2] << 8) | (uint32_t)(p)[3])
+#define word_to_bytes(word, p) ((p)[0] = (uint8_t)((word)>>24), (p)[1] = (uint8_t)((word)>>16), (p)[2] = (uint8_t)((word)>>8), (p)[3] = (uint8_t)(word))
+
+/* Every hash in the iteration loop, inner or outer, is of one block of key
+   pad (already in the midstate) plus one 32-byte digest. So each is exactly
+   one more block, with fixed padding: the digest, 0x80, zeroes, and a length
+   of 768 bits. Only the digest part ever changes. */
+#define LOOP_MESSAGE_BITS ((SHA256_BLOCKBYTES + SHA256_HASHBYTES) * 8)
+
+/* One output block of one derivation */
+struct pbkdf2_job {
+  const lsx_hmac_sha256_key* key;
+  const void* salt;
+  size_t salt_bytes;
+  uint32_t index;
+  uint8_t* out;
+  size_t out_bytes;
+};
+
+/* Up to LSX_SHA256_MAX_LANES jobs running in lockstep. Word `i` of lane `l`
+   is at `[i * lanes + l]`, as the lanes kernels want. */
+struct pbkdf2_lanes {
+  uint32_t inner[8 * LSX_SHA256_MAX_LANES];
+  uint32_t outer[8 * LSX_SHA256_MAX_LANES];
+  uint32_t t[8 * LSX_SHA256_MAX_LANES];
+  uint32_t state[8 * LSX_SHA256_MAX_LANES];
+  uint8_t block[LSX_SHA256_MAX_LANES][SHA256_BLOCKBYTES];
+};
+
+static void start_lane(struct pbkdf2_lanes* st, unsigned lanes, unsigned l,
+                       const struct pbkdf2_job* job) {
+  lsx_hmac_sha256_context ctx;
+  uint8_t index[4];
+  uint8_t* block = st->block[l];
+  unsigned i;
+  /* U1 = HMAC(P, S || INT(i)) is the only iteration with a variable-length
+     message, so it goes through the normal path */
+  word_to_bytes(job->index, index);
+  lsx_setup_hmac_sha256(&ctx, job->key);
+  lsx_input_hmac_sha256(&ctx, job->salt, job->salt_bytes);
+  lsx_input_hmac_sha256(&ctx, index, sizeof(index));
+  lsx_finish_hmac_sha256(&ctx, block);
+  lsx_destroy_hmac_sha256(&ctx);
+  memset(block + SHA256_HASHBYTES, 0, SHA256_BLOCKBYTES - SHA256_HASHBYTES);
+  block[SHA256_HASHBYTES] = 0x80;
+  block[SHA256_BLOCKBYTES - 2] = (uint8_t)(LOOP_MESSAGE_BITS >> 8);
+  block[SHA256_BLOCKBYTES - 1] = (uint8_t)LOOP_MESSAGE_BITS;
+  for(i = 0; i < 8; ++i) {
+    st->inner[i * lanes + l] = job->key->inner.h[i];
+    st->outer[i * lanes + l] = job->key->outer.h[i];
+    st->t[i * lanes + l] = bytes_to_word(block + i * 4);
+  }
+}
+
+static void compress_lanes(struct pbkdf2_lanes* st,
+                           lsx_sha256_lanes_func kernel, unsigned lanes,
+                           const uint8_t* const* blocks,
+                           const uint32_t* midstate) {
+  unsigned i, l;
+  memcpy(st->state, midstate, sizeof(uint32_t) * 8 * lanes);
+  if(kernel) kernel(st->state, blocks, 1);
+  else lsx_sha256_compress(st->state, blocks[0], 1, LSX_POLICY_SECRET);
+  for(l = 0; l < lanes; ++l) {
+    for(i = 0; i < 8; ++i)
+      word_to_bytes(st->state[i * lanes + l], st->block[l] + i * 4);
+  }
+}
+
+/* Run `count` jobs in parallel. `kernel` may be NULL, in which case `lanes`
+   and `count` must be 1. Lanes past `count` churn on zeroes. */
+static void run_lanes(lsx_sha256_lanes_func kernel, unsigned lanes,
+                      const struct pbkdf2_job* jobs, unsigned count,
+                      uint32_t iterations) {
+  struct pbkdf2_lanes st;
+  const uint8_t* blocks[LSX_SHA256_MAX_LANES];
+  uint8_t t[SHA256_HASHBYTES];
+  uint32_t n;
+  unsigned i, l;
+  memset(&st, 0, sizeof(st));
+  for(l = 0; l < lanes; ++l) {
+    if(l < count) start_lane(&st, lanes, l, jobs + l);
+    blocks[l] = st.block[l];
+  }
+  for(n = 1; n < iterations; ++n) {
+    compress_lanes(&st, kernel, lanes, blocks, st.inner);
+    compress_lanes(&st, kernel, lanes, blocks, st.outer);
+    for(i = 0; i < 8 * lanes; ++i) st.t[i] ^= st.state[i];
+  }
+  for(l = 0; l < count; ++l) {
+    for(i = 0; i < 8; ++i) word_to_bytes(st.t[i * lanes + l], t + i * 4);
+    memcpy(jobs[l].out, t, jobs[l].out_bytes);
+  }
+  lsx_explicit_bzero(&st, sizeof(st));
+  lsx_explicit_bzero(t, sizeof(t));
+}
+
+/* Up to LSX_SHA256_MAX_LANES jobs. Idle lanes cost as much as busy ones, so
+   a mostly-empty batch is faster one job at a time. */
+static void run_jobs(const struct pbkdf2_job* jobs, unsigned count,
+                     uint32_t iterations) {
+  unsigned lanes, n;
+  lsx_sha256_lanes_func kernel = lsx_sha256_get_lanes_kernel(&lanes);
+  while(kernel && count * 2 > lanes) {
+    n = count < lanes ? count : lanes;
+    run_lanes(kernel, lanes, jobs, n, iterations);
+    jobs += n;
+    count -= n;
+  }
+  for(n = 0; n < count; ++n) run_lanes(NULL, 1, jobs + n, 1, iterations);
+}
+
+void lsx_pbkdf2_hmac_sha256(const void* password, size_t password_bytes,
+                            const void* salt, size_t salt_bytes,
+                            uint32_t iterations,
+                            uint8_t* out, size_t out_bytes) {
+  lsx_hmac_sha256_key key;
+  struct pbkdf2_job jobs[LSX_SHA256_MAX_LANES];
+  unsigned count = 0;
+  uint32_t index = 1;
+  lsx_setup_hmac_sha256_key(&key, password, password_bytes);
+  while(out_bytes > 0) {
+    struct pbkdf2_job* job = jobs + count++;
+    job->key = &key;
+    job->salt = salt;
+    job->salt_bytes = salt_bytes;
+    job->index = index++;
+    job->out = out;
+    job->out_bytes = out_bytes < SHA256_HASHBYTES ? out_bytes
+      : SHA256_HASHBYTES;
+    out += job->out_bytes;
+    out_bytes -= job->out_bytes;
+    if(count == LSX_SHA256_MAX_LANES || out_bytes == 0) {
+      run_jobs(jobs, count, iterations);
+      count = 0;
+    }
+  }
+  lsx_destroy_hmac_sha256_key(&key);
+}
+
+void lsx_pbkdf2_hmac_sha256_many(const void* const passwords[],
+                                 const size_t password_lens[],
+                                 const void* const salts[],
+                                 const size_t salt_lens[],
+                                 size_t count, uint32_t iterations,
+                                 uint8_t (*out)[SHA256_HASHBYTES]) {
+  lsx_hmac_sha256_key keys[LSX_SHA256_MAX_LANES];
+  struct pbkdf2_job jobs[LSX_SHA256_MAX_LANES];
+  size_t n;
+  unsigned batch = 0;
+  for(n = 0; n < count; ++n) {
+    struct pbkdf2_job* job = jobs + batch;
+    lsx_setup_hmac_sha256_key(keys + batch, passwords[n], password_lens[n]);
+    job->key = keys + batch;
+    job->salt = salts[n];
+    job->salt_bytes = salt_lens[n];
+    job->index = 1;
+    job->out = out[n];
+    job->out_bytes = SHA256_HASHBYTES;
+    if(++batch == LSX_SHA256_MAX_LANES || n + 1 == count) {
+      run_jobs(jobs, batch, iterations);
+      batch = 0;
+    }
+  }
+  lsx_explicit_bzero(keys, sizeof(keys));
+}
+
+size_t lsx_verify_pbkdf2_hmac_sha256_many(const void* const passwords[],
+                                          const size_t password_lens[],
+                                          const void* const salts[],
+                                          const size_t salt_lens[],
+                                          size_t count, uint32_t iterations,
+                                          const uint8_t
+                                          (*expected)[SHA256_HASHBYTES],
+                                          int results[]) {
+  uint8_t derived[LSX_SHA256_MAX_LANES][SHA256_HASHBYTES];
+  size_t n, batch, matches = 0;
+  unsigned m, i;
+  for(n = 0; n < count; n += batch) {
+    batch = count - n;
+    if(batch > LSX_SHA256_MAX_LANES) batch = LSX_SHA256_MAX_LANES;
+    lsx_pbkdf2_hmac_sha256_many(passwords + n, password_lens + n,
+                                salts + n, salt_lens + n, batch, iterations,
+                                derived);
+    for(m = 0; m < batch; ++m) {
+      uint8_t diff = 0;
+      for(i = 0; i < SHA256_HASHBYTES; ++i)
+        diff |= derived[m][i] ^ expected[n + m][i];
+      results[n + m] = diff == 0;
+      matches += diff == 0;
+    }
+  }
+  lsx_explicit_bzero(derived, sizeof(derived));
+  return matches;
+}
@@ -1,6 +1,7 @@
 #include "lsx.h"
+#include "lsx_sha256_kernels.h"
 
-#include <string.h> /* memcpy */
+#include <string.h> /* memcpy, memset */
 #include <assert.h>
 
 /* sha256 is big-endian */
@@ -11,7 +12,21 @@
 #define rotate_right(a,i) (((a)>>i)|((a)<<(32-i)))
 #define rotate_left(a,i) (((a)<<i)|((a)>>(32-i)))
 
-static uint32_t k[64] = {
+/* A faster bytes_to_word, where the compiler lets us have one */
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__BYTE_ORDER__)
+# if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#  define load_be32(p) (memcpy(&load_tmp, (p), 4), load_tmp)
+# else
+#  define load_be32(p) (memcpy(&load_tmp, (p), 4), __builtin_bswap32(load_tmp))
+# endif
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+# include <intrin.h>
+# define load_be32(p) (memcpy(&load_tmp, (p), 4), _byteswap_ulong(load_tmp))
+#else
+# define load_be32(p) bytes_to_word(p)
+#endif
+
+const uint32_t lsx_sha256_k[64] = {
   0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
   0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
   0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
@@ -25,30 +40,28 @@ static uint32_t k[64] = {
   0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
 };
 
+const uint32_t lsx_sha256_iv[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
 void lsx_setup_sha256_expert(lsx_sha256_expert_context* ctx) {
-  ctx->h[0] = 0x6a09e667;
-  ctx->h[1] = 0xbb67ae85;
-  ctx->h[2] = 0x3c6ef372;
-  ctx->h[3] = 0xa54ff53a;
-  ctx->h[4] = 0x510e527f;
-  ctx->h[5] = 0x9b05688c;
-  ctx->h[6] = 0x1f83d9ab;
-  ctx->h[7] = 0x5be0cd19;
+  memcpy(ctx->h, lsx_sha256_iv, sizeof(ctx->h));
   ctx->bytes_so_far = 0;
+  ctx->policy = LSX_DEFAULT_POLICY;
 }
 
-void lsx_input_sha256_expert(lsx_sha256_expert_context* ctx,
-                             const void* _input, size_t blocks) {
+/* The original, straightforward kernel. Works everywhere. */
+static void sha256_blocks_scalar(uint32_t H[8], const uint8_t* input,
+                                 size_t blocks, int wipe) {
   /* these don't get sanitized because I can't bring myself to slow it down
      that much (and needlessly) on register-heavy architectures, so we'll put
      them as low on the stack as possible to improve their odds of being
      stomped */
-  uint32_t a = ctx->h[0], b = ctx->h[1], c = ctx->h[2], d = ctx->h[3];
-  uint32_t e = ctx->h[4], f = ctx->h[5], g = ctx->h[6], h = ctx->h[7];
+  uint32_t a = H[0], b = H[1], c = H[2], d = H[3];
+  uint32_t e = H[4], f = H[5], g = H[6], h = H[7];
   uint32_t s0, s1;
   uint32_t w[64];
-  const uint8_t* input = (const uint8_t*)_input;
-  ctx->bytes_so_far += blocks * SHA256_BLOCKBYTES;
   while(blocks-- > 0) {
     unsigned i;
     for(i = 0; i < 16; ++i)
@@ -61,18 +74,157 @@ void lsx_input_sha256_expert(lsx_sha256_expert_context* ctx,
     }
     for(i = 0; i < 64; ++i) {
       s1 = (rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25))
-        + h + ((e & f) ^ (~e & g)) + k[i] + w[i];
+        + h + ((e & f) ^ (~e & g)) + lsx_sha256_k[i] + w[i];
       s0 = (rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22))
         + ((a & b) ^ (a & c) ^ (b & c));
       h = g; g = f; f = e; e = d + s1;
       d = c; c = b; b = a; a = s0 + s1;
     }
-    ctx->h[0] = (a += ctx->h[0]); ctx->h[1] = (b += ctx->h[1]);
-    ctx->h[2] = (c += ctx->h[2]); ctx->h[3] = (d += ctx->h[3]);
-    ctx->h[4] = (e += ctx->h[4]); ctx->h[5] = (f += ctx->h[5]);
-    ctx->h[6] = (g += ctx->h[6]); ctx->h[7] = (h += ctx->h[7]);
+    H[0] = (a += H[0]); H[1] = (b += H[1]);
+    H[2] = (c += H[2]); H[3] = (d += H[3]);
+    H[4] = (e += H[4]); H[5] = (f += H[5]);
+    H[6] = (g += H[6]); H[7] = (h += H[7]);
+  }
+  if(wipe) lsx_explicit_bzero(w, sizeof(w));
+}
+
+/* The same thing, optimized: all 64 rounds unrolled, the message schedule
+   computed sixteen words at a time as the rounds need it, and no shuffling of
+   the working variables (each round instead renames them). */
+#define Sigma0(x) (rotate_right(x,2) ^ rotate_right(x,13) ^ rotate_right(x,22))
+#define Sigma1(x) (rotate_right(x,6) ^ rotate_right(x,11) ^ rotate_right(x,25))
+#define sigma0(x) (rotate_right(x,7) ^ rotate_right(x,18) ^ ((x)>>3))
+#define sigma1(x) (rotate_right(x,17) ^ rotate_right(x,19) ^ ((x)>>10))
+#define Ch(e,f,g) ((g) ^ ((e) & ((f) ^ (g))))
+#define Maj(a,b,c) (((a) & (b)) | ((c) & ((a) | (b))))
+/* round i (mod 16) of the sixteen starting at round j */
+#define ROUND(a,b,c,d,e,f,g,h,i,j) \
+  t = h + Sigma1(e) + Ch(e,f,g) + lsx_sha256_k[(i)+(j)] + w[i]; \
+  d += t; \
+  h = t + Sigma0(a) + Maj(a,b,c)
+#define LOAD(i) w[i] = load_be32(input + (i) * 4)
+#define SCHEDULE(i) \
+  w[i] += sigma0(w[((i)+1)&15]) + w[((i)+9)&15] + sigma1(w[((i)+14)&15])
+#define SIXTEEN_ROUNDS(j, PREP) \
+  PREP(0); ROUND(a,b,c,d,e,f,g,h,0,j); PREP(1); ROUND(h,a,b,c,d,e,f,g,1,j); \
+  PREP(2); ROUND(g,h,a,b,c,d,e,f,2,j); PREP(3); ROUND(f,g,h,a,b,c,d,e,3,j); \
+  PREP(4); ROUND(e,f,g,h,a,b,c,d,4,j); PREP(5); ROUND(d,e,f,g,h,a,b,c,5,j); \
+  PREP(6); ROUND(c,d,e,f,g,h,a,b,6,j); PREP(7); ROUND(b,c,d,e,f,g,h,a,7,j); \
+  PREP(8); ROUND(a,b,c,d,e,f,g,h,8,j); PREP(9); ROUND(h,a,b,c,d,e,f,g,9,j); \
+  PREP(10); ROUND(g,h,a,b,c,d,e,f,10,j); PREP(11); ROUND(f,g,h,a,b,c,d,e,11,j); \
+  PREP(12); ROUND(e,f,g,h,a,b,c,d,12,j); PREP(13); ROUND(d,e,f,g,h,a,b,c,13,j); \
+  PREP(14); ROUND(c,d,e,f,g,h,a,b,14,j); PREP(15); ROUND(b,c,d,e,f,g,h,a,15,j)
+static void sha256_blocks_unrolled(uint32_t H[8], const uint8_t* input,
+                                   size_t blocks, int wipe) {
+  uint32_t a, b, c, d, e, f, g, h, t;
+  uint32_t w[16];
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+  uint32_t load_tmp;
+#endif
+  while(blocks-- > 0) {
+    a = H[0]; b = H[1]; c = H[2]; d = H[3];
+    e = H[4]; f = H[5]; g = H[6]; h = H[7];
+    SIXTEEN_ROUNDS(0, LOAD);
+    SIXTEEN_ROUNDS(16, SCHEDULE);
+    SIXTEEN_ROUNDS(32, SCHEDULE);
+    SIXTEEN_ROUNDS(48, SCHEDULE);
+    input += SHA256_BLOCKBYTES;
+    H[0] += a; H[1] += b; H[2] += c; H[3] += d;
+    H[4] += e; H[5] += f; H[6] += g; H[7] += h;
+  }
+  if(wipe) lsx_explicit_bzero(w, sizeof(w));
+}
+#undef Sigma0
+#undef Sigma1
+#undef sigma0
+#undef sigma1
+#undef Ch
+#undef Maj
+#undef ROUND
+#undef LOAD
+#undef SCHEDULE
+#undef SIXTEEN_ROUNDS
+
+#if LSX_X86
+/* The AVX2 kernel only pays off when it has at least two blocks to schedule
+   at once */
+#define AVX2_MIN_BLOCKS 2
+static void sha256_blocks_avx2(uint32_t h[8], const uint8_t* input,
+                               size_t blocks, int wipe) {
+  if(blocks < AVX2_MIN_BLOCKS) sha256_blocks_unrolled(h, input, blocks, wipe);
+  else lsx_sha256_blocks_avx2(h, input, blocks, wipe);
+}
+#endif
+
+static void sha256_blocks_resolve(uint32_t h[8], const uint8_t* input,
+                                  size_t blocks, int wipe);
+/* Starts out pointing at a function that picks the best kernel and then calls
+   it, so that the CPU is only examined on first use. */
+static lsx_sha256_blocks_func sha256_blocks = sha256_blocks_resolve;
+static int sha256_impl = LSX_SHA256_IMPL_AUTO;
+
+int lsx_set_sha256_implementation(int impl) {
+  if(impl == LSX_SHA256_IMPL_AUTO) {
+#if LSX_X86
+    if(lsx_set_sha256_implementation(LSX_SHA256_IMPL_SHANI)) return 1;
+    if(lsx_set_sha256_implementation(LSX_SHA256_IMPL_AVX2)) return 1;
+    /* the SSSE3 kernel is slower than the unrolled one on the machines we've
+       measured, so it's never picked automatically */
+#endif
+    return lsx_set_sha256_implementation(LSX_SHA256_IMPL_UNROLLED);
+  }
+  switch(impl) {
+  case LSX_SHA256_IMPL_SCALAR:
+    sha256_blocks = sha256_blocks_scalar;
+    break;
+  case LSX_SHA256_IMPL_UNROLLED:
+    sha256_blocks = sha256_blocks_unrolled;
+    break;
+#if LSX_X86
+  case LSX_SHA256_IMPL_SHANI:
+    if((lsx_cpu_features() & (LSX_CPU_SHA | LSX_CPU_SSE41))
+       != (LSX_CPU_SHA | LSX_CPU_SSE41)) return 0;
+    sha256_blocks = lsx_sha256_blocks_shani;
+    break;
+  case LSX_SHA256_IMPL_SSSE3:
+    if(!(lsx_cpu_features() & LSX_CPU_SSSE3)) return 0;
+    sha256_blocks = lsx_sha256_blocks_ssse3;
+    break;
+  case LSX_SHA256_IMPL_AVX2:
+    if((lsx_cpu_features() & (LSX_CPU_AVX2 | LSX_CPU_BMI2))
+       != (LSX_CPU_AVX2 | LSX_CPU_BMI2)) return 0;
+    sha256_blocks = sha256_blocks_avx2;
+    break;
+#endif
+  default:
+    return 0;
   }
-  lsx_explicit_bzero(w, sizeof(w));
+  sha256_impl = impl;
+  return 1;
+}
+
+int lsx_get_sha256_implementation(void) {
+  if(sha256_impl == LSX_SHA256_IMPL_AUTO)
+    lsx_set_sha256_implementation(LSX_SHA256_IMPL_AUTO);
+  return sha256_impl;
+}
+
+static void sha256_blocks_resolve(uint32_t h[8], const uint8_t* input,
+                                  size_t blocks, int wipe) {
+  lsx_set_sha256_implementation(LSX_SHA256_IMPL_AUTO);
+  sha256_blocks(h, input, blocks, wipe);
+}
+
+void lsx_sha256_compress(uint32_t h[8], const uint8_t* input, size_t blocks,
+                         int policy) {
+  sha256_blocks(h, input, blocks, policy != LSX_POLICY_PUBLIC);
+}
+
+void lsx_input_sha256_expert(lsx_sha256_expert_context* ctx,
+                             const void* input, size_t blocks) {
+  ctx->bytes_so_far += blocks * SHA256_BLOCKBYTES;
+  sha256_blocks(ctx->h, (const uint8_t*)input, blocks,
+                ctx->policy != LSX_POLICY_PUBLIC);
 }
 
 void lsx_finish_sha256_expert(lsx_sha256_expert_context* ctx,
@@ -91,19 +243,19 @@ void lsx_finish_sha256_expert(lsx_sha256_expert_context* ctx,
   memcpy(buf, input, bytes);
   buf[bytes] = 0x80;
   if(bytes > SHA256_BLOCKBYTES - 9) {
-    lsx_explicit_bzero(buf + bytes + 1, 64 - bytes - 1);
+    memset(buf + bytes + 1, 0, 64 - bytes - 1);
     lsx_input_sha256_expert(ctx, buf, 1);
-    lsx_explicit_bzero(buf, bytes + 1);
+    memset(buf, 0, bytes + 1);
   }
   else {
-    lsx_explicit_bzero(buf + bytes + 1, 64 - 8 - bytes - 1);
+    memset(buf + bytes + 1, 0, 64 - 8 - bytes - 1);
   }
   int64_to_bytes(actual_bits_out, buf + SHA256_BLOCKBYTES - 8);
   lsx_input_sha256_expert(ctx, buf, 1);
   for(i = 0; i < 8; ++i) {
     word_to_bytes(ctx->h[i], out + i * 4);
   }
-  lsx_explicit_bzero(buf, sizeof(buf));
+  if(ctx->policy != LSX_POLICY_PUBLIC) lsx_explicit_bzero(buf, sizeof(buf));
 }
 
 void lsx_setup_sha256(lsx_sha256_context* ctx) {
@@ -142,6 +294,55 @@ void lsx_input_sha256(lsx_sha256_context* ctx,
   }
 }
 
+void lsx_input_sha256v(lsx_sha256_context* ctx,
+                       const lsx_iovec* iov, int cnt) {
+  int n;
+  for(n = 0; n < cnt; ++n) {
+    const uint8_t* p = (const uint8_t*)iov[n].iov_base;
+    size_t bytes = iov[n].iov_len;
+    if(ctx->num_buffered_bytes) {
+      /* top up the straddling block first */
+      size_t bytes_to_add = SHA256_BLOCKBYTES - ctx->num_buffered_bytes;
+      if(bytes_to_add > bytes) bytes_to_add = bytes;
+      memcpy(ctx->buf + ctx->num_buffered_bytes, p, bytes_to_add);
+      ctx->num_buffered_bytes += bytes_to_add;
+      p += bytes_to_add;
+      bytes -= bytes_to_add;
+      if(ctx->num_buffered_bytes < SHA256_BLOCKBYTES) continue;
+      lsx_input_sha256_expert(&ctx->expert, ctx->buf, 1);
+      ctx->num_buffered_bytes = 0;
+    }
+    if(bytes >= SHA256_BLOCKBYTES) {
+      size_t blocks = bytes / SHA256_BLOCKBYTES;
+      lsx_input_sha256_expert(&ctx->expert, p, blocks);
+      p += SHA256_BLOCKBYTES * blocks;
+      bytes -= SHA256_BLOCKBYTES * blocks;
+    }
+    if(bytes > 0) {
+      memcpy(ctx->buf, p, bytes);
+      ctx->num_buffered_bytes = bytes;
+    }
+  }
+}
+
+/* Small enough that a piece (both copies of it) is still in L1 when it's
+   hashed, big enough that the per-piece overhead doesn't matter */
+#define COPY_PIECE_BYTES (SHA256_BLOCKBYTES * 64)
+
+void lsx_sha256_copy_input(lsx_sha256_context* ctx, void* dst,
+                           const void* src, size_t bytes) {
+  uint8_t* d = (uint8_t*)dst;
+  const uint8_t* s = (const uint8_t*)src;
+  while(bytes > 0) {
+    size_t piece = bytes < COPY_PIECE_BYTES ? bytes : COPY_PIECE_BYTES;
+    memcpy(d, s, piece);
+    lsx_input_sha256(ctx, d, piece);
+    d += piece;
+    s += piece;
+    bytes -= piece;
+  }
+}
+
 void lsx_finish_sha256(lsx_sha256_context* ctx,
                        uint8_t out[SHA256_HASHBYTES]) {
   lsx_finish_sha256_expert(&ctx->expert,
@@ -149,11 +350,246 @@ void lsx_finish_sha256(lsx_sha256_context* ctx,
                            out);
 }
 
-void lsx_calculate_sha256(const void* message, size_t bytes,
-                          uint8_t out[SHA256_HASHBYTES]) {
+#define STATE_VERSION 1
+#define STATE_KIND_EXPERT 1
+#define STATE_KIND_EASY 2
+
+static void export_state(const lsx_sha256_expert_context* ctx, uint8_t kind,
+                         unsigned buffered, uint8_t* out) {
+  unsigned i;
+  memcpy(out, "lsxS", 4);
+  out[4] = STATE_VERSION;
+  out[5] = kind;
+  out[6] = (uint8_t)buffered;
+  out[7] = 0;
+  for(i = 0; i < 8; ++i) word_to_bytes(ctx->h[i], out + 8 + i * 4);
+  int64_to_bytes(ctx->bytes_so_far, out + 40);
+}
+
+void lsx_export_sha256_expert(const lsx_sha256_expert_context* ctx,
+                              uint8_t out[LSX_SHA256_EXPERT_STATE_BYTES]) {
+  export_state(ctx, STATE_KIND_EXPERT, 0, out);
+}
+
+void lsx_export_sha256(const lsx_sha256_context* ctx,
+                       uint8_t out[LSX_SHA256_STATE_BYTES]) {
+  uint8_t* buf = out + LSX_SHA256_EXPERT_STATE_BYTES;
+  export_state(&ctx->expert, STATE_KIND_EASY, ctx->num_buffered_bytes, out);
+  memcpy(buf, ctx->buf, ctx->num_buffered_bytes);
+  memset(buf + ctx->num_buffered_bytes, 0,
+         SHA256_BLOCKBYTES - ctx->num_buffered_bytes);
+}
+
+/* Returns the kind, or 0 if the header or byte count is bad */
+static int import_state(lsx_sha256_expert_context* ctx, const uint8_t* in,
+                        size_t in_bytes) {
+  uint64_t bytes_so_far = 0;
+  unsigned i;
+  if(in_bytes < LSX_SHA256_EXPERT_STATE_BYTES || memcmp(in, "lsxS", 4)
+     || in[4] != STATE_VERSION || in[7] != 0) return 0;
+  switch(in[5]) {
+  case STATE_KIND_EXPERT:
+    if(in_bytes != LSX_SHA256_EXPERT_STATE_BYTES || in[6] != 0) return 0;
+    break;
+  case STATE_KIND_EASY:
+    if(in_bytes != LSX_SHA256_STATE_BYTES || in[6] >= SHA256_BLOCKBYTES)
+      return 0;
+    break;
+  default:
+    return 0;
+  }
+  for(i = 0; i < 8; ++i) bytes_so_far = (bytes_so_far << 8) | in[40 + i];
+  if(bytes_so_far % SHA256_BLOCKBYTES) return 0;
+  for(i = 0; i < 8; ++i) ctx->h[i] = bytes_to_word(in + 8 + i * 4);
+  ctx->bytes_so_far = bytes_so_far;
+  ctx->policy = LSX_DEFAULT_POLICY;
+  return in[5];
+}
+
+int lsx_import_sha256_expert(lsx_sha256_expert_context* ctx,
+                             const uint8_t* in, size_t in_bytes) {
+  return import_state(ctx, in, in_bytes) == STATE_KIND_EXPERT;
+}
+
+int lsx_import_sha256(lsx_sha256_context* ctx,
+                      const uint8_t* in, size_t in_bytes) {
+  lsx_sha256_expert_context expert;
+  switch(import_state(&expert, in, in_bytes)) {
+  case STATE_KIND_EXPERT:
+    ctx->num_buffered_bytes = 0;
+    break;
+  case STATE_KIND_EASY:
+    ctx->num_buffered_bytes = in[6];
+    memcpy(ctx->buf, in + LSX_SHA256_EXPERT_STATE_BYTES, in[6]);
+    break;
+  default:
+    return 0;
+  }
+  ctx->expert = expert;
+  lsx_explicit_bzero(&expert, sizeof(expert));
+  return 1;
+}
+
+void lsx_calculate_sha256_policy(const void* message, size_t bytes,
+                                 int policy,
+                                 uint8_t out[SHA256_HASHBYTES]) {
   lsx_sha256_expert_context ctx;
   lsx_setup_sha256_expert(&ctx);
+  ctx.policy = policy;
   lsx_finish_sha256_expert(&ctx, message, bytes, out);
-  lsx_destroy_sha256_expert(&ctx);
+  if(policy != LSX_POLICY_PUBLIC) lsx_destroy_sha256_expert(&ctx);
 }
 
+void lsx_calculate_sha256(const void* message, size_t bytes,
+                          uint8_t out[SHA256_HASHBYTES]) {
+  lsx_calculate_sha256_policy(message, bytes, LSX_DEFAULT_POLICY, out);
+}
+
+/* One lane of the multi-buffer driver */
+struct sha256_lane {
+  /* whole blocks of message data still to go, and where they are */
+  const uint8_t* p;
+  size_t full_blocks;
+  /* the padded last one or two blocks, and how many of them are left */
+  uint8_t tail[SHA256_BLOCKBYTES * 2];
+  unsigned tail_blocks, tail_left;
+  /* which message this lane is working on */
+  size_t msg;
+};
+
+/* Hash `count` messages with a lanes kernel. Whenever a lane finishes its
+   message, it picks up the next unstarted one, so that messages of very
+   different lengths still keep every lane busy until the batch is nearly
+   done. */
+static void sha256_many_lanes(lsx_sha256_lanes_func kernel, unsigned lanes,
+                              const void* const msgs[], const size_t lens[],
+                              size_t count, int policy,
+                              uint8_t (*out)[SHA256_HASHBYTES]) {
+  static const uint8_t idle_block[SHA256_BLOCKBYTES] = {0};
+  struct sha256_lane lane[LSX_SHA256_MAX_LANES];
+  uint32_t state[8 * LSX_SHA256_MAX_LANES];
+  const uint8_t* blocks[LSX_SHA256_MAX_LANES];
+  size_t next = 0;
+  unsigned l, i, active = 0;
+  for(l = 0; l < lanes; ++l) lane[l].msg = SIZE_MAX;
+  while(1) {
+    for(l = 0; l < lanes; ++l) {
+      if(lane[l].msg == SIZE_MAX && next < count) {
+        struct sha256_lane* ln = lane + l;
+        size_t len = lens[next];
+        size_t rem = len % SHA256_BLOCKBYTES;
+        uint64_t bits = (uint64_t)len * 8;
+        ln->msg = next++;
+        ln->p = (const uint8_t*)msgs[ln->msg];
+        ln->full_blocks = len / SHA256_BLOCKBYTES;
+        ln->tail_blocks = ln->tail_left = rem > SHA256_BLOCKBYTES - 9 ? 2 : 1;
+        if(rem) memcpy(ln->tail, ln->p + len - rem, rem);
+        ln->tail[rem] = 0x80;
+        memset(ln->tail + rem + 1, 0,
+               SHA256_BLOCKBYTES * ln->tail_blocks - rem - 1 - 8);
+        int64_to_bytes(bits, ln->tail + SHA256_BLOCKBYTES * ln->tail_blocks
+                       - 8);
+        for(i = 0; i < 8; ++i) state[i * lanes + l] = lsx_sha256_iv[i];
+        ++active;
+      }
+    }
+    if(active == 0) break;
+    for(l = 0; l < lanes; ++l) {
+      struct sha256_lane* ln = lane + l;
+      if(ln->msg == SIZE_MAX) blocks[l] = idle_block;
+      else if(ln->full_blocks > 0) blocks[l] = ln->p;
+      else blocks[l] = ln->tail
+             + (ln->tail_blocks - ln->tail_left) * SHA256_BLOCKBYTES;
+    }
+    kernel(state, blocks, policy != LSX_POLICY_PUBLIC);
+    for(l = 0; l < lanes; ++l) {
+      struct sha256_lane* ln = lane + l;
+      if(ln->msg == SIZE_MAX) continue;
+      if(ln->full_blocks > 0) {
+        ln->p += SHA256_BLOCKBYTES;
+        --ln->full_blocks;
+        continue;
+      }
+      if(--ln->tail_left > 0) continue;
+      for(i = 0; i < 8; ++i)
+        word_to_bytes(state[i * lanes + l], out[ln->msg] + i * 4);
+      ln->msg = SIZE_MAX;
+      --active;
+    }
+  }
+  if(policy != LSX_POLICY_PUBLIC) {
+    lsx_explicit_bzero(lane, sizeof(lane));
+    lsx_explicit_bzero(state, sizeof(state));
+  }
+}
+
+static int sha256_many_impl = LSX_SHA256_MANY_AUTO;
+
+int lsx_set_sha256_many_implementation(int impl) {
+  if(impl == LSX_SHA256_MANY_AUTO) {
+    /* the SHA extensions beat eight AVX2 lanes, even on short messages */
+    if(lsx_get_sha256_implementation() == LSX_SHA256_IMPL_SHANI)
+      return lsx_set_sha256_many_implementation(LSX_SHA256_MANY_SERIAL);
+    if(lsx_set_sha256_many_implementation(LSX_SHA256_MANY_AVX2)) return 1;
+    if(lsx_set_sha256_many_implementation(LSX_SHA256_MANY_SSE2)) return 1;
+    return lsx_set_sha256_many_implementation(LSX_SHA256_MANY_SERIAL);
+  }
+  switch(impl) {
+  case LSX_SHA256_MANY_SERIAL: break;
+#if LSX_X86
+  case LSX_SHA256_MANY_SSE2:
+    if(!(lsx_cpu_features() & LSX_CPU_SSE2)) return 0;
+    break;
+  case LSX_SHA256_MANY_AVX2:
+    if(!(lsx_cpu_features() & LSX_CPU_AVX2)) return 0;
+    break;
+#endif
+  default:
+    return 0;
+  }
+  sha256_many_impl = impl;
+  return 1;
+}
+
+int lsx_get_sha256_many_implementation(void) {
+  if(sha256_many_impl == LSX_SHA256_MANY_AUTO)
+    lsx_set_sha256_many_implementation(LSX_SHA256_MANY_AUTO);
+  return sha256_many_impl;
+}
+
+lsx_sha256_lanes_func lsx_sha256_get_lanes_kernel(unsigned* lanes) {
+  switch(lsx_get_sha256_many_implementation()) {
+#if LSX_X86
+  case LSX_SHA256_MANY_AVX2:
+    *lanes = 8;
+    return lsx_sha256_lanes8;
+  case LSX_SHA256_MANY_SSE2:
+    *lanes = 4;
+    return lsx_sha256_lanes4;
+#endif
+  default:
+    *lanes = 1;
+    return NULL;
+  }
+}
+
+void lsx_calculate_sha256_many(const void* const msgs[], const size_t lens[],
+                               size_t count,
+                               uint8_t (*out)[SHA256_HASHBYTES]) {
+  lsx_calculate_sha256_many_policy(msgs, lens, count, LSX_DEFAULT_POLICY, out);
+}
+
+void lsx_calculate_sha256_many_policy(const void* const msgs[],
+                                      const size_t lens[], size_t count,
+                                      int policy,
+                                      uint8_t (*out)[SHA256_HASHBYTES]) {
+  size_t n;
+  unsigned lanes;
+  lsx_sha256_lanes_func kernel = lsx_sha256_get_lanes_kernel(&lanes);
+  if(kernel)
+    sha256_many_lanes(kernel, lanes, msgs, lens, count, policy, out);
+  else {
+    for(n = 0; n < count; ++n)
+      lsx_calculate_sha256_policy(msgs[n], lens[n], policy, out[n]);
+  }
+}
@@ -0,0 +1,249 @@
+#include "lsx.h"
+#include "lsx_sha256_kernels.h"
+#include "lsx_io.h"
+
+#include <string.h> /* memcpy */
+
+/* Chunks that fit entirely in one input buffer are hashed this many at a
+   time, so that the multi-buffer kernels have lanes to fill */
+#define CDC_BATCH (LSX_SHA256_MAX_LANES * 2)
+
+/* The Gear hash's table: 256 random 64-bit values, from SplitMix64 seeded
+   with "LSX-CDC!". Changing it would move every chunk boundary, so it's fixed
+   for good. */
+static const uint64_t gear_table[256] = {
+  0x47975c203cef71afULL, 0x4fc3ce4ff5cf7417ULL, 0x3d642544ccfe1603ULL,
+  0xd6c1aad0ce0c092dULL, 0xef8c7e9b017e802aULL, 0xd425f42df660acd6ULL,
+  0x42379227f05ae0d2ULL, 0xd0fff060d74b505eULL, 0x70bdaeb5e1e169baULL,
+  0x1f3c291f25fad608ULL, 0xe6a83aed64585af0ULL, 0x930c7b6a61270a46ULL,
+  0xae6eebf254aa7ab4ULL, 0xe565962ce071095bULL, 0x0a2463c356d38fc7ULL,
+  0x91e3f970d03b9cf4ULL, 0x87d1f01617749112ULL, 0xb9fb4bd40acabd3eULL,
+  0x4fdef8a102db532eULL, 0x06f106ffdf4ce2aeULL, 0x0d9118e3aaa2b05fULL,
+  0x564fbd3ae3cee3fdULL, 0x2e689f51e5786b46ULL, 0x1e7ad3c9019cc048ULL,
+  0x5c69ed7230f53829ULL, 0xf635886b7cde1e8cULL, 0xfd46e4f426eea356ULL,
+  0x7e076f2043e93532ULL, 0xd51542529e57460dULL, 0xcc47b5ccc4043cacULL,
+  0x9af78df33aaba326ULL, 0x7c7a16c1dad5df37ULL, 0xca2b91a84dec169cULL,
+  0xaa6ac15b3a80990dULL, 0x2f5df2c5b25564e0ULL, 0x0a96b0b1a9f87a39ULL,
+  0x483d1eaf50d3db07ULL, 0x17def8110596dc98ULL, 0x3740fcdea05a8c6dULL,
+  0x42e4fa44cf399da3ULL, 0x106c667891626d53ULL, 0x5cdfa7681d66a32aULL,
+  0x18318563467db4bfULL, 0x31a689b9b9412651ULL, 0x742fda9a911feb41ULL,
+  0x7440be8da613d068ULL, 0x765f97e1e1e731b8ULL, 0x3eeabaaab0bef309ULL,
+  0xa54d539524010c2fULL, 0x9860b3a322f979feULL, 0x5620cd898b112983ULL,
+  0x1c592db8f4bdb051ULL, 0xb9399b25a2895aa7ULL, 0x0dbbcfcb146d7150ULL,
+  0x41294afc8bc0c657ULL, 0x11d8014036ac1db6ULL, 0x76ed0c6c49edfc15ULL,
+  0x4d53fd8d71668041ULL, 0x7f63e3c801970143ULL, 0x2a965549b644c75bULL,
+  0x2c51f99ae0f3b716ULL, 0xfca060c845b06f31ULL, 0xb331eab3169900d4ULL,
+  0xc0c6c480dc714ef6ULL, 0x850e896f47dbd9d2ULL, 0x10d0bbbd6e630b7aULL,
+  0x4f8205c65f7ee845ULL, 0x9cebcf7cf457149cULL, 0x6136dd4bb214d10bULL,
+  0x32226a1d3b4cf0ddULL, 0xb3dbe6315e26e40fULL, 0xd1148deedcc968adULL,
+  0xbe8b499fe736fd45ULL, 0xbbbd18a0babd8d67ULL, 0x44b497be265e377dULL,
+  0xbda8f7fbafcca5ebULL, 0x6ccd43227de731baULL, 0x7e33bf819eedc24aULL,
+  0x5f5eec1a036c581fULL, 0xdc587892bb658506ULL, 0x7fdc9484b1ca4e0aULL,
+  0x1f5282e64367a45fULL, 0x6f100c5d06e94ba2ULL, 0xde94832f242e07c7ULL,
+  0x1610f11d149faa78ULL, 0xdebb6090e5197711ULL, 0xdc67525dbcb9ba3bULL,
+  0x801d8f556aedd28dULL, 0x49037eccfc70fd9aULL, 0x432d5a306a90d129ULL,
+  0xf2304def047f98c6ULL, 0x5a65aa03cf6d50faULL, 0x7b238c1023071816ULL,
+  0x44ee30eaf50a68dcULL, 0x31c7744bfaf71dacULL, 0x2ea74b6fe5cab48fULL,
+  0x60b644ea126b4a51ULL, 0x2ba3ca1c322b4a76ULL, 0xfbb6a35b323c3126ULL,
+  0x1aecbc53635c2bb2ULL, 0x13a7f6d2ac82f5cdULL, 0x74ca53c89644012bULL,
+  0xd76852029ec06f70ULL, 0xfe51cc54afd587ddULL, 0x5247d2f284294afbULL,
+  0xf69cfe3ea383e38eULL, 0xa95c9422bbc5f666ULL, 0x8748a37e734b7662ULL,
+  0xad3c778e9194ac08ULL, 0x8630a12b10042d0dULL, 0x01f9ef10ea460d14ULL,
+  0x82c63b0b9a37e38bULL, 0x6cd26f533ec0ef03ULL, 0x0deb4514471780eaULL,
+  0xf1233fb570c5505eULL, 0x5989a02822202993ULL, 0xd1a7141491aa0790ULL,
+  0x58e1e12ea4d7db80ULL, 0x1288060d51da7137ULL, 0x5fc5d92295ec55fcULL,
+  0xdf19eaedfd1f2ffdULL, 0xd4161d5681bd5f66ULL, 0x23558bb269f40225ULL,
+  0x8f4e75e130481682ULL, 0x756114b142fbda03ULL, 0x51fcb1e658ea13d2ULL,
+  0xe3c5ccbaed046575ULL, 0x0a5910fdeec0673eULL, 0xe7235fd2a4bda287ULL,
+  0x67fa3c6d1e6a3e71ULL, 0x47f24273071f2ef4ULL, 0x99a9bca3d4153de4ULL,
+  0xcc05aa7beaf00b46ULL, 0xe6624f13f6fb356aULL, 0xd13add9411060dfeULL,
+  0x8229a5380ff71fd0ULL, 0xc9d0a23434a845f3ULL, 0x8478985c5997196bULL,
+  0x0b14a35042b5d3d3ULL, 0x28e72dc4754cbf98ULL, 0x4eb8587f013ca69fULL,
+  0x93cee77ec3dbed73ULL, 0x3ba557ea326c71a2ULL, 0xad3a766d56ca92daULL,
+  0x68a7cfda792d0534ULL, 0x8c12b4c47e8a8dbaULL, 0x140667e1e4481f8cULL,
+  0x327a2a7773cdd94dULL, 0xa01e029fa9a48560ULL, 0x36e89cbf5a28af4aULL,
+  0x1a05a99e92cd3062ULL, 0xe8433d85173a095eULL, 0xba69f9100a2eca47ULL,
+  0xdc6e2b01736bcf94ULL, 0xd737369df707e3ebULL, 0xd7533193c3834c5aULL,
+  0x134c01b5010072d7ULL, 0x7d95888b10994aadULL, 0xc0a2aa726ad14c6dULL,
+  0x01c11bce823aad6dULL, 0xa1e71f80ea0af9c4ULL, 0x3c66bc1914b88a32ULL,
+  0x756e8c15f86984a0ULL, 0x4dbbbf2dc26de401ULL, 0xa8591ef1cdfb1a1fULL,
+  0x7e713d1525f6703fULL, 0xda74df522f606f8bULL, 0x0f61410102fa81e0ULL,
+  0x727acf79a176a956ULL, 0xa557e3b621911c1fULL, 0x7e53a26d0c170194ULL,
+  0x8226548ed7dee639ULL, 0x33d17b1dc8fbb220ULL, 0x60ff157524df2ff1ULL,
+  0x3090d6e591861007ULL, 0x4951190d3f299bf7ULL, 0xf8b22d350acad52cULL,
+  0x91edb4fa3e673c97ULL, 0x11eaffbbb2d21225ULL, 0x7646b58b99eee148ULL,
+  0xc00205d75caeafc1ULL, 0x201c457ac5172c95ULL, 0x441f38259ea22560ULL,
+  0x715822b3b78ef2ebULL, 0x11e41a8d8b5a5a57ULL, 0x8cb789645522ae00ULL,
+  0xaba81491159f7d0cULL, 0xaf25f1dcdb330b48ULL, 0x6848693308194d96ULL,
+  0xd0cb285e8264d683ULL, 0xaafa0007ac38f4b6ULL, 0x18826a41cea95178ULL,
+  0x8fc4050a8ec19cbbULL, 0x7c809bc505df3fceULL, 0x4da9e83ed95558eaULL,
+  0x128981b995923dd8ULL, 0x960fd26d139dfe7bULL, 0xef089b57da2acd69ULL,
+  0xcfdc2085809ac71eULL, 0x12e6671b8d1165afULL, 0xad4cc8ddb4a69f83ULL,
+  0x2c02401c915204b6ULL, 0x304b00f513b7432aULL, 0x65b5057402ab00e2ULL,
+  0x642349b2dddf24cbULL, 0xe1b3efeb58db3323ULL, 0xde39dd20cdc23941ULL,
+  0x47782ca6019845bcULL, 0x313a95e967aaed01ULL, 0x08919b23c4b155ddULL,
+  0xeb362919b7ac4f9eULL, 0x25c067f905f77cbbULL, 0xa2fb8e8646c633ffULL,
+  0x4994aee041609dd1ULL, 0x837b39be2d08d03dULL, 0x60a0e8258d34ac76ULL,
+  0xd17e96a1c800f32fULL, 0x99ea997881cdab72ULL, 0x4809c607c4086e9dULL,
+  0x410be618b3d848c2ULL, 0x8409a5e777a9693bULL, 0xe1af5ee5e3d80480ULL,
+  0xaf8a34b0391b0911ULL, 0xd927f83bb4eeb480ULL, 0xfd63bff6423f9d68ULL,
+  0xe460dea1f27730f1ULL, 0x7e115f3d51f38a17ULL, 0x279b144ff7046306ULL,
+  0x0d26219b8bd0e3cfULL, 0x3b49b956e20b4939ULL, 0x43ba06184104efb2ULL,
+  0xd819e146a7bfe9a9ULL, 0x5bc47a66a2eb72e7ULL, 0xd8157cf9ed142ff4ULL,
+  0x83706e5ac9c416dfULL, 0xd31343a783fd07d3ULL, 0x338d820c18db33b6ULL,
+  0x58cb96a7213b472bULL, 0xc7790d1bf7835850ULL, 0xd25c32b2aa8ebfe1ULL,
+  0xd1f570b1eea70107ULL, 0x3a00c0789840b9e4ULL, 0x1a4a15a91fc75225ULL,
+  0x952702c767d98e2cULL, 0xc2687f7b018963b6ULL, 0xe1ed9795bc75be59ULL,
+  0x73cc685aba98b511ULL, 0x0bd7a33f59645f6cULL, 0xdb4f297a2e319d7cULL,
+  0x0de4caea14b53435ULL, 0x16b941b8a8c13113ULL, 0x66a6491bb6fb9d26ULL,
+  0xc3ae76f66e7cb984ULL, 0x8ded01d43e1282d1ULL, 0xc64f15082ba65b38ULL,
+  0x473d741088d23f7bULL
+};
+
+/* A mask of the top `bits` bits. Each shift pushes old bytes out the top of
+   the Gear hash, so those bits depend on the most recent bytes. */
+static uint64_t top_bits(unsigned bits) {
+  return bits == 0 ? 0 : ~(uint64_t)0 << (64 - bits);
+}
+
+int lsx_setup_sha256_cdc(lsx_sha256_cdc* ctx, size_t min_bytes,
+                         size_t avg_bytes, size_t max_bytes,
+                         lsx_sha256_cdc_func emit, void* arg) {
+  unsigned bits = 0;
+  if(min_bytes == 0 || min_bytes > avg_bytes || avg_bytes > max_bytes)
+    return 0;
+  while(((size_t)2 << bits) <= avg_bytes && bits < 62) ++bits;
+  /* FastCDC's "normalized chunking": harder to cut before the average,
+     easier after, which keeps the sizes close to it */
+  ctx->mask_small = top_bits(bits + 2);
+  ctx->mask_large = top_bits(bits > 2 ? bits - 2 : 0);
+  ctx->min_bytes = min_bytes;
+  ctx->avg_bytes = avg_bytes;
+  ctx->max_bytes = max_bytes;
+  ctx->emit = emit;
+  ctx->arg = arg;
+  ctx->offset = 0;
+  ctx->pending = 0;
+  ctx->gear = 0;
+  lsx_setup_sha256(&ctx->partial);
+  return 1;
+}
+
+/* Returns how many of the `bytes` bytes at `p` belong to the chunk in
+   progress, and whether it ends there. */
+static size_t scan(lsx_sha256_cdc* ctx, const uint8_t* p, size_t bytes,
+                   int* cut) {
+  uint64_t gear = ctx->gear;
+  /* offsets within the chunk, rather than within `p` */
+  size_t start = ctx->pending, at = start, end = start + bytes;
+  size_t stop;
+  *cut = 1;
+  /* the first `min_bytes` of a chunk are never looked at */
+  if(at < ctx->min_bytes) at = ctx->min_bytes < end ? ctx->min_bytes : end;
+  stop = ctx->avg_bytes < end ? ctx->avg_bytes : end;
+  for(; at < stop; ++at) {
+    gear = (gear << 1) + gear_table[p[at - start]];
+    if(!(gear & ctx->mask_small)) goto found;
+  }
+  stop = ctx->max_bytes < end ? ctx->max_bytes : end;
+  for(; at < stop; ++at) {
+    gear = (gear << 1) + gear_table[p[at - start]];
+    if(!(gear & ctx->mask_large)) goto found;
+  }
+  if(at == ctx->max_bytes) return at - start;
+  *cut = 0;
+  ctx->gear = gear;
+  return bytes;
+ found:
+  return at + 1 - start;
+}
+
+struct cdc_batch {
+  const void* msgs[CDC_BATCH];
+  size_t lens[CDC_BATCH];
+  uint8_t digests[CDC_BATCH][SHA256_HASHBYTES];
+  lsx_sha256_cdc_chunk chunks[CDC_BATCH];
+  size_t count;
+};
+
+static void flush(lsx_sha256_cdc* ctx, struct cdc_batch* batch) {
+  size_t n;
+  if(batch->count == 0) return;
+  lsx_calculate_sha256_many_policy(batch->msgs, batch->lens, batch->count,
+                                   lsx_sha256_cdc_policy(ctx),
+                                   batch->digests);
+  for(n = 0; n < batch->count; ++n)
+    memcpy(batch->chunks[n].digest, batch->digests[n], SHA256_HASHBYTES);
+  ctx->emit(ctx->arg, batch->chunks, batch->count);
+  batch->count = 0;
+}
+
+static void emit_partial(lsx_sha256_cdc* ctx) {
+  lsx_sha256_cdc_chunk chunk;
+  chunk.offset = ctx->offset;
+  chunk.bytes = ctx->pending;
+  lsx_finish_sha256(&ctx->partial, chunk.digest);
+  ctx->emit(ctx->arg, &chunk, 1);
+  if(lsx_sha256_cdc_policy(ctx) != LSX_POLICY_PUBLIC)
+    lsx_explicit_bzero(&chunk, sizeof(chunk));
+}
+
+void lsx_input_sha256_cdc(lsx_sha256_cdc* ctx, const void* data,
+                          size_t bytes) {
+  const uint8_t* p = (const uint8_t*)data;
+  struct cdc_batch batch;
+  batch.count = 0;
+  while(bytes > 0) {
+    int cut;
+    size_t take = scan(ctx, p, bytes, &cut), chunk_bytes = ctx->pending + take;
+    if(!cut) {
+      lsx_input_sha256(&ctx->partial, p, take);
+      ctx->pending = chunk_bytes;
+      break;
+    }
+    if(ctx->pending > 0) {
+      /* it began in an earlier call, so it's the first to end in this one,
+         and the batch is still empty */
+      int policy = lsx_sha256_cdc_policy(ctx);
+      lsx_input_sha256(&ctx->partial, p, take);
+      ctx->pending = chunk_bytes;
+      emit_partial(ctx);
+      /* setup would go back to the default */
+      lsx_setup_sha256(&ctx->partial);
+      lsx_set_sha256_cdc_policy(ctx, policy);
+    }
+    else {
+      batch.chunks[batch.count].offset = ctx->offset;
+      batch.chunks[batch.count].bytes = take;
+      batch.msgs[batch.count] = p;
+      batch.lens[batch.count] = take;
+      if(++batch.count == CDC_BATCH) flush(ctx, &batch);
+    }
+    ctx->offset += chunk_bytes;
+    ctx->pending = 0;
+    ctx->gear = 0;
+    p += take;
+    bytes -= take;
+  }
+  /* the data won't be around after we return */
+  flush(ctx, &batch);
+  if(lsx_sha256_cdc_policy(ctx) != LSX_POLICY_PUBLIC)
+    lsx_explicit_bzero(&batch, sizeof(batch));
+}
+
+static void drain(void* arg, const void* buf, size_t bytes) {
+  lsx_input_sha256_cdc((lsx_sha256_cdc*)arg, buf, bytes);
+}
+
+int lsx_input_sha256_cdc_fd(lsx_sha256_cdc* ctx, int fd) {
+  return lsx_drain_fd(fd, drain, ctx);
+}
+
+void lsx_finish_sha256_cdc(lsx_sha256_cdc* ctx) {
+  if(ctx->pending > 0) {
+    emit_partial(ctx);
+    ctx->offset += ctx->pending;
+    ctx->pending = 0;
+  }
+  lsx_destroy_sha256(&ctx->partial);
+}
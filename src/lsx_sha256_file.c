@@ -0,0 +1,117 @@
+/* for posix_madvise, posix_fadvise, and 64-bit offsets everywhere */
+#define _POSIX_C_SOURCE 200112L
+#define _FILE_OFFSET_BITS 64
+
+#include "lsx.h"
+#include "lsx_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#define open_fd(path) _open(path, _O_RDONLY | _O_BINARY)
+#define close_fd _close
+/* no mapping on Windows, for now */
+#ifndef LSX_NO_MMAP
+#define LSX_NO_MMAP 1
+#endif
+#else
+#include <unistd.h>
+#define open_fd(path) open(path, O_RDONLY)
+#define close_fd close
+#ifndef LSX_NO_MMAP
+#include <sys/mman.h>
+#endif
+#endif
+
+/* Regular files are mapped this much at a time, so that a 32-bit address
+   space can hash files bigger than itself */
+#define MAP_WINDOW_BYTES ((size_t)1 << 28)
+
+struct file_job {
+  int fd;
+  lsx_sha256_context ctx;
+  /* errno from whatever failed */
+  int error;
+};
+
+static void drain(void* arg, const void* buf, size_t bytes) {
+  lsx_input_sha256((lsx_sha256_context*)arg, buf, bytes);
+}
+
+#ifndef LSX_NO_MMAP
+/* Returns 1 or 0 for success or failure, or -1 if (the rest of) the file
+   can't be mapped and should be read instead */
+static int hash_by_mapping(struct file_job* job) {
+  struct stat st;
+  off_t pos, end, window_start;
+  long page;
+  if(fstat(job->fd, &st) || !S_ISREG(st.st_mode)) return -1;
+  pos = lseek(job->fd, 0, SEEK_CUR);
+  page = sysconf(_SC_PAGESIZE);
+  if(pos < 0 || page <= 0 || MAP_WINDOW_BYTES % page) return -1;
+  end = st.st_size;
+  /* procfs and friends say 0 bytes for files that aren't empty, and there's
+     nothing to map at or past the end anyway; reading gets both right */
+  if(pos >= end) return -1;
+  /* mappings have to start on a page boundary */
+  window_start = pos - pos % page;
+  while(pos < end) {
+    size_t window = end - window_start < (off_t)MAP_WINDOW_BYTES
+      ? (size_t)(end - window_start) : MAP_WINDOW_BYTES;
+    void* p = mmap(NULL, window, PROT_READ, MAP_SHARED, job->fd,
+                   window_start);
+    if(p == MAP_FAILED) {
+      /* let the caller read the rest instead */
+      if(lseek(job->fd, pos, SEEK_SET) < 0) {
+        job->error = errno;
+        return 0;
+      }
+      return -1;
+    }
+    posix_madvise(p, window, POSIX_MADV_SEQUENTIAL);
+    lsx_input_sha256(&job->ctx, (const uint8_t*)p + (pos - window_start),
+                     window - (size_t)(pos - window_start));
+    munmap(p, window);
+    window_start += window;
+    pos = window_start;
+  }
+  /* leave the descriptor where reading it would have */
+  lseek(job->fd, end, SEEK_SET);
+  return 1;
+}
+#endif
+
+int lsx_sha256_fd(int fd, uint8_t out[SHA256_HASHBYTES]) {
+  struct file_job job;
+  int ret = -1;
+  job.fd = fd;
+  job.error = 0;
+  lsx_setup_sha256(&job.ctx);
+#ifndef LSX_NO_MMAP
+  ret = hash_by_mapping(&job);
+#endif
+  if(ret < 0) {
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    ret = lsx_drain_fd(fd, drain, &job.ctx);
+    if(!ret) job.error = errno;
+  }
+  if(ret) lsx_finish_sha256(&job.ctx, out);
+  lsx_destroy_sha256(&job.ctx);
+  if(!ret) errno = job.error;
+  return ret;
+}
+
+int lsx_sha256_file(const char* path, uint8_t out[SHA256_HASHBYTES]) {
+  int fd, ret, error;
+  do fd = open_fd(path); while(fd < 0 && errno == EINTR);
+  if(fd < 0) return 0;
+  ret = lsx_sha256_fd(fd, out);
+  error = errno;
+  close_fd(fd);
+  errno = error;
+  return ret;
+}
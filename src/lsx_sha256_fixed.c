@@ -0,0 +1,125 @@
+#include "lsx.h"
+#include "lsx_sha256_kernels.h"
+
+#include <string.h> /* memcpy */
+
+/* SHA-256 of messages whose length is fixed: 64 bytes (two child digests in
+   a Merkle tree) or 32 bytes (one link of a hash chain). The padding for
+   those lengths never changes, so it's built once, and the kernels are fed
+   directly, skipping the buffering and padding logic of the normal paths. */
+
+/* sha256 is big-endian */
+#define word_to_bytes(word, p) ((p)[0] = (uint8_t)((word)>>24), (p)[1] = (uint8_t)((word)>>16), (p)[2] = (uint8_t)((word)>>8), (p)[3] = (uint8_t)(word))
+
+/* The whole second block of a 64-byte message: 0x80, zeroes, and a length
+   of 512 bits */
+static const uint8_t pad64[SHA256_BLOCKBYTES] = {
+  0x80,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,
+  0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0x02,0x00,
+};
+
+/* The second half of the only block of a 32-byte message: 0x80, zeroes, and
+   a length of 256 bits */
+static const uint8_t pad32[SHA256_BLOCKBYTES - SHA256_HASHBYTES] = {
+  0x80,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0x01,0x00,
+};
+
+/* These follow the default policy */
+#define wiping (LSX_DEFAULT_POLICY != LSX_POLICY_PUBLIC)
+#define wipe(p, n) (wiping ? lsx_explicit_bzero(p, n) : (void)0)
+
+static void store_state(const uint32_t* state, unsigned lanes, unsigned l,
+                        uint8_t* out) {
+  unsigned i;
+  for(i = 0; i < 8; ++i) word_to_bytes(state[i * lanes + l], out + i * 4);
+}
+
+void lsx_sha256_64to32(const uint8_t in[SHA256_BLOCKBYTES],
+                       uint8_t out[SHA256_HASHBYTES]) {
+  uint32_t h[8];
+  memcpy(h, lsx_sha256_iv, sizeof(h));
+  lsx_sha256_compress(h, in, 1, LSX_DEFAULT_POLICY);
+  lsx_sha256_compress(h, pad64, 1, LSX_DEFAULT_POLICY);
+  store_state(h, 1, 0, out);
+  wipe(h, sizeof(h));
+}
+
+void lsx_sha256_64to32_many(const uint8_t (*in)[SHA256_BLOCKBYTES],
+                            uint8_t (*out)[SHA256_HASHBYTES], size_t count) {
+  uint32_t state[8 * LSX_SHA256_MAX_LANES];
+  const uint8_t* blocks[LSX_SHA256_MAX_LANES];
+  const uint8_t* pads[LSX_SHA256_MAX_LANES];
+  unsigned lanes, i, l;
+  lsx_sha256_lanes_func kernel = lsx_sha256_get_lanes_kernel(&lanes);
+  size_t n = 0;
+  if(kernel) {
+    for(l = 0; l < lanes; ++l) pads[l] = pad64;
+    /* idle lanes cost as much as busy ones, so a nearly empty last group
+       goes through the single-block kernel instead */
+    while((count - n) * 2 > lanes) {
+      unsigned busy = count - n < lanes ? (unsigned)(count - n) : lanes;
+      for(i = 0; i < 8; ++i) {
+        for(l = 0; l < lanes; ++l) state[i * lanes + l] = lsx_sha256_iv[i];
+      }
+      for(l = 0; l < lanes; ++l) blocks[l] = in[n + (l < busy ? l : 0)];
+      kernel(state, blocks, wiping);
+      kernel(state, pads, wiping);
+      for(l = 0; l < busy; ++l) store_state(state, lanes, l, out[n + l]);
+      n += busy;
+    }
+    wipe(state, sizeof(state));
+  }
+  for(; n < count; ++n) lsx_sha256_64to32(in[n], out[n]);
+}
+
+void lsx_sha256_iterate(const uint8_t seed[SHA256_HASHBYTES], uint64_t n,
+                        uint8_t out[SHA256_HASHBYTES]) {
+  uint8_t block[SHA256_BLOCKBYTES];
+  uint32_t h[8];
+  memcpy(block, seed, SHA256_HASHBYTES);
+  memcpy(block + SHA256_HASHBYTES, pad32, sizeof(pad32));
+  while(n-- > 0) {
+    memcpy(h, lsx_sha256_iv, sizeof(h));
+    lsx_sha256_compress(h, block, 1, LSX_DEFAULT_POLICY);
+    store_state(h, 1, 0, block);
+  }
+  memcpy(out, block, SHA256_HASHBYTES);
+  wipe(block, sizeof(block));
+  wipe(h, sizeof(h));
+}
+
+void lsx_sha256_iterate_many(const uint8_t (*seeds)[SHA256_HASHBYTES],
+                             size_t count, uint64_t n,
+                             uint8_t (*out)[SHA256_HASHBYTES]) {
+  uint8_t block[LSX_SHA256_MAX_LANES][SHA256_BLOCKBYTES];
+  uint32_t state[8 * LSX_SHA256_MAX_LANES];
+  const uint8_t* blocks[LSX_SHA256_MAX_LANES];
+  unsigned lanes, i, l;
+  lsx_sha256_lanes_func kernel = lsx_sha256_get_lanes_kernel(&lanes);
+  size_t m = 0;
+  uint64_t k;
+  if(kernel) {
+    for(l = 0; l < lanes; ++l) {
+      memcpy(block[l] + SHA256_HASHBYTES, pad32, sizeof(pad32));
+      blocks[l] = block[l];
+    }
+    while((count - m) * 2 > lanes) {
+      unsigned busy = count - m < lanes ? (unsigned)(count - m) : lanes;
+      for(l = 0; l < lanes; ++l)
+        memcpy(block[l], seeds[m + (l < busy ? l : 0)], SHA256_HASHBYTES);
+      for(k = 0; k < n; ++k) {
+        for(i = 0; i < 8; ++i) {
+          for(l = 0; l < lanes; ++l) state[i * lanes + l] = lsx_sha256_iv[i];
+        }
+        kernel(state, blocks, wiping);
+        for(l = 0; l < lanes; ++l) store_state(state, lanes, l, block[l]);
+      }
+      for(l = 0; l < busy; ++l)
+        memcpy(out[m + l], block[l], SHA256_HASHBYTES);
+      m += busy;
+    }
+    wipe(block, sizeof(block));
+    wipe(state, sizeof(state));
+  }
+  for(; m < count; ++m) lsx_sha256_iterate(seeds[m], n, out[m]);
+}
@@ -0,0 +1,396 @@
+#include "lsx.h"
+#include "lsx_sha256_kernels.h"
+
+#include <string.h> /* memcpy, memset */
+
+/* The storage is every node, 32 bytes each, level by level from the leaves
+   up to the root; then one bit per node, in the same order, set if the node
+   needs rehashing. At each level, the last node is alone if the level below
+   has an odd number of nodes, and then it's a copy of its only child. This
+   gives the same tree as `lsx_calculate_sha256_tree`. */
+
+/* One level per bit of the chunk count, plus the root */
+#define MAX_LEVELS (sizeof(size_t) * 8 + 1)
+
+#define MERKLE_VERSION 1
+
+#define is_marked(bits, n) (((bits)[(n) >> 3] >> ((n) & 7)) & 1)
+
+/* Fills in where each level starts, with `start[levels]` being the total
+   number of nodes, and returns the number of levels */
+static unsigned level_starts(size_t chunks, size_t start[MAX_LEVELS + 1]) {
+  unsigned levels = 0;
+  size_t size = chunks, total = 0;
+  for(;;) {
+    start[levels++] = total;
+    total += size;
+    if(size == 1) break;
+    size = size / 2 + (size & 1);
+  }
+  start[levels] = total;
+  return levels;
+}
+
+/* 0 if there are too many to address */
+static size_t count_chunks(uint64_t object_bytes, size_t chunk_bytes) {
+  uint64_t chunks = object_bytes / chunk_bytes
+    + (object_bytes % chunk_bytes != 0);
+  if(chunks == 0) chunks = 1;
+  /* nodes are fewer than twice the chunks, and each one needs 32 bytes and
+     a bit */
+  if(chunks > ((size_t)-1) / (2 * SHA256_HASHBYTES + 1)) return 0;
+  return (size_t)chunks;
+}
+
+static size_t storage_bytes(size_t nodes) {
+  return nodes * SHA256_HASHBYTES + (nodes + 7) / 8;
+}
+
+size_t lsx_sha256_merkle_storage_bytes(uint64_t object_bytes,
+                                       size_t chunk_bytes) {
+  size_t start[MAX_LEVELS + 1], chunks;
+  if(chunk_bytes == 0) return 0;
+  chunks = count_chunks(object_bytes, chunk_bytes);
+  if(chunks == 0) return 0;
+  return storage_bytes(start[level_starts(chunks, start)]);
+}
+
+/* Sets `tree` up to use `storage`, without touching its contents */
+static int attach(lsx_sha256_merkle* tree, void* storage, size_t storage_size,
+                  uint64_t object_bytes, size_t chunk_bytes) {
+  size_t start[MAX_LEVELS + 1], chunks;
+  if(chunk_bytes == 0) return 0;
+  chunks = count_chunks(object_bytes, chunk_bytes);
+  if(chunks == 0) return 0;
+  tree->nodes = start[level_starts(chunks, start)];
+  if(storage_size < storage_bytes(tree->nodes)) return 0;
+  tree->storage = (uint8_t*)storage;
+  tree->object_bytes = object_bytes;
+  tree->chunk_bytes = chunk_bytes;
+  tree->chunks = chunks;
+  tree->marked = 0;
+  return 1;
+}
+
+static void mark(lsx_sha256_merkle* tree, size_t node) {
+  uint8_t* bits = tree->storage + tree->nodes * SHA256_HASHBYTES;
+  if(!is_marked(bits, node)) {
+    bits[node >> 3] |= (uint8_t)(1 << (node & 7));
+    ++tree->marked;
+  }
+}
+
+static void unmark(lsx_sha256_merkle* tree, size_t node) {
+  uint8_t* bits = tree->storage + tree->nodes * SHA256_HASHBYTES;
+  bits[node >> 3] &= (uint8_t)~(1 << (node & 7));
+  --tree->marked;
+}
+
+/* The first marked node in [from, to), or `to` if there isn't one. Unmarked
+   stretches are skipped a byte at a time. */
+static size_t next_marked(const lsx_sha256_merkle* tree, size_t from,
+                          size_t to) {
+  const uint8_t* bits = tree->storage + tree->nodes * SHA256_HASHBYTES;
+  while(from < to) {
+    if(!(from & 7) && bits[from >> 3] == 0) from += 8;
+    else if(is_marked(bits, from)) return from;
+    else ++from;
+  }
+  return to;
+}
+
+int lsx_setup_sha256_merkle(lsx_sha256_merkle* tree, void* storage,
+                            size_t storage_size,
+                            uint64_t object_bytes, size_t chunk_bytes) {
+  size_t n;
+  if(!attach(tree, storage, storage_size, object_bytes, chunk_bytes))
+    return 0;
+  memset(tree->storage, 0, storage_bytes(tree->nodes));
+  for(n = 0; n < tree->chunks; ++n) mark(tree, n);
+  return 1;
+}
+
+int lsx_sha256_merkle_touch(lsx_sha256_merkle* tree, size_t index) {
+  if(index >= tree->chunks) return 0;
+  mark(tree, index);
+  return 1;
+}
+
+int lsx_sha256_merkle_touch_range(lsx_sha256_merkle* tree,
+                                  uint64_t offset, uint64_t bytes) {
+  uint64_t n, last;
+  if(offset > tree->object_bytes || bytes > tree->object_bytes - offset)
+    return 0;
+  if(bytes == 0) return 1;
+  last = (offset + bytes - 1) / tree->chunk_bytes;
+  for(n = offset / tree->chunk_bytes; n <= last; ++n) mark(tree, (size_t)n);
+  return 1;
+}
+
+int lsx_sha256_merkle_commit(lsx_sha256_merkle* tree,
+                             lsx_sha256_merkle_read_func read, void* arg) {
+  size_t start[MAX_LEVELS + 1], n, end;
+  unsigned levels = level_starts(tree->chunks, start), level;
+  uint8_t* nodes = tree->storage;
+  const uint8_t* bits = nodes + tree->nodes * SHA256_HASHBYTES;
+  /* leaves */
+  for(n = next_marked(tree, 0, tree->chunks); n < tree->chunks;
+      n = next_marked(tree, n + 1, tree->chunks)) {
+    uint64_t offset = (uint64_t)n * tree->chunk_bytes;
+    size_t bytes = tree->object_bytes - offset < tree->chunk_bytes
+      ? (size_t)(tree->object_bytes - offset) : tree->chunk_bytes;
+    const void* data = read ? read(arg, n, bytes)
+      : (const uint8_t*)arg + (size_t)offset;
+    if(data == NULL) return 0;
+    lsx_calculate_sha256(data, bytes, nodes + n * SHA256_HASHBYTES);
+    unmark(tree, n);
+    if(levels > 1) mark(tree, start[1] + n / 2);
+  }
+  /* everything above them, a level at a time */
+  for(level = 1; level < levels; ++level) {
+    size_t below = start[level] - start[level - 1];
+    end = start[level + 1];
+    n = next_marked(tree, start[level], end);
+    while(n < end) {
+      size_t index = n - start[level], run = 1, i;
+      const uint8_t* children = nodes
+        + (start[level - 1] + index * 2) * SHA256_HASHBYTES;
+      if(index * 2 + 1 == below)
+        memcpy(nodes + n * SHA256_HASHBYTES, children, SHA256_HASHBYTES);
+      else {
+        /* consecutive marked nodes have consecutive children, so they can go
+           through the SIMD lanes together */
+        while(n + run < end && is_marked(bits, n + run)
+              && (index + run) * 2 + 1 < below)
+          ++run;
+        lsx_sha256_64to32_many((const uint8_t (*)[SHA256_BLOCKBYTES])children,
+                               (uint8_t (*)[SHA256_HASHBYTES])
+                               (nodes + n * SHA256_HASHBYTES), run);
+      }
+      for(i = 0; i < run; ++i) {
+        unmark(tree, n + i);
+        if(level + 1 < levels) mark(tree, start[level + 1] + (index + i) / 2);
+      }
+      n = next_marked(tree, n + run, end);
+    }
+  }
+  return 1;
+}
+
+int lsx_sha256_merkle_digest(const lsx_sha256_merkle* tree,
+                             uint8_t out[SHA256_HASHBYTES]) {
+  if(tree->marked) return 0;
+  /* the root is the last node */
+  lsx_sha256_tree_digest(tree->storage
+                         + (tree->nodes - 1) * SHA256_HASHBYTES,
+                         tree->chunk_bytes, tree->object_bytes,
+                         LSX_DEFAULT_POLICY, out);
+  return 1;
+}
+
+/* big-endian, like everything else in SHA-256 */
+static void store_u64(uint64_t value, uint8_t* p) {
+  unsigned n;
+  for(n = 0; n < 8; ++n) p[n] = (uint8_t)(value >> (56 - n * 8));
+}
+
+static uint64_t load_u64(const uint8_t* p) {
+  uint64_t value = 0;
+  unsigned n;
+  for(n = 0; n < 8; ++n) value = (value << 8) | p[n];
+  return value;
+}
+
+size_t lsx_sha256_merkle_export_bytes(const lsx_sha256_merkle* tree) {
+  return LSX_SHA256_MERKLE_HEADER_BYTES + storage_bytes(tree->nodes);
+}
+
+void lsx_sha256_merkle_export(const lsx_sha256_merkle* tree, uint8_t* out) {
+  memcpy(out, "lsxM", 4);
+  out[4] = MERKLE_VERSION;
+  out[5] = out[6] = out[7] = 0;
+  store_u64(tree->chunk_bytes, out + 8);
+  store_u64(tree->object_bytes, out + 16);
+  memcpy(out + LSX_SHA256_MERKLE_HEADER_BYTES, tree->storage,
+         storage_bytes(tree->nodes));
+}
+
+int lsx_sha256_merkle_import(lsx_sha256_merkle* tree, void* storage,
+                             size_t storage_size,
+                             const uint8_t* in, size_t in_bytes) {
+  lsx_sha256_merkle loaded;
+  uint64_t chunk_bytes;
+  const uint8_t* bits;
+  size_t n, size;
+  if(in_bytes < LSX_SHA256_MERKLE_HEADER_BYTES || memcmp(in, "lsxM", 4)
+     || in[4] != MERKLE_VERSION || in[5] || in[6] || in[7]) return 0;
+  chunk_bytes = load_u64(in + 8);
+  if(chunk_bytes > (size_t)-1
+     || !attach(&loaded, storage, storage_size, load_u64(in + 16),
+                (size_t)chunk_bytes)) return 0;
+  size = storage_bytes(loaded.nodes);
+  if(in_bytes != LSX_SHA256_MERKLE_HEADER_BYTES + size) return 0;
+  bits = in + LSX_SHA256_MERKLE_HEADER_BYTES
+    + loaded.nodes * SHA256_HASHBYTES;
+  /* the bits past the last node must be clear */
+  if(loaded.nodes & 7 && bits[loaded.nodes >> 3] >> (loaded.nodes & 7))
+    return 0;
+  memcpy(loaded.storage, in + LSX_SHA256_MERKLE_HEADER_BYTES, size);
+  for(n = next_marked(&loaded, 0, loaded.nodes); n < loaded.nodes;
+      n = next_marked(&loaded, n + 1, loaded.nodes))
+    ++loaded.marked;
+  *tree = loaded;
+  return 1;
+}
+
+#define NO_SIBLING ((size_t)-1)
+
+/* Which nodes a proof for chunks [first, first + count) holds. At each level
+   below the root, that's the left neighbour of the range if the range starts
+   on a right child, then the right neighbour if it ends on a left child that
+   isn't alone. */
+struct proof_plan {
+  unsigned levels;
+  /* the range, and the size of the level, at each level */
+  size_t first[MAX_LEVELS], end[MAX_LEVELS], size[MAX_LEVELS];
+  /* where in the proof the neighbours are, or NO_SIBLING */
+  size_t left[MAX_LEVELS], right[MAX_LEVELS];
+  size_t proof_bytes;
+};
+
+static void plan_proof(struct proof_plan* plan, size_t chunks, size_t first,
+                       size_t count) {
+  size_t a = first, b = first + count, size = chunks, pos = 0;
+  unsigned level = 0;
+  for(;;) {
+    plan->first[level] = a;
+    plan->end[level] = b;
+    plan->size[level] = size;
+    plan->left[level] = plan->right[level] = NO_SIBLING;
+    if(size == 1) break;
+    if(a & 1) {
+      plan->left[level] = pos;
+      pos += SHA256_HASHBYTES;
+    }
+    if((b & 1) && b != size) {
+      plan->right[level] = pos;
+      pos += SHA256_HASHBYTES;
+    }
+    a /= 2;
+    b = b / 2 + (b & 1);
+    size = size / 2 + (size & 1);
+    ++level;
+  }
+  plan->levels = level + 1;
+  plan->proof_bytes = pos;
+}
+
+int lsx_sha256_merkle_prove(const lsx_sha256_merkle* tree,
+                            size_t first, size_t count,
+                            uint8_t* out, size_t* out_bytes) {
+  struct proof_plan plan;
+  size_t start[MAX_LEVELS + 1];
+  unsigned level;
+  if(tree->marked || count == 0 || first >= tree->chunks
+     || count > tree->chunks - first) return 0;
+  level_starts(tree->chunks, start);
+  plan_proof(&plan, tree->chunks, first, count);
+  for(level = 0; level < plan.levels; ++level) {
+    if(plan.left[level] != NO_SIBLING)
+      memcpy(out + plan.left[level], tree->storage
+             + (start[level] + plan.first[level] - 1) * SHA256_HASHBYTES,
+             SHA256_HASHBYTES);
+    if(plan.right[level] != NO_SIBLING)
+      memcpy(out + plan.right[level], tree->storage
+             + (start[level] + plan.end[level]) * SHA256_HASHBYTES,
+             SHA256_HASHBYTES);
+  }
+  *out_bytes = plan.proof_bytes;
+  return 1;
+}
+
+/* Rebuilds the path to the root from the received chunks, in order. A left
+   child waits at its level until its right sibling turns up. */
+struct proof_check {
+  const struct proof_plan* plan;
+  const uint8_t* proof;
+  uint8_t waiting[MAX_LEVELS][SHA256_HASHBYTES];
+  uint8_t root[SHA256_HASHBYTES];
+};
+
+static void climb(struct proof_check* check, size_t index,
+                  const uint8_t leaf[SHA256_HASHBYTES]) {
+  const struct proof_plan* plan = check->plan;
+  uint8_t pair[SHA256_BLOCKBYTES], node[SHA256_HASHBYTES];
+  unsigned level;
+  memcpy(node, leaf, SHA256_HASHBYTES);
+  for(level = 0; level + 1 < plan->levels; ++level, index /= 2) {
+    if(index & 1) {
+      memcpy(pair, index == plan->first[level]
+             ? check->proof + plan->left[level] : check->waiting[level],
+             SHA256_HASHBYTES);
+      memcpy(pair + SHA256_HASHBYTES, node, SHA256_HASHBYTES);
+    }
+    /* alone; goes up as it is */
+    else if(index + 1 == plan->size[level]) continue;
+    else if(index + 1 == plan->end[level]) {
+      memcpy(pair, node, SHA256_HASHBYTES);
+      memcpy(pair + SHA256_HASHBYTES, check->proof + plan->right[level],
+             SHA256_HASHBYTES);
+    }
+    else {
+      memcpy(check->waiting[level], node, SHA256_HASHBYTES);
+      return;
+    }
+    lsx_sha256_64to32(pair, node);
+  }
+  memcpy(check->root, node, SHA256_HASHBYTES);
+}
+
+int lsx_sha256_merkle_verify(const uint8_t digest[SHA256_HASHBYTES],
+                             uint64_t object_bytes, size_t chunk_bytes,
+                             size_t first, const void* data,
+                             size_t data_bytes, const uint8_t* proof,
+                             size_t proof_bytes) {
+  struct proof_plan plan;
+  struct proof_check check;
+  const void* msgs[LSX_SHA256_MAX_LANES];
+  size_t lens[LSX_SHA256_MAX_LANES];
+  uint8_t leaves[LSX_SHA256_MAX_LANES][SHA256_HASHBYTES];
+  uint8_t result[SHA256_HASHBYTES];
+  const uint8_t* p = (const uint8_t*)data;
+  size_t chunks, count, n, left;
+  uint64_t offset;
+  unsigned batch, l;
+  if(chunk_bytes == 0) return 0;
+  chunks = count_chunks(object_bytes, chunk_bytes);
+  if(chunks == 0 || first >= chunks) return 0;
+  offset = (uint64_t)first * chunk_bytes;
+  /* whole chunks only; just the last one in the object can be short */
+  if(data_bytes > object_bytes - offset
+     || (offset + data_bytes != object_bytes
+         && (data_bytes == 0 || data_bytes % chunk_bytes))) return 0;
+  count = data_bytes / chunk_bytes + (data_bytes % chunk_bytes != 0);
+  /* an empty object's one empty chunk */
+  if(count == 0) count = 1;
+  plan_proof(&plan, chunks, first, count);
+  if(proof_bytes != plan.proof_bytes) return 0;
+  check.plan = &plan;
+  check.proof = proof;
+  /* several chunks at a time, through the SIMD lanes */
+  left = data_bytes;
+  for(n = 0; n < count; n += batch) {
+    for(batch = 0; batch < LSX_SHA256_MAX_LANES && n + batch < count;
+        ++batch) {
+      msgs[batch] = p;
+      lens[batch] = left < chunk_bytes ? left : chunk_bytes;
+      p += lens[batch];
+      left -= lens[batch];
+    }
+    lsx_calculate_sha256_many(msgs, lens, batch, leaves);
+    for(l = 0; l < batch; ++l) climb(&check, first + n + l, leaves[l]);
+  }
+  lsx_sha256_tree_digest(check.root, chunk_bytes, object_bytes,
+                         LSX_DEFAULT_POLICY, result);
+  return memcmp(result, digest, SHA256_HASHBYTES) == 0;
+}
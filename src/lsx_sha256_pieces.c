@@ -0,0 +1,186 @@
+#include "lsx.h"
+#include "lsx_sha256_kernels.h"
+#include "lsx_io.h"
+#include "lsx_thread.h"
+
+#include <string.h> /* memset, memcpy */
+
+struct pieces_job {
+  const uint8_t* buf;
+  size_t bytes, piece_bytes, pieces, group_pieces;
+  int policy;
+  uint8_t (*out)[SHA256_HASHBYTES];
+};
+
+static size_t piece_length(size_t bytes, size_t piece_bytes, size_t index) {
+  size_t start = index * piece_bytes;
+  return bytes - start < piece_bytes ? bytes - start : piece_bytes;
+}
+
+static void hash_group(void* arg, size_t index) {
+  const struct pieces_job* job = (const struct pieces_job*)arg;
+  const void* msgs[LSX_SHA256_MAX_LANES];
+  size_t lens[LSX_SHA256_MAX_LANES];
+  size_t piece = index * job->group_pieces, end = piece + job->group_pieces;
+  size_t first;
+  unsigned batch;
+  if(end > job->pieces) end = job->pieces;
+  while(piece < end) {
+    first = piece;
+    for(batch = 0; batch < LSX_SHA256_MAX_LANES && piece < end;
+        ++batch, ++piece) {
+      msgs[batch] = job->buf + piece * job->piece_bytes;
+      lens[batch] = piece_length(job->bytes, job->piece_bytes, piece);
+    }
+    lsx_calculate_sha256_many_policy(msgs, lens, batch, job->policy,
+                                     job->out + first);
+  }
+}
+
+int lsx_sha256_pieces(const void* buf, size_t bytes, size_t piece_bytes,
+                      unsigned threads, uint8_t (*out)[SHA256_HASHBYTES]) {
+  return lsx_sha256_pieces_policy(buf, bytes, piece_bytes, threads,
+                                  LSX_DEFAULT_POLICY, out);
+}
+
+int lsx_sha256_pieces_policy(const void* buf, size_t bytes,
+                             size_t piece_bytes, unsigned threads, int policy,
+                             uint8_t (*out)[SHA256_HASHBYTES]) {
+  struct pieces_job job;
+  unsigned lanes;
+  if(piece_bytes == 0) return 0;
+  if(threads == 0) threads = 1;
+  else if(threads > LSX_MAX_THREADS) threads = LSX_MAX_THREADS;
+  job.buf = (const uint8_t*)buf;
+  job.bytes = bytes;
+  job.piece_bytes = piece_bytes;
+  job.policy = policy;
+  job.pieces = lsx_sha256_count_pieces(bytes, piece_bytes);
+  job.out = out;
+  if(job.pieces == 0) return 1;
+  /* besides telling us the lane count, this picks the kernels now, before
+     other threads could race to do it */
+  lsx_sha256_get_lanes_kernel(&lanes);
+  /* A group fills the SIMD lanes, unless that would leave threads idle */
+  job.group_pieces = lanes;
+  while(job.group_pieces > 1
+        && (job.pieces - 1) / job.group_pieces + 1 < threads)
+    job.group_pieces /= 2;
+  lsx_parallel_for((job.pieces - 1) / job.group_pieces + 1, threads,
+                   hash_group, &job);
+  return 1;
+}
+
+size_t lsx_sha256_pieces_fd(int fd, size_t piece_bytes, unsigned threads,
+                            void* buf, size_t buf_bytes,
+                            uint8_t (*out)[SHA256_HASHBYTES],
+                            size_t max_pieces) {
+  size_t pieces = 0, fill, got, count;
+  if(piece_bytes == 0 || buf_bytes < piece_bytes) return (size_t)-1;
+  /* only whole pieces, so every read but the last ends on a boundary */
+  fill = buf_bytes / piece_bytes * piece_bytes;
+  do {
+    got = lsx_read_fully(fd, buf, fill);
+    if(got == (size_t)-1) return (size_t)-1;
+    count = lsx_sha256_count_pieces(got, piece_bytes);
+    if(count > max_pieces - pieces) return (size_t)-1;
+    lsx_sha256_pieces(buf, got, piece_bytes, threads, out + pieces);
+    pieces += count;
+  } while(got == fill);
+  return pieces;
+}
+
+static int start(lsx_sha256_pieces_context* ctx,
+                 uint8_t (*digests)[SHA256_HASHBYTES], uint8_t* done,
+                 uint64_t bytes, size_t piece_bytes) {
+  uint64_t pieces;
+  if(piece_bytes == 0) return 0;
+  pieces = lsx_sha256_count_pieces(bytes, (uint64_t)piece_bytes);
+  /* every piece needs an index, and a bit in `done` */
+  if(pieces > (size_t)-1 - 7) return 0;
+  ctx->digests = digests;
+  ctx->done = done;
+  ctx->bytes = bytes;
+  ctx->piece_bytes = piece_bytes;
+  ctx->pieces = (size_t)pieces;
+  ctx->policy = LSX_DEFAULT_POLICY;
+  return 1;
+}
+
+int lsx_setup_sha256_pieces(lsx_sha256_pieces_context* ctx,
+                            uint8_t (*digests)[SHA256_HASHBYTES],
+                            uint8_t* done, uint64_t bytes,
+                            size_t piece_bytes) {
+  if(!start(ctx, digests, done, bytes, piece_bytes)) return 0;
+  memset(done, 0, LSX_SHA256_PIECES_DONE_BYTES(ctx->pieces));
+  ctx->remaining = ctx->pieces;
+  return 1;
+}
+
+int lsx_resume_sha256_pieces(lsx_sha256_pieces_context* ctx,
+                             uint8_t (*digests)[SHA256_HASHBYTES],
+                             uint8_t* done, uint64_t bytes,
+                             size_t piece_bytes) {
+  size_t n;
+  if(!start(ctx, digests, done, bytes, piece_bytes)) return 0;
+  ctx->remaining = ctx->pieces;
+  for(n = 0; n < ctx->pieces; ++n)
+    if(lsx_sha256_piece_done(ctx, n)) --ctx->remaining;
+  return 1;
+}
+
+size_t lsx_sha256_piece_bytes(const lsx_sha256_pieces_context* ctx,
+                              size_t index) {
+  uint64_t start;
+  if(index >= ctx->pieces) return 0;
+  start = (uint64_t)index * ctx->piece_bytes;
+  return ctx->bytes - start < ctx->piece_bytes
+    ? (size_t)(ctx->bytes - start) : ctx->piece_bytes;
+}
+
+static void mark_done(lsx_sha256_pieces_context* ctx, size_t index) {
+  if(!lsx_sha256_piece_done(ctx, index)) {
+    ctx->done[index >> 3] |= (uint8_t)(1 << (index & 7));
+    --ctx->remaining;
+  }
+}
+
+int lsx_input_sha256_piece(lsx_sha256_pieces_context* ctx,
+                           size_t index, const void* data, size_t bytes) {
+  if(index >= ctx->pieces || bytes != lsx_sha256_piece_bytes(ctx, index))
+    return 0;
+  lsx_calculate_sha256_policy(data, bytes, ctx->policy, ctx->digests[index]);
+  mark_done(ctx, index);
+  return 1;
+}
+
+size_t lsx_input_sha256_pieces(lsx_sha256_pieces_context* ctx,
+                               const size_t indices[],
+                               const void* const data[], size_t count) {
+  const void* msgs[LSX_SHA256_MAX_LANES];
+  size_t lens[LSX_SHA256_MAX_LANES], which[LSX_SHA256_MAX_LANES];
+  uint8_t digests[LSX_SHA256_MAX_LANES][SHA256_HASHBYTES];
+  size_t n = 0, hashed = 0;
+  unsigned batch, l;
+  while(n < count) {
+    /* gather the next batch of good pieces */
+    for(batch = 0; batch < LSX_SHA256_MAX_LANES && n < count; ++n) {
+      size_t index = indices[n];
+      if(index >= ctx->pieces) continue;
+      which[batch] = index;
+      msgs[batch] = data[n];
+      lens[batch] = lsx_sha256_piece_bytes(ctx, index);
+      ++batch;
+    }
+    /* hashed into a side buffer, since the same index may come up twice */
+    lsx_calculate_sha256_many_policy(msgs, lens, batch, ctx->policy, digests);
+    for(l = 0; l < batch; ++l) {
+      memcpy(ctx->digests[which[l]], digests[l], SHA256_HASHBYTES);
+      mark_done(ctx, which[l]);
+    }
+    hashed += batch;
+  }
+  if(ctx->policy != LSX_POLICY_PUBLIC)
+    lsx_explicit_bzero(digests, sizeof(digests));
+  return hashed;
+}
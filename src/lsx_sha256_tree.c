@@ -0,0 +1,158 @@
+#include "lsx.h"
+#include "lsx_sha256_kernels.h"
+#include "lsx_thread.h"
+
+#include <string.h> /* memcpy */
+
+/* Leaves are gathered into groups, a power of two of them each, and each
+   group is one unit of work for a thread. Every group's root has to be kept
+   until all of them are done, so there's a limit on how many there can be. */
+#define TREE_MAX_GROUPS 256
+
+/* The start of the final block. It keeps tree digests apart from SHA-256
+   digests of anything, including a lone leaf. */
+static const uint8_t tree_tag[16] = {
+  'L','S','X','-','S','H','A','2','5','6','-','T','R','E','E',1,
+};
+
+/* Subtree roots waiting to be combined. Pushing leaf digests (or the roots
+   of equal, power-of-two-sized subtrees) in order and then folding gives the
+   shape described in README.md. Nodes are adjacent, so the top two are
+   always a 64-byte block ready for `lsx_sha256_64to32`. */
+struct tree_stack {
+  uint8_t node[65 * SHA256_HASHBYTES];
+  unsigned depth;
+  uint64_t count;
+};
+
+static void tree_push(struct tree_stack* st,
+                      const uint8_t digest[SHA256_HASHBYTES]) {
+  uint64_t n;
+  memcpy(st->node + st->depth++ * SHA256_HASHBYTES, digest,
+         SHA256_HASHBYTES);
+  /* every trailing zero of the count is a pair of equal subtrees */
+  for(n = ++st->count; !(n & 1); n >>= 1) {
+    uint8_t* pair = st->node + (--st->depth - 1) * SHA256_HASHBYTES;
+    lsx_sha256_64to32(pair, pair);
+  }
+}
+
+static void tree_fold(struct tree_stack* st, uint8_t out[SHA256_HASHBYTES]) {
+  while(st->depth > 1) {
+    uint8_t* pair = st->node + (--st->depth - 1) * SHA256_HASHBYTES;
+    lsx_sha256_64to32(pair, pair);
+  }
+  memcpy(out, st->node, SHA256_HASHBYTES);
+}
+
+struct tree_job {
+  const uint8_t* message;
+  size_t bytes, leaf_bytes, leaves, group_leaves;
+  unsigned lanes;
+  int policy;
+  uint8_t (*roots)[SHA256_HASHBYTES];
+};
+
+static void hash_group(void* arg, size_t index) {
+  const struct tree_job* job = (const struct tree_job*)arg;
+  struct tree_stack st;
+  const void* msgs[LSX_SHA256_MAX_LANES];
+  size_t lens[LSX_SHA256_MAX_LANES];
+  uint8_t digests[LSX_SHA256_MAX_LANES][SHA256_HASHBYTES];
+  size_t leaf = index * job->group_leaves, end = leaf + job->group_leaves;
+  unsigned batch, l;
+  if(end > job->leaves) end = job->leaves;
+  st.depth = 0;
+  st.count = 0;
+  while(leaf < end) {
+    for(batch = 0; batch < job->lanes && leaf < end; ++batch, ++leaf) {
+      size_t start = leaf * job->leaf_bytes;
+      msgs[batch] = job->message + start;
+      lens[batch] = job->bytes - start < job->leaf_bytes
+        ? job->bytes - start : job->leaf_bytes;
+    }
+    lsx_calculate_sha256_many_policy(msgs, lens, batch, job->policy,
+                                     digests);
+    for(l = 0; l < batch; ++l) tree_push(&st, digests[l]);
+  }
+  tree_fold(&st, job->roots[index]);
+  if(job->policy != LSX_POLICY_PUBLIC) {
+    lsx_explicit_bzero(&st, sizeof(st));
+    lsx_explicit_bzero(digests, sizeof(digests));
+  }
+}
+
+static size_t count_groups(size_t leaves, size_t group_leaves) {
+  return (leaves - 1) / group_leaves + 1;
+}
+
+/* sha256 is big-endian */
+static void store_u64(uint64_t value, uint8_t* p) {
+  unsigned n;
+  for(n = 0; n < 8; ++n) p[n] = (uint8_t)(value >> (56 - n * 8));
+}
+
+void lsx_sha256_tree_digest(const uint8_t root[SHA256_HASHBYTES],
+                            uint64_t leaf_bytes, uint64_t bytes, int policy,
+                            uint8_t out[SHA256_HASHBYTES]) {
+  uint8_t final[SHA256_BLOCKBYTES];
+  memcpy(final, tree_tag, sizeof(tree_tag));
+  store_u64(leaf_bytes, final + 16);
+  store_u64(bytes, final + 24);
+  memcpy(final + 32, root, SHA256_HASHBYTES);
+  lsx_sha256_64to32(final, out);
+  if(policy != LSX_POLICY_PUBLIC) lsx_explicit_bzero(final, sizeof(final));
+}
+
+int lsx_calculate_sha256_tree(const void* message, size_t bytes,
+                              size_t leaf_bytes, unsigned threads,
+                              uint8_t out[SHA256_HASHBYTES]) {
+  return lsx_calculate_sha256_tree_policy(message, bytes, leaf_bytes, threads,
+                                          LSX_DEFAULT_POLICY, out);
+}
+
+int lsx_calculate_sha256_tree_policy(const void* message, size_t bytes,
+                                     size_t leaf_bytes, unsigned threads,
+                                     int policy,
+                                     uint8_t out[SHA256_HASHBYTES]) {
+  struct tree_job job;
+  struct tree_stack st;
+  uint8_t roots[TREE_MAX_GROUPS][SHA256_HASHBYTES];
+  uint8_t root[SHA256_HASHBYTES];
+  size_t groups, n;
+  if(leaf_bytes == 0) return 0;
+  if(threads == 0) threads = 1;
+  else if(threads > LSX_MAX_THREADS) threads = LSX_MAX_THREADS;
+  job.message = (const uint8_t*)message;
+  job.bytes = bytes;
+  job.leaf_bytes = leaf_bytes;
+  job.policy = policy;
+  /* an empty message is one empty leaf */
+  job.leaves = bytes / leaf_bytes + (bytes % leaf_bytes != 0);
+  if(job.leaves == 0) job.leaves = 1;
+  /* besides telling us the lane count, this picks the kernels now, before
+     other threads could race to do it */
+  lsx_sha256_get_lanes_kernel(&job.lanes);
+  /* Groups big enough to fill the SIMD lanes, as long as that still leaves
+     every thread a group; and then big enough to fit in `roots` */
+  job.group_leaves = 1;
+  while(job.group_leaves < job.lanes
+        && count_groups(job.leaves, job.group_leaves * 2) >= threads)
+    job.group_leaves *= 2;
+  while(count_groups(job.leaves, job.group_leaves) > TREE_MAX_GROUPS)
+    job.group_leaves *= 2;
+  groups = count_groups(job.leaves, job.group_leaves);
+  job.roots = roots;
+  lsx_parallel_for(groups, threads, hash_group, &job);
+  st.depth = 0;
+  st.count = 0;
+  for(n = 0; n < groups; ++n) tree_push(&st, roots[n]);
+  tree_fold(&st, root);
+  lsx_sha256_tree_digest(root, leaf_bytes, bytes, policy, out);
+  if(policy != LSX_POLICY_PUBLIC) {
+    lsx_explicit_bzero(&st, sizeof(st));
+    lsx_explicit_bzero(roots, sizeof(roots));
+    lsx_explicit_bzero(root, sizeof(root));
+  }
+  return 1;
+}
@@ -0,0 +1,400 @@
+/* SHA-256 kernels that use x86 instruction set extensions. Nothing in here is
+   called unless lsx_cpu_features() says the CPU can run it. */
+
+#include "lsx_sha256_kernels.h"
+
+#if LSX_X86
+
+#include <immintrin.h>
+
+#define subpaste(a,b) a##b
+#define paste(a,b) subpaste(a,b)
+
+/* Four rounds using the SHA extensions. `m` holds W[t..t+3] for t = g*4. For
+   g >= 4, it's first computed in place from the previous sixteen words, which
+   are held (oldest first) in m, m1, m2, m3. */
+#define SHANI_QUAD(g, m) \
+  tmp = _mm_add_epi32(m, _mm_loadu_si128((const __m128i*)(lsx_sha256_k + (g) * 4))); \
+  state1 = _mm_sha256rnds2_epu32(state1, state0, tmp); \
+  tmp = _mm_shuffle_epi32(tmp, 0x0E); \
+  state0 = _mm_sha256rnds2_epu32(state0, state1, tmp)
+#define SHANI_SCHEDULE(m, m1, m2, m3) \
+  m = _mm_sha256msg1_epu32(m, m1); \
+  m = _mm_add_epi32(m, _mm_alignr_epi8(m3, m2, 4)); \
+  m = _mm_sha256msg2_epu32(m, m3)
+
+__attribute__((target("sha,sse4.1")))
+void lsx_sha256_blocks_shani(uint32_t h[8], const uint8_t* input,
+                             size_t blocks, int wipe) {
+  const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                       0x0405060700010203ULL);
+  __m128i state0, state1, tmp, m0, m1, m2, m3, abef, cdgh;
+  /* the schedule lives in registers, so there's nothing to wipe */
+  (void)wipe;
+  /* the instructions want the state as ABEF/CDGH, not ABCD/EFGH */
+  tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)h), 0xB1);
+  state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(h + 4)), 0x1B);
+  state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+  while(blocks-- > 0) {
+    abef = state0;
+    cdgh = state1;
+    m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)input), bswap);
+    m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(input+16)), bswap);
+    m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(input+32)), bswap);
+    m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(input+48)), bswap);
+    input += SHA256_BLOCKBYTES;
+    SHANI_QUAD(0, m0);
+    SHANI_QUAD(1, m1);
+    SHANI_QUAD(2, m2);
+    SHANI_QUAD(3, m3);
+    SHANI_SCHEDULE(m0, m1, m2, m3); SHANI_QUAD(4, m0);
+    SHANI_SCHEDULE(m1, m2, m3, m0); SHANI_QUAD(5, m1);
+    SHANI_SCHEDULE(m2, m3, m0, m1); SHANI_QUAD(6, m2);
+    SHANI_SCHEDULE(m3, m0, m1, m2); SHANI_QUAD(7, m3);
+    SHANI_SCHEDULE(m0, m1, m2, m3); SHANI_QUAD(8, m0);
+    SHANI_SCHEDULE(m1, m2, m3, m0); SHANI_QUAD(9, m1);
+    SHANI_SCHEDULE(m2, m3, m0, m1); SHANI_QUAD(10, m2);
+    SHANI_SCHEDULE(m3, m0, m1, m2); SHANI_QUAD(11, m3);
+    SHANI_SCHEDULE(m0, m1, m2, m3); SHANI_QUAD(12, m0);
+    SHANI_SCHEDULE(m1, m2, m3, m0); SHANI_QUAD(13, m1);
+    SHANI_SCHEDULE(m2, m3, m0, m1); SHANI_QUAD(14, m2);
+    SHANI_SCHEDULE(m3, m0, m1, m2); SHANI_QUAD(15, m3);
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+  }
+  /* back to ABCD/EFGH */
+  tmp = _mm_shuffle_epi32(state0, 0x1B);
+  state1 = _mm_shuffle_epi32(state1, 0xB1);
+  _mm_storeu_si128((__m128i*)h, _mm_blend_epi16(tmp, state1, 0xF0));
+  _mm_storeu_si128((__m128i*)(h + 4), _mm_alignr_epi8(state1, tmp, 8));
+}
+
+/* Kernels that vectorize the message schedule of a single stream, the rounds
+   themselves being inherently serial. The schedule, with the round constants
+   already added, is computed ahead into `wk`; the SSSE3 kernel does one block
+   at a time, the AVX2 kernel two (one per 128-bit half). */
+
+#define ROTR(x,n) (((x) >> (n)) | ((x) << (32-(n))))
+#define WK_ROUND(a,b,c,d,e,f,g,h,q,i) \
+  t = h + (ROTR(e,6) ^ ROTR(e,11) ^ ROTR(e,25)) + (g ^ (e & (f ^ g))) \
+    + (q)[i]; \
+  d += t; \
+  h = t + (ROTR(a,2) ^ ROTR(a,13) ^ ROTR(a,22)) + ((a & b) | (c & (a | b)))
+
+/* rounds, given a precomputed W+K; the caller's target attributes apply, so
+   e.g. the AVX2 kernel gets BMI2 rotates */
+static inline __attribute__((always_inline))
+void rounds_wk(uint32_t H[8], const uint32_t* wk, unsigned stride) {
+  uint32_t a = H[0], b = H[1], c = H[2], d = H[3];
+  uint32_t e = H[4], f = H[5], g = H[6], h = H[7];
+  uint32_t t;
+  /* stride is 4 (one block) or 8 (two blocks, interleaved by quads) */
+#define EIGHT_WK_ROUNDS(i) \
+  WK_ROUND(a,b,c,d,e,f,g,h,wk+(i)/4*stride,0); \
+  WK_ROUND(h,a,b,c,d,e,f,g,wk+(i)/4*stride,1); \
+  WK_ROUND(g,h,a,b,c,d,e,f,wk+(i)/4*stride,2); \
+  WK_ROUND(f,g,h,a,b,c,d,e,wk+(i)/4*stride,3); \
+  WK_ROUND(e,f,g,h,a,b,c,d,wk+((i)/4+1)*stride,0); \
+  WK_ROUND(d,e,f,g,h,a,b,c,wk+((i)/4+1)*stride,1); \
+  WK_ROUND(c,d,e,f,g,h,a,b,wk+((i)/4+1)*stride,2); \
+  WK_ROUND(b,c,d,e,f,g,h,a,wk+((i)/4+1)*stride,3)
+  EIGHT_WK_ROUNDS(0); EIGHT_WK_ROUNDS(8);
+  EIGHT_WK_ROUNDS(16); EIGHT_WK_ROUNDS(24);
+  EIGHT_WK_ROUNDS(32); EIGHT_WK_ROUNDS(40);
+  EIGHT_WK_ROUNDS(48); EIGHT_WK_ROUNDS(56);
+#undef EIGHT_WK_ROUNDS
+  H[0] += a; H[1] += b; H[2] += c; H[3] += d;
+  H[4] += e; H[5] += f; H[6] += g; H[7] += h;
+}
+
+/* W[t..t+3] from the sixteen words before it, oldest first in x0..x3 */
+__attribute__((target("ssse3")))
+static inline __m128i schedule_ssse3(__m128i x0, __m128i x1, __m128i x2,
+                                     __m128i x3) {
+#define VROTR(x,n) _mm_or_si128(_mm_srli_epi32(x,n), _mm_slli_epi32(x,32-(n)))
+#define Vs1(x) _mm_xor_si128(_mm_xor_si128(VROTR(x,17), VROTR(x,19)), \
+                             _mm_srli_epi32(x,10))
+  __m128i w15 = _mm_alignr_epi8(x1, x0, 4), w7 = _mm_alignr_epi8(x3, x2, 4);
+  __m128i s0 = _mm_xor_si128(_mm_xor_si128(VROTR(w15,7), VROTR(w15,18)),
+                             _mm_srli_epi32(w15,3));
+  __m128i ret = _mm_add_epi32(_mm_add_epi32(x0, s0), w7);
+  /* W[t] and W[t+1] depend on W[t-2] and W[t-1]... */
+  ret = _mm_add_epi32(ret, Vs1(_mm_srli_si128(x3, 8)));
+  /* ...and W[t+2] and W[t+3] on W[t] and W[t+1] */
+  ret = _mm_add_epi32(ret, Vs1(_mm_slli_si128(ret, 8)));
+  return ret;
+#undef VROTR
+#undef Vs1
+}
+
+__attribute__((target("avx2")))
+static inline __m256i schedule_avx2(__m256i x0, __m256i x1, __m256i x2,
+                                    __m256i x3) {
+#define VROTR(x,n) _mm256_or_si256(_mm256_srli_epi32(x,n), \
+                                   _mm256_slli_epi32(x,32-(n)))
+#define Vs1(x) _mm256_xor_si256(_mm256_xor_si256(VROTR(x,17), VROTR(x,19)), \
+                                _mm256_srli_epi32(x,10))
+  __m256i w15 = _mm256_alignr_epi8(x1, x0, 4);
+  __m256i w7 = _mm256_alignr_epi8(x3, x2, 4);
+  __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(VROTR(w15,7), VROTR(w15,18)),
+                                _mm256_srli_epi32(w15,3));
+  __m256i ret = _mm256_add_epi32(_mm256_add_epi32(x0, s0), w7);
+  ret = _mm256_add_epi32(ret, Vs1(_mm256_srli_si256(x3, 8)));
+  ret = _mm256_add_epi32(ret, Vs1(_mm256_slli_si256(ret, 8)));
+  return ret;
+#undef VROTR
+#undef Vs1
+}
+
+__attribute__((target("ssse3")))
+void lsx_sha256_blocks_ssse3(uint32_t h[8], const uint8_t* input,
+                             size_t blocks, int wipe) {
+  const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                       0x0405060700010203ULL);
+  uint32_t wk[64];
+  __m128i x[4];
+  unsigned g;
+  while(blocks-- > 0) {
+    for(g = 0; g < 4; ++g)
+      x[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(input+g*16)),
+                              bswap);
+    input += SHA256_BLOCKBYTES;
+    /* unrolled, so that x[] can live in registers */
+#pragma GCC unroll 16
+    for(g = 0; g < 16; ++g) {
+      if(g >= 4)
+        x[g&3] = schedule_ssse3(x[g&3], x[(g+1)&3], x[(g+2)&3], x[(g+3)&3]);
+      _mm_storeu_si128((__m128i*)(wk + g * 4), _mm_add_epi32(x[g&3],
+                       _mm_loadu_si128((const __m128i*)(lsx_sha256_k+g*4))));
+    }
+    rounds_wk(h, wk, 4);
+  }
+  if(wipe) {
+    lsx_explicit_bzero(wk, sizeof(wk));
+    lsx_explicit_bzero(x, sizeof(x));
+  }
+}
+
+/* load two consecutive blocks, one per 128-bit half */
+__attribute__((target("avx2")))
+static inline void load_pair(__m256i x[4], const uint8_t* input) {
+  const __m256i bswap = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                          0x0405060700010203ULL,
+                                          0x0c0d0e0f08090a0bULL,
+                                          0x0405060700010203ULL);
+  unsigned g;
+  for(g = 0; g < 4; ++g) {
+    __m256i both = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(input+g*16))),
+      _mm_loadu_si128((const __m128i*)(input+SHA256_BLOCKBYTES+g*16)), 1);
+    x[g] = _mm256_shuffle_epi8(both, bswap);
+  }
+}
+
+/* compute (if g >= 4) and store W+K for group `g` of a pair */
+#define SCHEDULE_PAIR(wk, g) \
+  if((g) >= 4) \
+    x[(g)&3] = schedule_avx2(x[(g)&3], x[((g)+1)&3], x[((g)+2)&3], \
+                             x[((g)+3)&3]); \
+  _mm256_storeu_si256((__m256i*)((wk) + (g) * 8), _mm256_add_epi32(x[(g)&3], \
+    _mm256_broadcastsi128_si256( \
+      _mm_loadu_si128((const __m128i*)(lsx_sha256_k + (g) * 4)))))
+
+/* The schedule is a long serial dependency chain, and so are the rounds; on
+   their own, neither keeps the CPU busy. So, like Intel's "rorx" code, this
+   schedules the next pair of blocks while doing the rounds for this one. */
+__attribute__((target("avx2,bmi2")))
+void lsx_sha256_blocks_avx2(uint32_t H[8], const uint8_t* input,
+                            size_t blocks, int wipe) {
+  /* two pairs' worth (this one and the next), each with its two blocks
+     interleaved four words at a time */
+  uint32_t wk[2][128];
+  __m256i x[4];
+  size_t pairs = blocks / 2;
+  unsigned cur = 0, group, half, j;
+  if(pairs > 0) {
+    load_pair(x, input);
+    input += SHA256_BLOCKBYTES * 2;
+    for(group = 0; group < 16; ++group) { SCHEDULE_PAIR(wk[0], group); }
+  }
+  while(pairs-- > 0) {
+    const uint32_t* now = wk[cur];
+    uint32_t* next = wk[cur ^ 1];
+    int more = pairs > 0;
+    if(more) {
+      load_pair(x, input);
+      input += SHA256_BLOCKBYTES * 2;
+      for(group = 0; group < 4; ++group) { SCHEDULE_PAIR(next, group); }
+    }
+#pragma GCC unroll 2
+    for(half = 0; half < 2; ++half) {
+      uint32_t a = H[0], b = H[1], c = H[2], d = H[3];
+      uint32_t e = H[4], f = H[5], g = H[6], h = H[7];
+      uint32_t t;
+      /* unrolled, so that x[] can live in registers */
+#pragma GCC unroll 8
+      for(j = 0; j < 8; ++j) {
+        /* eight rounds, then one group of the next pair's schedule (groups
+           4-11 during the first block, 12-15 during the second) */
+        const uint32_t* q = now + j * 16 + half * 4;
+        WK_ROUND(a,b,c,d,e,f,g,h,q,0); WK_ROUND(h,a,b,c,d,e,f,g,q,1);
+        WK_ROUND(g,h,a,b,c,d,e,f,q,2); WK_ROUND(f,g,h,a,b,c,d,e,q,3);
+        WK_ROUND(e,f,g,h,a,b,c,d,q+8,0); WK_ROUND(d,e,f,g,h,a,b,c,q+8,1);
+        WK_ROUND(c,d,e,f,g,h,a,b,q+8,2); WK_ROUND(b,c,d,e,f,g,h,a,q+8,3);
+        if(more && half * 8 + j < 12) {
+          unsigned sg = 4 + half * 8 + j;
+          SCHEDULE_PAIR(next, sg);
+        }
+      }
+      H[0] += a; H[1] += b; H[2] += c; H[3] += d;
+      H[4] += e; H[5] += f; H[6] += g; H[7] += h;
+    }
+    cur ^= 1;
+  }
+  if(blocks & 1) {
+    /* one left over; schedule it in the low half alone */
+    const __m256i bswap = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                            0x0405060700010203ULL,
+                                            0x0c0d0e0f08090a0bULL,
+                                            0x0405060700010203ULL);
+    for(group = 0; group < 4; ++group)
+      x[group] = _mm256_shuffle_epi8(_mm256_inserti128_si256(
+               _mm256_setzero_si256(),
+               _mm_loadu_si128((const __m128i*)(input+group*16)), 0), bswap);
+    for(group = 0; group < 16; ++group) { SCHEDULE_PAIR(wk[0], group); }
+    rounds_wk(H, wk[0], 8);
+  }
+  if(wipe) {
+    lsx_explicit_bzero(wk, sizeof(wk));
+    lsx_explicit_bzero(x, sizeof(x));
+  }
+}
+#undef SCHEDULE_PAIR
+
+#undef ROTR
+#undef WK_ROUND
+
+/* Multi-buffer kernels: one block from each of 4 or 8 messages at once */
+
+/* byte swap each word, the hard way (SSE2 has no byte shuffle) */
+__attribute__((target("sse2")))
+static inline __m128i bswap_sse2(__m128i x) {
+  x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1);
+}
+
+/* transpose four 4x4 word matrices */
+__attribute__((target("sse2")))
+static inline void load_message4(__m128i w[16], const uint8_t* const b[4]) {
+  unsigned q;
+  for(q = 0; q < 4; ++q) {
+    __m128i r0 = _mm_loadu_si128((const __m128i*)(b[0] + q * 16));
+    __m128i r1 = _mm_loadu_si128((const __m128i*)(b[1] + q * 16));
+    __m128i r2 = _mm_loadu_si128((const __m128i*)(b[2] + q * 16));
+    __m128i r3 = _mm_loadu_si128((const __m128i*)(b[3] + q * 16));
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpackhi_epi32(r0, r1);
+    __m128i t2 = _mm_unpacklo_epi32(r2, r3), t3 = _mm_unpackhi_epi32(r2, r3);
+    w[q*4+0] = bswap_sse2(_mm_unpacklo_epi64(t0, t2));
+    w[q*4+1] = bswap_sse2(_mm_unpackhi_epi64(t0, t2));
+    w[q*4+2] = bswap_sse2(_mm_unpacklo_epi64(t1, t3));
+    w[q*4+3] = bswap_sse2(_mm_unpackhi_epi64(t1, t3));
+  }
+}
+
+/* transpose two 8x8 word matrices */
+__attribute__((target("avx2")))
+static inline void load_message8(__m256i w[16], const uint8_t* const b[8]) {
+  const __m256i bswap = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                          0x0405060700010203ULL,
+                                          0x0c0d0e0f08090a0bULL,
+                                          0x0405060700010203ULL);
+  unsigned half;
+  for(half = 0; half < 2; ++half) {
+    __m256i r[8], t[8], u[8];
+    unsigned l;
+    for(l = 0; l < 8; ++l)
+      r[l] = _mm256_loadu_si256((const __m256i*)(b[l] + half * 32));
+    for(l = 0; l < 8; l += 2) {
+      t[l] = _mm256_unpacklo_epi32(r[l], r[l+1]);
+      t[l+1] = _mm256_unpackhi_epi32(r[l], r[l+1]);
+    }
+    for(l = 0; l < 8; l += 4) {
+      u[l+0] = _mm256_unpacklo_epi64(t[l], t[l+2]);
+      u[l+1] = _mm256_unpackhi_epi64(t[l], t[l+2]);
+      u[l+2] = _mm256_unpacklo_epi64(t[l+1], t[l+3]);
+      u[l+3] = _mm256_unpackhi_epi64(t[l+1], t[l+3]);
+    }
+    for(l = 0; l < 4; ++l) {
+      w[half*8+l] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[l], u[l+4], 0x20), bswap);
+      w[half*8+l+4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[l], u[l+4], 0x31), bswap);
+    }
+  }
+}
+
+#define lanes 4
+#define lanes_target __attribute__((target("sse2")))
+#define vec __m128i
+#define V_LOAD(p) _mm_loadu_si128((const __m128i*)(p))
+#define V_STORE(p,x) _mm_storeu_si128((__m128i*)(p), x)
+#define V_SET1(x) _mm_set1_epi32((int)(x))
+#define V_ADD _mm_add_epi32
+#define V_XOR _mm_xor_si128
+#define V_AND _mm_and_si128
+#define V_ANDNOT _mm_andnot_si128
+#define V_OR _mm_or_si128
+#define V_SRL _mm_srli_epi32
+#define V_SLL _mm_slli_epi32
+#define V_LOAD_MESSAGE load_message4
+#include "lsx_sha256_lanes.h"
+#undef lanes
+#undef lanes_target
+#undef vec
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1
+#undef V_ADD
+#undef V_XOR
+#undef V_AND
+#undef V_ANDNOT
+#undef V_OR
+#undef V_SRL
+#undef V_SLL
+#undef V_LOAD_MESSAGE
+
+#define lanes 8
+#define lanes_target __attribute__((target("avx2")))
+#define vec __m256i
+#define V_LOAD(p) _mm256_loadu_si256((const __m256i*)(p))
+#define V_STORE(p,x) _mm256_storeu_si256((__m256i*)(p), x)
+#define V_SET1(x) _mm256_set1_epi32((int)(x))
+#define V_ADD _mm256_add_epi32
+#define V_XOR _mm256_xor_si256
+#define V_AND _mm256_and_si256
+#define V_ANDNOT _mm256_andnot_si256
+#define V_OR _mm256_or_si256
+#define V_SRL _mm256_srli_epi32
+#define V_SLL _mm256_slli_epi32
+#define V_LOAD_MESSAGE load_message8
+#include "lsx_sha256_lanes.h"
+#undef lanes
+#undef lanes_target
+#undef vec
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1
+#undef V_ADD
+#undef V_XOR
+#undef V_AND
+#undef V_ANDNOT
+#undef V_OR
+#undef V_SRL
+#undef V_SLL
+#undef V_LOAD_MESSAGE
+
+#else
+
+/* ISO C doesn't allow an empty translation unit */
+typedef int lsx_sha256_x86_unused;
+
+#endif
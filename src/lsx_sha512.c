@@ -0,0 +1,254 @@
+#include "lsx.h"
+
+#include <string.h> /* memcpy, memset */
+#include <assert.h>
+
+/* sha512 is big-endian, too */
+#define bytes_to_int64(p) (((uint64_t)(p)[0] << 56) | ((uint64_t)(p)[1] << 48) | ((uint64_t)(p)[2] << 40) | ((uint64_t)(p)[3] << 32) | ((uint64_t)(p)[4] << 24) | ((uint64_t)(p)[5] << 16) | ((uint64_t)(p)[6] << 8) | (uint64_t)(p)[7])
+#define int64_to_bytes(word, p) ((p)[0] = (uint8_t)((word)>>56), (p)[1] = (uint8_t)((word)>>48), (p)[2] = (uint8_t)((word)>>40), (p)[3] = (uint8_t)((word)>>32), (p)[4] = (uint8_t)((word)>>24), (p)[5] = (uint8_t)((word)>>16), (p)[6] = (uint8_t)((word)>>8), (p)[7] = (uint8_t)(word))
+
+#define rotate_right(a,i) (((a)>>i)|((a)<<(64-i)))
+
+/* A faster bytes_to_int64, where the compiler lets us have one */
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__BYTE_ORDER__)
+# if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#  define load_be64(p) (memcpy(&load_tmp, (p), 8), load_tmp)
+# else
+#  define load_be64(p) (memcpy(&load_tmp, (p), 8), __builtin_bswap64(load_tmp))
+# endif
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+# include <intrin.h>
+# define load_be64(p) (memcpy(&load_tmp, (p), 8), _byteswap_uint64(load_tmp))
+#else
+# define load_be64(p) bytes_to_int64(p)
+#endif
+
+static const uint64_t k[80] = {
+  0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+  0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+  0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+  0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+  0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+  0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+  0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+  0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+  0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+  0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+  0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+  0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+  0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+  0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+  0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+  0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+  0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+  0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+  0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+  0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+  0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+  0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+  0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+  0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+  0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+  0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+  0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+static const uint64_t sha512_iv[8] = {
+  0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL,
+  0xa54ff53a5f1d36f1ULL, 0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+  0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+static const uint64_t sha384_iv[8] = {
+  0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL, 0x9159015a3070dd17ULL,
+  0x152fecd8f70e5939ULL, 0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL,
+  0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL,
+};
+static const uint64_t sha512_256_iv[8] = {
+  0x22312194fc2bf72cULL, 0x9f555fa3c84c64c2ULL, 0x2393b86b6f53b151ULL,
+  0x963877195940eabdULL, 0x96283ee2a88effe3ULL, 0xbe5e1e2553863992ULL,
+  0x2b0199fc2c85b8aaULL, 0x0eb72ddc81c52ca2ULL,
+};
+
+static void setup(lsx_sha512_expert_context* ctx, const uint64_t iv[8],
+                  unsigned int hash_bytes) {
+  memcpy(ctx->h, iv, sizeof(ctx->h));
+  ctx->bytes_so_far = 0;
+  ctx->hash_bytes = hash_bytes;
+  ctx->policy = LSX_DEFAULT_POLICY;
+}
+
+void lsx_setup_sha512_expert(lsx_sha512_expert_context* ctx) {
+  setup(ctx, sha512_iv, SHA512_HASHBYTES);
+}
+
+void lsx_setup_sha384_expert(lsx_sha512_expert_context* ctx) {
+  setup(ctx, sha384_iv, SHA384_HASHBYTES);
+}
+
+void lsx_setup_sha512_256_expert(lsx_sha512_expert_context* ctx) {
+  setup(ctx, sha512_256_iv, SHA512_256_HASHBYTES);
+}
+
+/* Built the same way as the unrolled SHA-256 kernel, with 80 rounds of 64-bit
+   words instead of 64 rounds of 32-bit ones. */
+#define Sigma0(x) (rotate_right(x,28) ^ rotate_right(x,34) ^ rotate_right(x,39))
+#define Sigma1(x) (rotate_right(x,14) ^ rotate_right(x,18) ^ rotate_right(x,41))
+#define sigma0(x) (rotate_right(x,1) ^ rotate_right(x,8) ^ ((x)>>7))
+#define sigma1(x) (rotate_right(x,19) ^ rotate_right(x,61) ^ ((x)>>6))
+#define Ch(e,f,g) ((g) ^ ((e) & ((f) ^ (g))))
+#define Maj(a,b,c) (((a) & (b)) | ((c) & ((a) | (b))))
+/* round i (mod 16) of the sixteen starting at round j */
+#define ROUND(a,b,c,d,e,f,g,h,i,j) \
+  t = h + Sigma1(e) + Ch(e,f,g) + k[(i)+(j)] + w[i]; \
+  d += t; \
+  h = t + Sigma0(a) + Maj(a,b,c)
+#define LOAD(i) w[i] = load_be64(input + (i) * 8)
+#define SCHEDULE(i) \
+  w[i] += sigma0(w[((i)+1)&15]) + w[((i)+9)&15] + sigma1(w[((i)+14)&15])
+#define SIXTEEN_ROUNDS(j, PREP) \
+  PREP(0); ROUND(a,b,c,d,e,f,g,h,0,j); PREP(1); ROUND(h,a,b,c,d,e,f,g,1,j); \
+  PREP(2); ROUND(g,h,a,b,c,d,e,f,2,j); PREP(3); ROUND(f,g,h,a,b,c,d,e,3,j); \
+  PREP(4); ROUND(e,f,g,h,a,b,c,d,4,j); PREP(5); ROUND(d,e,f,g,h,a,b,c,5,j); \
+  PREP(6); ROUND(c,d,e,f,g,h,a,b,6,j); PREP(7); ROUND(b,c,d,e,f,g,h,a,7,j); \
+  PREP(8); ROUND(a,b,c,d,e,f,g,h,8,j); PREP(9); ROUND(h,a,b,c,d,e,f,g,9,j); \
+  PREP(10); ROUND(g,h,a,b,c,d,e,f,10,j); PREP(11); ROUND(f,g,h,a,b,c,d,e,11,j); \
+  PREP(12); ROUND(e,f,g,h,a,b,c,d,12,j); PREP(13); ROUND(d,e,f,g,h,a,b,c,13,j); \
+  PREP(14); ROUND(c,d,e,f,g,h,a,b,14,j); PREP(15); ROUND(b,c,d,e,f,g,h,a,15,j)
+void lsx_input_sha512_expert(lsx_sha512_expert_context* ctx,
+                             const void* _input, size_t blocks) {
+  uint64_t a, b, c, d, e, f, g, h, t;
+  uint64_t w[16];
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+  uint64_t load_tmp;
+#endif
+  uint64_t* H = ctx->h;
+  const uint8_t* input = (const uint8_t*)_input;
+  ctx->bytes_so_far += blocks * SHA512_BLOCKBYTES;
+  while(blocks-- > 0) {
+    a = H[0]; b = H[1]; c = H[2]; d = H[3];
+    e = H[4]; f = H[5]; g = H[6]; h = H[7];
+    SIXTEEN_ROUNDS(0, LOAD);
+    SIXTEEN_ROUNDS(16, SCHEDULE);
+    SIXTEEN_ROUNDS(32, SCHEDULE);
+    SIXTEEN_ROUNDS(48, SCHEDULE);
+    SIXTEEN_ROUNDS(64, SCHEDULE);
+    input += SHA512_BLOCKBYTES;
+    H[0] += a; H[1] += b; H[2] += c; H[3] += d;
+    H[4] += e; H[5] += f; H[6] += g; H[7] += h;
+  }
+  if(ctx->policy != LSX_POLICY_PUBLIC) lsx_explicit_bzero(w, sizeof(w));
+}
+#undef Sigma0
+#undef Sigma1
+#undef sigma0
+#undef sigma1
+#undef Ch
+#undef Maj
+#undef ROUND
+#undef LOAD
+#undef SCHEDULE
+#undef SIXTEEN_ROUNDS
+
+void lsx_finish_sha512_expert(lsx_sha512_expert_context* ctx,
+                              const void* input, size_t bytes,
+                              uint8_t* out) {
+  unsigned i;
+  uint8_t buf[SHA512_BLOCKBYTES];
+  if(bytes >= SHA512_BLOCKBYTES) {
+    size_t blocks = bytes / SHA512_BLOCKBYTES;
+    lsx_input_sha512_expert(ctx, input, blocks);
+    input = (const uint8_t*)input + SHA512_BLOCKBYTES * blocks;
+    bytes = bytes - SHA512_BLOCKBYTES * blocks;
+  }
+  /* assert(bytes < SHA512_BLOCKBYTES) */
+  /* the length is 128 bits; we only count bytes in 64 */
+  uint64_t total_bytes = ctx->bytes_so_far + bytes;
+  memcpy(buf, input, bytes);
+  buf[bytes] = 0x80;
+  if(bytes > SHA512_BLOCKBYTES - 17) {
+    memset(buf + bytes + 1, 0, SHA512_BLOCKBYTES - bytes - 1);
+    lsx_input_sha512_expert(ctx, buf, 1);
+    memset(buf, 0, bytes + 1);
+  }
+  else {
+    memset(buf + bytes + 1, 0, SHA512_BLOCKBYTES - 16 - bytes - 1);
+  }
+  int64_to_bytes(total_bytes >> 61, buf + SHA512_BLOCKBYTES - 16);
+  int64_to_bytes(total_bytes << 3, buf + SHA512_BLOCKBYTES - 8);
+  lsx_input_sha512_expert(ctx, buf, 1);
+  for(i = 0; i < ctx->hash_bytes / 8; ++i) {
+    int64_to_bytes(ctx->h[i], out + i * 8);
+  }
+  if(ctx->policy != LSX_POLICY_PUBLIC) lsx_explicit_bzero(buf, sizeof(buf));
+}
+
+void lsx_setup_sha512(lsx_sha512_context* ctx) {
+  lsx_setup_sha512_expert(&ctx->expert);
+  ctx->num_buffered_bytes = 0;
+}
+
+void lsx_setup_sha384(lsx_sha512_context* ctx) {
+  lsx_setup_sha384_expert(&ctx->expert);
+  ctx->num_buffered_bytes = 0;
+}
+
+void lsx_setup_sha512_256(lsx_sha512_context* ctx) {
+  lsx_setup_sha512_256_expert(&ctx->expert);
+  ctx->num_buffered_bytes = 0;
+}
+
+void lsx_input_sha512(lsx_sha512_context* ctx,
+                      const void* input, size_t bytes) {
+  if(ctx->num_buffered_bytes) {
+    size_t bytes_to_add = bytes;
+    if(ctx->num_buffered_bytes + bytes_to_add > SHA512_BLOCKBYTES)
+      bytes_to_add = SHA512_BLOCKBYTES - ctx->num_buffered_bytes;
+    memcpy(ctx->buf + ctx->num_buffered_bytes, input, bytes_to_add);
+    ctx->num_buffered_bytes += bytes_to_add;
+    bytes -= bytes_to_add;
+    input = (const uint8_t*)input + bytes_to_add;
+    if(ctx->num_buffered_bytes == SHA512_BLOCKBYTES) {
+      lsx_input_sha512_expert(&ctx->expert, ctx->buf, 1);
+      ctx->num_buffered_bytes = 0;
+    }
+  }
+  if(bytes >= SHA512_BLOCKBYTES) {
+    size_t blocks = bytes / SHA512_BLOCKBYTES;
+    lsx_input_sha512_expert(&ctx->expert, input, blocks);
+    input = (const uint8_t*)input + SHA512_BLOCKBYTES * blocks;
+    bytes = bytes - SHA512_BLOCKBYTES * blocks;
+  }
+  if(bytes > 0) {
+    assert(ctx->num_buffered_bytes == 0);
+    memcpy(ctx->buf, input, (ctx->num_buffered_bytes = bytes));
+  }
+}
+
+void lsx_finish_sha512(lsx_sha512_context* ctx, uint8_t* out) {
+  lsx_finish_sha512_expert(&ctx->expert,
+                           ctx->buf, ctx->num_buffered_bytes,
+                           out);
+}
+
+static void calculate(void (*setup_func)(lsx_sha512_expert_context*),
+                      const void* message, size_t bytes, uint8_t* out) {
+  lsx_sha512_expert_context ctx;
+  setup_func(&ctx);
+  lsx_finish_sha512_expert(&ctx, message, bytes, out);
+  if(ctx.policy != LSX_POLICY_PUBLIC) lsx_destroy_sha512_expert(&ctx);
+}
+
+void lsx_calculate_sha512(const void* message, size_t bytes,
+                          uint8_t out[SHA512_HASHBYTES]) {
+  calculate(lsx_setup_sha512_expert, message, bytes, out);
+}
+
+void lsx_calculate_sha384(const void* message, size_t bytes,
+                          uint8_t out[SHA384_HASHBYTES]) {
+  calculate(lsx_setup_sha384_expert, message, bytes, out);
+}
+
+void lsx_calculate_sha512_256(const void* message, size_t bytes,
+                              uint8_t out[SHA512_256_HASHBYTES]) {
+  calculate(lsx_setup_sha512_256_expert, message, bytes, out);
+}
@@ -0,0 +1,220 @@
+#include "lsx.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lsx_test_common.h"
+
+/* The test vectors from RFC 4648 */
+static const struct known_answer {
+  const char* data;
+  const char* hex;
+  const char* base64;
+} known_answers[] = {
+  {"", "", ""},
+  {"f", "66", "Zg=="},
+  {"fo", "666f", "Zm8="},
+  {"foo", "666f6f", "Zm9v"},
+  {"foob", "666f6f62", "Zm9vYg=="},
+  {"fooba", "666f6f6261", "Zm9vYmE="},
+  {"foobar", "666f6f626172", "Zm9vYmFy"},
+};
+
+/* Long enough for every kernel to take several steps, and then some */
+#define MAX_BYTES 300
+static uint8_t data[MAX_BYTES];
+/* the portable implementation's answers, to hold the others to */
+static char reference_hex[MAX_BYTES + 1][LSX_HEX_CHARS(MAX_BYTES)];
+static char reference_base64[MAX_BYTES + 1][LSX_BASE64_CHARS(MAX_BYTES)];
+
+static void make_data(void) {
+  fill_pseudorandom(data, sizeof(data), 0xC0DEC);
+  lsx_set_codec_implementation(LSX_CODEC_IMPL_SCALAR);
+  for(unsigned n = 0; n <= MAX_BYTES; ++n) {
+    lsx_hex_encode(data, n, reference_hex[n]);
+    lsx_base64_encode(data, n, reference_base64[n]);
+  }
+}
+
+/* Everything is copied into buffers of exactly the right size, so that a
+   memory checker will catch any kernel reading or writing out of bounds */
+static char* exact_copy(const void* p, size_t bytes) {
+  char* ret = malloc(bytes ? bytes : 1);
+  memcpy(ret, p, bytes);
+  return ret;
+}
+
+static int test_known(void) {
+  for(unsigned n = 0; n < elementcount(known_answers); ++n) {
+    const struct known_answer* el = known_answers + n;
+    size_t bytes = strlen(el->data);
+    char hex[16], base64[16];
+    uint8_t decoded[16];
+    lsx_hex_encode(el->data, bytes, hex);
+    lsx_base64_encode(el->data, bytes, base64);
+    if(memcmp(hex, el->hex, LSX_HEX_CHARS(bytes))
+       || memcmp(base64, el->base64, LSX_BASE64_CHARS(bytes))
+       || lsx_hex_decode(el->hex, strlen(el->hex), decoded) != bytes
+       || memcmp(decoded, el->data, bytes)
+       || lsx_base64_decode(el->base64, strlen(el->base64), decoded) != bytes
+       || memcmp(decoded, el->data, bytes)) {
+      fprintf(stderr, "Codec known answer %u failed!\n", n);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int test_round_trip(void) {
+  for(unsigned n = 0; n <= MAX_BYTES; ++n) {
+    char* in = exact_copy(data, n);
+    char* hex = malloc(n ? LSX_HEX_CHARS(n) : 1);
+    char* base64 = malloc(n ? LSX_BASE64_CHARS(n) : 1);
+    uint8_t* out = malloc(n ? n : 1);
+    int bad = 0;
+    lsx_hex_encode(in, n, hex);
+    lsx_base64_encode(in, n, base64);
+    if(memcmp(hex, reference_hex[n], LSX_HEX_CHARS(n))) {
+      fprintf(stderr, "Hex encoding of %u bytes failed!\n", n);
+      bad = 1;
+    }
+    else if(memcmp(base64, reference_base64[n], LSX_BASE64_CHARS(n))) {
+      fprintf(stderr, "Base64 encoding of %u bytes failed!\n", n);
+      bad = 1;
+    }
+    else if(lsx_hex_decode(hex, LSX_HEX_CHARS(n), out) != n
+            || memcmp(out, data, n)) {
+      fprintf(stderr, "Hex decoding of %u bytes failed!\n", n);
+      bad = 1;
+    }
+    else if(lsx_base64_decode(base64, LSX_BASE64_CHARS(n), out) != n
+            || memcmp(out, data, n)) {
+      fprintf(stderr, "Base64 decoding of %u bytes failed!\n", n);
+      bad = 1;
+    }
+    else {
+      /* uppercase hex is fine too */
+      for(size_t i = 0; i < LSX_HEX_CHARS(n); ++i)
+        if(hex[i] >= 'a') hex[i] -= 'a' - 'A';
+      if(lsx_hex_decode(hex, LSX_HEX_CHARS(n), out) != n
+         || memcmp(out, data, n)) {
+        fprintf(stderr, "Uppercase hex decoding of %u bytes failed!\n", n);
+        bad = 1;
+      }
+    }
+    free(in);
+    free(hex);
+    free(base64);
+    free(out);
+    if(bad) return 1;
+  }
+  return 0;
+}
+
+/* Put every possible byte at every position of an encoding, and make sure
+   each one is accepted or refused the same way the portable code does */
+static int test_garbage(int impl) {
+  const unsigned n = 100;
+  char* hex = exact_copy(reference_hex[n], LSX_HEX_CHARS(n));
+  char* base64 = exact_copy(reference_base64[n], LSX_BASE64_CHARS(n));
+  /* a garbled padding character can make for a longer (valid) decoding */
+  uint8_t* out = malloc(LSX_BASE64_CHARS(n) / 4 * 3);
+  uint8_t* known = malloc(LSX_BASE64_CHARS(n) / 4 * 3);
+  int ret = 0;
+  for(unsigned i = 0; i < LSX_BASE64_CHARS(n) && !ret; ++i) {
+    for(unsigned c = 0; c < 256 && !ret; ++c) {
+      size_t kn, re;
+      if(i < LSX_HEX_CHARS(n)) {
+        hex[i] = (char)c;
+        lsx_set_codec_implementation(LSX_CODEC_IMPL_SCALAR);
+        kn = lsx_hex_decode(hex, LSX_HEX_CHARS(n), known);
+        lsx_set_codec_implementation(impl);
+        re = lsx_hex_decode(hex, LSX_HEX_CHARS(n), out);
+        if(kn != re || (kn != (size_t)-1 && memcmp(known, out, n))) {
+          fprintf(stderr, "Hex decoding with %02X at %u went wrong!\n", c, i);
+          ret = 1;
+        }
+        hex[i] = reference_hex[n][i];
+      }
+      base64[i] = (char)c;
+      lsx_set_codec_implementation(LSX_CODEC_IMPL_SCALAR);
+      kn = lsx_base64_decode(base64, LSX_BASE64_CHARS(n), known);
+      lsx_set_codec_implementation(impl);
+      re = lsx_base64_decode(base64, LSX_BASE64_CHARS(n), out);
+      if(kn != re || (kn != (size_t)-1 && memcmp(known, out, kn))) {
+        fprintf(stderr, "Base64 decoding with %02X at %u went wrong!\n", c, i);
+        ret = 1;
+      }
+      base64[i] = reference_base64[n][i];
+    }
+  }
+  free(hex);
+  free(base64);
+  free(out);
+  free(known);
+  return ret;
+}
+
+static int test_malformed(void) {
+  static const char* const bad_base64[] = {
+    "Zg=", "Zg", "Z===", "Zg=a", "Zh==", "Zm9=", "Zg==Zg==", "Zm 9v",
+  };
+  uint8_t out[16];
+  if(lsx_hex_decode("abc", 3, out) != (size_t)-1
+     || lsx_hex_decode("0g", 2, out) != (size_t)-1) {
+    fprintf(stderr, "Hex decoding accepted garbage!\n");
+    return 1;
+  }
+  for(unsigned n = 0; n < elementcount(bad_base64); ++n) {
+    if(lsx_base64_decode(bad_base64[n], strlen(bad_base64[n]), out)
+       != (size_t)-1) {
+      fprintf(stderr, "Base64 decoding accepted \"%s\"!\n", bad_base64[n]);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int test_many(void) {
+  static const size_t sizes[] = {32, 33, 48};
+  for(unsigned s = 0; s < elementcount(sizes); ++s) {
+    const size_t bytes = sizes[s], count = MAX_BYTES / bytes;
+    char many[LSX_BASE64_CHARS(MAX_BYTES) * 2];
+    char hex[LSX_HEX_CHARS(MAX_BYTES)];
+    lsx_base64_encode_many(data, bytes, count, many);
+    for(size_t n = 0; n < count; ++n) {
+      char one[LSX_BASE64_CHARS(48)];
+      lsx_base64_encode(data + n * bytes, bytes, one);
+      if(memcmp(one, many + n * LSX_BASE64_CHARS(bytes),
+                LSX_BASE64_CHARS(bytes))) {
+        fprintf(stderr, "Base64 encoding of %u items of %u bytes failed!\n",
+                (unsigned)count, (unsigned)bytes);
+        return 1;
+      }
+    }
+    lsx_hex_encode_many(data, bytes, count, hex);
+    if(memcmp(hex, reference_hex[MAX_BYTES], LSX_HEX_CHARS(bytes * count))) {
+      fprintf(stderr, "Hex encoding of %u items of %u bytes failed!\n",
+              (unsigned)count, (unsigned)bytes);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int test_impl(void) {
+  return test_known() || test_round_trip() || test_malformed() || test_many()
+    || test_garbage(lsx_get_codec_implementation());
+}
+
+static const char* const impl_names[] = {
+  "auto", "scalar", "SSSE3", "AVX2",
+};
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  make_data();
+  return for_each_impl(lsx_set_codec_implementation, impl_names, "codec",
+                       test_impl);
+}
@@ -0,0 +1,142 @@
+#include "lsx.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lsx_test_common.h"
+
+#define MAX_OKM_BYTES 1000
+
+static const struct known_answer {
+  const void* salt;
+  size_t saltlen;
+  const void* ikm;
+  size_t ikmlen;
+  const void* info;
+  size_t infolen;
+  size_t okmlen;
+  uint8_t okm[MAX_OKM_BYTES];
+} known_answers[] = {
+#define KA(str) str, sizeof(str)-1
+  /* RFC 5869 test case 1 */
+  {KA("\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c"),
+   KA("\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b"),
+   KA("\xf0\xf1\xf2\xf3\xf4\xf5\xf6\xf7\xf8\xf9"),
+   42, {0x3c,0xb2,0x5f,0x25,0xfa,0xac,0xd5,0x7a,0x90,0x43,0x4f,0x64,0xd0,0x36,0x2f,0x2a,0x2d,0x2d,0x0a,0x90,0xcf,0x1a,0x5a,0x4c,0x5d,0xb0,0x2d,0x56,0xec,0xc4,0xc5,0xbf,0x34,0x00,0x72,0x08,0xd5,0xb8,0x87,0x18,0x58,0x65}},
+  /* RFC 5869 test case 2 */
+  {KA("\x60\x61\x62\x63\x64\x65\x66\x67\x68\x69\x6a\x6b\x6c\x6d\x6e\x6f\x70\x71\x72\x73\x74\x75\x76\x77\x78\x79\x7a\x7b\x7c\x7d\x7e\x7f\x80\x81\x82\x83\x84\x85\x86\x87\x88\x89\x8a\x8b\x8c\x8d\x8e\x8f\x90\x91\x92\x93\x94\x95\x96\x97\x98\x99\x9a\x9b\x9c\x9d\x9e\x9f\xa0\xa1\xa2\xa3\xa4\xa5\xa6\xa7\xa8\xa9\xaa\xab\xac\xad\xae\xaf"),
+   KA("\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f\x20\x21\x22\x23\x24\x25\x26\x27\x28\x29\x2a\x2b\x2c\x2d\x2e\x2f\x30\x31\x32\x33\x34\x35\x36\x37\x38\x39\x3a\x3b\x3c\x3d\x3e\x3f\x40\x41\x42\x43\x44\x45\x46\x47\x48\x49\x4a\x4b\x4c\x4d\x4e\x4f"),
+   KA("\xb0\xb1\xb2\xb3\xb4\xb5\xb6\xb7\xb8\xb9\xba\xbb\xbc\xbd\xbe\xbf\xc0\xc1\xc2\xc3\xc4\xc5\xc6\xc7\xc8\xc9\xca\xcb\xcc\xcd\xce\xcf\xd0\xd1\xd2\xd3\xd4\xd5\xd6\xd7\xd8\xd9\xda\xdb\xdc\xdd\xde\xdf\xe0\xe1\xe2\xe3\xe4\xe5\xe6\xe7\xe8\xe9\xea\xeb\xec\xed\xee\xef\xf0\xf1\xf2\xf3\xf4\xf5\xf6\xf7\xf8\xf9\xfa\xfb\xfc\xfd\xfe\xff"),
+   82, {0xb1,0x1e,0x39,0x8d,0xc8,0x03,0x27,0xa1,0xc8,0xe7,0xf7,0x8c,0x59,0x6a,0x49,0x34,0x4f,0x01,0x2e,0xda,0x2d,0x4e,0xfa,0xd8,0xa0,0x50,0xcc,0x4c,0x19,0xaf,0xa9,0x7c,0x59,0x04,0x5a,0x99,0xca,0xc7,0x82,0x72,0x71,0xcb,0x41,0xc6,0x5e,0x59,0x0e,0x09,0xda,0x32,0x75,0x60,0x0c,0x2f,0x09,0xb8,0x36,0x77,0x93,0xa9,0xac,0xa3,0xdb,0x71,0xcc,0x30,0xc5,0x81,0x79,0xec,0x3e,0x87,0xc1,0x4c,0x01,0xd5,0xc1,0xf3,0x43,0x4f,0x1d,0x87}},
+  /* RFC 5869 test case 3 */
+  {KA(""),
+   KA("\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b"),
+   KA(""),
+   42, {0x8d,0xa4,0xe7,0x75,0xa5,0x63,0xc1,0x8f,0x71,0x5f,0x80,0x2a,0x06,0x3c,0x5a,0x31,0xb8,0xa1,0x1f,0x5c,0x5e,0xe1,0x87,0x9e,0xc3,0x45,0x4e,0x5f,0x3c,0x73,0x8d,0x2d,0x9d,0x20,0x13,0x95,0xfa,0xa4,0xb6,0x1a,0x96,0xc8}},
+  /* Known answer of my own */
+  {KA("\x73\x65\x73\x73\x69\x6f\x6e\x20\x73\x61\x6c\x74"),
+   KA("\x73\x68\x61\x72\x65\x64\x20\x73\x65\x63\x72\x65\x74\x20\x66\x72\x6f\x6d\x20\x74\x68\x65\x20\x6b\x65\x79\x20\x65\x78\x63\x68\x61\x6e\x67\x65"),
+   KA("\x63\x6c\x69\x65\x6e\x74\x20\x74\x6f\x20\x73\x65\x72\x76\x65\x72\x20\x6b\x65\x79"),
+   1000, {0xd7,0x5b,0x07,0x68,0x9e,0xc4,0xe3,0x83,0x61,0xa0,0x2c,0xec,0xee,0xe4,0x69,0xc6,0x08,0x4d,0xc2,0xa5,0x31,0x12,0x41,0xaa,0xa2,0xaf,0x3b,0x9b,0xac,0x00,0x04,0x5e,0x74,0x97,0x73,0xa7,0x7d,0x4d,0xd5,0x90,0xef,0x49,0x1c,0x5e,0x5e,0xdd,0xea,0xf2,0x0a,0x20,0xf0,0xa7,0xee,0xf9,0x39,0x2e,0xac,0x4b,0x3f,0xfe,0x2d,0xd2,0x3e,0x90,0x6a,0x86,0x47,0x25,0x71,0x09,0xd4,0x2c,0xad,0x14,0x95,0xba,0xa3,0x8a,0x8f,0x9e,0xec,0x30,0xec,0x38,0x47,0x6c,0xae,0xb8,0xf9,0x72,0xd3,0xf5,0xda,0x04,0xc9,0x91,0x58,0xc6,0xf4,0x2a,0x59,0x07,0x36,0x5b,0xc4,0xda,0x3e,0xe2,0xa9,0xb5,0x1a,0x33,0x7c,0x2f,0x14,0xe7,0x71,0xb2,0x67,0xdf,0xac,0x86,0x97,0x3a,0xa1,0x12,0x10,0x8d,0x79,0x14,0xe5,0xc6,0xda,0x35,0x6b,0x8e,0x47,0x90,0xde,0xca,0x29,0x0e,0x43,0x32,0xcb,0xf3,0x49,0xa7,0xa9,0x41,0xd2,0x2a,0x37,0xb2,0xf0,0x1e,0x77,0x88,0xe4,0xe5,0xea,0xa5,0xb7,0x53,0xf2,0xe3,0xf7,0xa8,0x53,0x1c,0x24,0x4d,0xfc,0xf2,0xf7,0x02,0x0e,0x06,0x4a,0x54,0x2a,0x89,0x21,0x18,0x8f,0x61,0x27,0x7e,0x9f,0x3d,0xd9,0x03,0x7d,0xf8,0x04,0xc6,0x99,0xb3,0x78,0x4b,0x58,0x0c,0xfa,0x22,0x51,0xb3,0x09,0x1e,0x68,0x6a,0xca,0x1a,0x81,0x3b,0xdb,0x52,0xdc,0xf7,0x85,0xf3,0xac,0xc5,0x76,0x01,0x37,0x8e,0x84,0xbe,0x25,0xdc,0xd8,0x2e,0x33,0xd4,0x50,0x52,0xb1,0x29,0xfe,0xb8,0x77,0xab,0xe7,0x0e,0x7b,0x8e,0x58,0xc1,0x81,0x81,0x95,0xec,0xac,0x96,0x03,0xa6,0x51,0x64,0x12,0xb7,0x04,0xdf,0x42,0xc8,0xf5,0xe8,0xbf,0x34,0xf3,0x96,0x0a,0xfd,0x3d,0x4f,0x8f,0x11,0x8a,0x03,0xbc,0x92,0x58,0x1e,0x34,0x5d,0x6c,0xed,0xed,0xbf,0xd3,0xbb,0x04,0xad,0xac,0x5e,0x9f,0x0f,0x84,0x98,0xc5,0xfb,0x58,0x7c,0x81,0x5b,0x80,0xb2,0xd1,0x7b,0x0b,0xad,0x56,0xea,0xd5,0xad,0xcb,0x91,0xde,0x08,0x5d,0xed,0xfc,0x13,0xe4,0xbb,0xae,0xbb,0xaf,0xca,0x4f,0x7b,0xe7,0xe7,0x86,0x33,0x21,0x39,0xf8,0x34,0xcd,0xd9,0x6e,0x8e,0x06,0xdc,0xe7,0x77,0xf9,0x76,0x8b,0x13,0x87,0x34,0xa3,0x26,0x70,0x6c,0xc6,0xa7,0x99,0xfd,0x41,0xc6,0xdf,0x45,0x04,0xa3,0x14,0x1f,0xc6,0x1f,0x2d,0x0c,0x59,0xc3,0x38,0x7e,0x93,0x9e,0x61,0x25,0x93,0x98,0x09,0x7b,0x04,0xdd,0x34,0x01,0x3d,0x89,0x2d,0x34,0x9e,0xae,0x1d,0x49,0x3c,0x8d,0x46,0x26,0xa4,0x93,0xa3,0x10,0xee,0x95,0x03,0x36,0x20,0x3a,0x2f,0x6e,0x11,0x9b,0x19,0xd1,0x20,0x20,0xa6,0xf6,0x8e,0xf6,0xd5,0x65,0xed,0xc1,0x3d,0x76,0xc7,0x83,0xa0,0x54,0x8b,0x86,0x13,0x0a,0xdb,0x6e,0x16,0xe7,0xe6,0x75,0xd3,0x18,0xe5,0x0e,0x80,0x2f,0xf0,0x40,0x70,0xdb,0xd4,0xcc,0x9f,0x5b,0x92,0x62,0x4b,0xf6,0x2a,0x86,0x79,0x29,0xc4,0x29,0x53,0x3f,0xdd,0xde,0x09,0x85,0xbc,0x39,0x69,0x76,0xef,0x3a,0xe8,0x75,0x08,0x7e,0x14,0x22,0x19,0x37,0xa5,0xda,0x05,0xcd,0x39,0x33,0x12,0xa6,0xaa,0x4e,0x28,0xa6,0x66,0x02,0xa4,0x58,0xcb,0x7d,0xc7,0xf2,0x41,0x33,0x79,0x81,0xf7,0x7e,0xbd,0x8e,0x81,0x3a,0x54,0x08,0xfd,0x82,0x4c,0x89,0xb3,0xf8,0xa3,0xf5,0x82,0xc0,0x4d,0x50,0x73,0x0a,0x4e,0x0f,0xa5,0x72,0x6e,0xd8,0xcc,0xb7,0xd6,0x29,0xc5,0xf2,0xf7,0x84,0x2c,0x7b,0x48,0xc1,0xbe,0xac,0x37,0xbc,0x3d,0xe8,0x99,0x59,0x7e,0xf5,0xa1,0x76,0x6f,0xd4,0xaa,0x56,0x76,0x4f,0x14,0x22,0x15,0xe8,0x60,0xbd,0x30,0xb3,0x28,0xc4,0xeb,0xa3,0xcf,0xac,0xb2,0xd3,0x60,0x76,0x94,0xf4,0xc4,0x4b,0x58,0xed,0x7e,0xbb,0xa2,0xfb,0x93,0x3f,0x54,0x46,0xa5,0xb5,0xf9,0x12,0x51,0x8b,0xe7,0x26,0x36,0x23,0x5d,0x01,0xa5,0x79,0xf2,0x77,0x05,0xea,0xe1,0xa8,0x02,0xb1,0xb7,0x44,0xf6,0x8a,0xf2,0x5e,0x53,0x97,0x0b,0xe7,0x75,0xc3,0x2d,0x58,0xb7,0x2c,0x33,0x88,0x2c,0x5e,0xb8,0x90,0xfe,0xe7,0xbb,0xe2,0x66,0xc3,0x28,0x0f,0x1c,0x00,0xd4,0x4d,0xcb,0x2c,0x91,0x34,0x27,0x7b,0x28,0x7e,0xad,0x99,0x3f,0x5c,0x78,0x5e,0x56,0x92,0x8a,0x97,0xd5,0xa2,0x57,0x27,0xa2,0xdc,0xef,0x28,0xc3,0x3a,0xa5,0xbf,0xda,0x2e,0x8c,0xb3,0x9f,0x4d,0x4a,0xa5,0xda,0x84,0x8f,0xbe,0x82,0x7b,0xe9,0x74,0x8e,0xfb,0x61,0x28,0x92,0xe6,0xe4,0xea,0x1a,0xcc,0xe7,0xe2,0x98,0x01,0xe5,0xb7,0xbd,0x7e,0x27,0x79,0x0b,0xcb,0x34,0xa2,0xea,0x17,0xe4,0x8a,0x25,0xc6,0xa7,0x8a,0xc4,0x58,0x59,0x76,0xaa,0x98,0x97,0x63,0xe2,0xc1,0x43,0x28,0x0b,0xd6,0xed,0x80,0x58,0xb5,0x24,0xea,0xf9,0xf5,0xd8,0xc7,0x0a,0x0b,0x8d,0x8d,0xe5,0x9b,0xbf,0x0b,0xbe,0x05,0xa3,0x1e,0xb5,0x18,0xdd,0x20,0x4d,0xb4,0xee,0x24,0xde,0xae,0x02,0x69,0x8f,0x9b,0x8e,0xe2,0x92,0x34,0x5c,0xc7,0xf0,0x64,0xae,0xe5,0x7c,0xa9,0xa9,0x61,0x4c,0xed,0x3a,0x82,0x6e,0x3d,0x02,0x83,0x81,0xe0,0x31,0x36,0x6e,0x80,0x1f,0xa7,0xae,0x58,0x68,0x9b,0xfc,0xaf,0xd4,0xff,0x4d,0xac,0xe9,0xe0,0x96,0x86,0x38,0x97,0x67,0x16,0x2d,0xc8,0xdf,0x78,0x8a,0xbc,0x0c,0x65,0x72,0xe6,0xec,0x15,0xb6,0x75,0x18,0xed,0x36,0xce,0xeb,0x6c,0x4a,0x25,0x7b,0x62,0xf2,0x19,0xff,0xb3,0x96,0x85,0x01,0xd1,0xc5,0x19,0xac,0x22,0xa2,0x69,0x8d,0x79,0x32,0x89,0x58,0xa6,0x96,0xd8,0x35,0x20,0xc9,0x7d,0x25,0x4b,0x14,0x7c,0x21,0x85,0x6e,0xe3,0x5f,0x9c,0x35,0x9b,0xa8,0x29,0xee,0x0d,0x5f,0xaa,0x5b,0xd1,0x7a,0xfa,0xb0,0xeb,0x27,0x77,0xa2,0xb7,0xcb,0xaf,0x28,0x0d,0xd0,0x91,0xc1,0xee,0x7c,0xfc,0x1f,0x51,0x55,0xd8,0x88,0xbb,0x95,0x13,0xbf,0xdc,0xc4,0x31,0x08,0xfd,0x0c,0x9a,0x2b,0x06,0xdf,0x00,0x3a,0xa7,0xfe,0x58,0xf6,0x83,0xcc,0x71,0x0d,0xc8,0xf3,0x37,0xf5,0xb9,0x1e,0x8d,0xbf,0x8e,0xf7,0x8e,0x8d,0x00,0xdd,0x5e,0x20,0x67,0xea,0xcc,0xbc,0x2d,0xa6,0xd2,0x75,0x6f,0xf3,0xcf,0xa5,0xf2,0x6c,0x88,0x39,0xad,0x8d,0x85,0x20,0xef,0xff,0xaf,0x89,0x3e,0xc3,0x23,0xfc,0xeb,0x09,0x9f,0xbe,0xa5,0x74,0xd1}},
+};
+
+static int test_known() {
+  int ret = 0;
+  for(unsigned n = 0; n < elementcount(known_answers); ++n) {
+    const struct known_answer* el = known_answers + n;
+    lsx_hkdf_sha256_prk prk;
+    uint8_t okm[MAX_OKM_BYTES];
+    lsx_hkdf_sha256_extract(&prk, el->saltlen ? el->salt : NULL, el->saltlen,
+                            el->ikm, el->ikmlen);
+    /* expand twice, to make sure the PRK is reusable */
+    for(unsigned rep = 0; rep < 2; ++rep) {
+      memset(okm, 0, sizeof(okm));
+      if(!lsx_hkdf_sha256_expand(&prk, el->info, el->infolen, okm,
+                                 el->okmlen)
+         || memcmp(okm, el->okm, el->okmlen)) {
+        fprintf(stderr, "HKDF-SHA256 known answer %u failed!\n", n);
+        fprintf(stderr, "datum | kn | re\n");
+        for(unsigned i = 0; i < el->okmlen; ++i) {
+          output_datum("okm[%3u] | %02X | %02X\n", i, el->okm[i], okm[i]);
+        }
+        plain();
+        ret = 1;
+        break;
+      }
+    }
+    lsx_destroy_hkdf_sha256_prk(&prk);
+  }
+  return ret;
+}
+
+static int test_limits() {
+  static uint8_t okm[LSX_HKDF_SHA256_MAX_BYTES + 1];
+  lsx_hkdf_sha256_prk prk;
+  int ret = 0;
+  lsx_hkdf_sha256_extract(&prk, NULL, 0, "ikm", 3);
+  if(!lsx_hkdf_sha256_expand(&prk, NULL, 0, okm, LSX_HKDF_SHA256_MAX_BYTES)) {
+    fprintf(stderr, "HKDF-SHA256 refused the maximum output length!\n");
+    ret = 1;
+  }
+  if(lsx_hkdf_sha256_expand(&prk, NULL, 0, okm,
+                            LSX_HKDF_SHA256_MAX_BYTES + 1)) {
+    fprintf(stderr, "HKDF-SHA256 allowed too long an output!\n");
+    ret = 1;
+  }
+  lsx_destroy_hkdf_sha256_prk(&prk);
+  return ret;
+}
+
+/* expand_twofish must be the same as expanding a key and setting up with it */
+static int test_twofish() {
+  static const size_t key_lengths[] = {
+    TWOFISH128_KEYBYTES, TWOFISH192_KEYBYTES, TWOFISH256_KEYBYTES,
+  };
+  static const uint8_t pt[TWOFISH_BLOCKBYTES] = "sixteen byte msg";
+  lsx_hkdf_sha256_prk prk;
+  lsx_twofish_context a, b;
+  uint8_t key[TWOFISH256_KEYBYTES], cta[TWOFISH_BLOCKBYTES],
+    ctb[TWOFISH_BLOCKBYTES];
+  int ret = 0;
+  lsx_hkdf_sha256_extract(&prk, "salt", 4, "input keying material", 21);
+  for(unsigned n = 0; n < elementcount(key_lengths); ++n) {
+    lsx_hkdf_sha256_expand(&prk, "twofish key", 11, key, key_lengths[n]);
+    switch(key_lengths[n]) {
+    case TWOFISH128_KEYBYTES: lsx_setup_twofish128(&a, key); break;
+    case TWOFISH192_KEYBYTES: lsx_setup_twofish192(&a, key); break;
+    default: lsx_setup_twofish256(&a, key); break;
+    }
+    if(!lsx_hkdf_sha256_expand_twofish(&prk, "twofish key", 11, &b,
+                                       key_lengths[n])) {
+      fprintf(stderr, "HKDF-SHA256 refused a %u byte Twofish key!\n",
+              (unsigned)key_lengths[n]);
+      ret = 1;
+      continue;
+    }
+    lsx_encrypt_twofish(&a, pt, cta);
+    lsx_encrypt_twofish(&b, pt, ctb);
+    if(memcmp(cta, ctb, sizeof(cta))) {
+      fprintf(stderr, "HKDF-SHA256 gave the wrong %u byte Twofish key!\n",
+              (unsigned)key_lengths[n]);
+      ret = 1;
+    }
+  }
+  if(lsx_hkdf_sha256_expand_twofish(&prk, "twofish key", 11, &b, 20)) {
+    fprintf(stderr, "HKDF-SHA256 accepted a 20 byte Twofish key!\n");
+    ret = 1;
+  }
+  lsx_destroy_twofish(&a);
+  lsx_destroy_twofish(&b);
+  lsx_destroy_hkdf_sha256_prk(&prk);
+  return ret;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  int ret = 0;
+  plain();
+  ret = ret || test_known();
+  ret = ret || test_limits();
+  ret = ret || test_twofish();
+  return ret;
+}
@@ -0,0 +1,122 @@
+#include "lsx.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lsx_test_common.h"
+
+static const struct known_answer {
+  const void* key;
+  size_t keylen;
+  const void* message;
+  size_t msglen;
+  uint8_t answer[SHA256_HASHBYTES];
+} known_answers[] = {
+#define KNOWN_ANSWER(key, str, ...) {key, sizeof(key)-1, str, sizeof(str)-1, {__VA_ARGS__}}
+  /* RFC 4231 test case 1 */
+  KNOWN_ANSWER("\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b",
+               "Hi There",
+               0xb0,0x34,0x4c,0x61,0xd8,0xdb,0x38,0x53,0x5c,0xa8,0xaf,0xce,0xaf,0x0b,0xf1,0x2b,0x88,0x1d,0xc2,0x00,0xc9,0x83,0x3d,0xa7,0x26,0xe9,0x37,0x6c,0x2e,0x32,0xcf,0xf7),
+  /* RFC 4231 test case 2 */
+  KNOWN_ANSWER("Jefe",
+               "what do ya want for nothing?",
+               0x5b,0xdc,0xc1,0x46,0xbf,0x60,0x75,0x4e,0x6a,0x04,0x24,0x26,0x08,0x95,0x75,0xc7,0x5a,0x00,0x3f,0x08,0x9d,0x27,0x39,0x83,0x9d,0xec,0x58,0xb9,0x64,0xec,0x38,0x43),
+  /* RFC 4231 test case 3 */
+  KNOWN_ANSWER("\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa",
+               "\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd",
+               0x77,0x3e,0xa9,0x1e,0x36,0x80,0x0e,0x46,0x85,0x4d,0xb8,0xeb,0xd0,0x91,0x81,0xa7,0x29,0x59,0x09,0x8b,0x3e,0xf8,0xc1,0x22,0xd9,0x63,0x55,0x14,0xce,0xd5,0x65,0xfe),
+  /* RFC 4231 test case 4 */
+  KNOWN_ANSWER("\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19",
+               "\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd",
+               0x82,0x55,0x8a,0x38,0x9a,0x44,0x3c,0x0e,0xa4,0xcc,0x81,0x98,0x99,0xf2,0x08,0x3a,0x85,0xf0,0xfa,0xa3,0xe5,0x78,0xf8,0x07,0x7a,0x2e,0x3f,0xf4,0x67,0x29,0x66,0x5b),
+  /* RFC 4231 test case 6 */
+  KNOWN_ANSWER("\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa",
+               "Test Using Larger Than Block-Size Key - Hash Key First",
+               0x60,0xe4,0x31,0x59,0x1e,0xe0,0xb6,0x7f,0x0d,0x8a,0x26,0xaa,0xcb,0xf5,0xb7,0x7f,0x8e,0x0b,0xc6,0x21,0x37,0x28,0xc5,0x14,0x05,0x46,0x04,0x0f,0x0e,0xe3,0x7f,0x54),
+  /* RFC 4231 test case 7 */
+  KNOWN_ANSWER("\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa",
+               "This is a test using a larger than block-size key and a larger than block-size data. The key needs to be hashed before being used by the HMAC algorithm.",
+               0x9b,0x09,0xff,0xa7,0x1b,0x94,0x2f,0xcb,0x27,0x63,0x5f,0xbc,0xd5,0xb0,0xe9,0x44,0xbf,0xdc,0x63,0x64,0x4f,0x07,0x13,0x93,0x8a,0x7f,0x51,0x53,0x5c,0x3a,0x35,0xe2),
+  /* Known answers of my own */
+  KNOWN_ANSWER("",
+               "",
+               0xb6,0x13,0x67,0x9a,0x08,0x14,0xd9,0xec,0x77,0x2f,0x95,0xd7,0x78,0xc3,0x5f,0xc5,0xff,0x16,0x97,0xc4,0x93,0x71,0x56,0x53,0xc6,0xc7,0x12,0x14,0x42,0x92,0xc5,0xad),
+  KNOWN_ANSWER("\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01",
+               "A key of exactly one block, and a message of exactly one block, ",
+               0x4d,0x23,0xc7,0xa8,0xc5,0x27,0xdd,0x1c,0x48,0x9c,0xa2,0x09,0x88,0x93,0xe4,0x96,0x04,0x03,0xd2,0x03,0xcd,0x7a,0xfe,0x23,0x26,0xb5,0x34,0x04,0x76,0x8a,0x67,0x15),
+};
+
+static int check(const struct known_answer* el, const uint8_t* mac,
+                 const char* how, unsigned n) {
+  if(!memcmp(mac, el->answer, SHA256_HASHBYTES)) return 0;
+  fprintf(stderr, "HMAC-SHA256 (%s) known answer %u failed!\n", how, n);
+  fprintf(stderr, "datum | kn | re\n");
+  for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+    output_datum("h[%2u] | %02X | %02X\n", i, el->answer[i], mac[i]);
+  }
+  plain();
+  return 1;
+}
+
+static int test_lazy() {
+  int ret = 0;
+  for(unsigned n = 0; n < elementcount(known_answers); ++n) {
+    const struct known_answer* el = known_answers + n;
+    lsx_hmac_sha256_key key;
+    uint8_t mac[SHA256_HASHBYTES];
+    lsx_setup_hmac_sha256_key(&key, el->key, el->keylen);
+    lsx_calculate_hmac_sha256(&key, el->message, el->msglen, mac);
+    if(check(el, mac, "lazy", n)) ret = 1;
+    if(!lsx_verify_hmac_sha256(&key, el->message, el->msglen, el->answer)) {
+      fprintf(stderr, "HMAC-SHA256 known answer %u failed to verify!\n", n);
+      ret = 1;
+    }
+    memcpy(mac, el->answer, sizeof(mac));
+    mac[n % SHA256_HASHBYTES] ^= 0x80;
+    if(lsx_verify_hmac_sha256(&key, el->message, el->msglen, mac)) {
+      fprintf(stderr, "HMAC-SHA256 known answer %u verified a bad MAC!\n", n);
+      ret = 1;
+    }
+    lsx_destroy_hmac_sha256_key(&key);
+  }
+  return ret;
+}
+
+static int test_easyish(unsigned count) {
+  int ret = 0;
+  for(unsigned n = 0; n < elementcount(known_answers); ++n) {
+    const struct known_answer* el = known_answers + n;
+    lsx_hmac_sha256_key key;
+    lsx_hmac_sha256_context ctx;
+    uint8_t mac[SHA256_HASHBYTES];
+    lsx_setup_hmac_sha256_key(&key, el->key, el->keylen);
+    /* use each key twice, to make sure setup doesn't disturb it */
+    for(unsigned rep = 0; rep < 2; ++rep) {
+      lsx_setup_hmac_sha256(&ctx, &key);
+      const uint8_t* p = el->message;
+      size_t rem = el->msglen;
+      while(rem >= count) {
+        lsx_input_hmac_sha256(&ctx, p, count);
+        p += count; rem -= count;
+      }
+      if(rem > 0) lsx_input_hmac_sha256(&ctx, p, rem);
+      lsx_finish_hmac_sha256(&ctx, mac);
+      if(check(el, mac, "easy", n)) ret = 1;
+    }
+    lsx_destroy_hmac_sha256(&ctx);
+    lsx_destroy_hmac_sha256_key(&key);
+  }
+  return ret;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  int ret = 0;
+  plain();
+  ret = ret || test_lazy();
+  ret = ret || test_easyish(1);
+  ret = ret || test_easyish(7);
+  ret = ret || test_easyish(64);
+  ret = ret || test_easyish(65);
+  return ret;
+}
@@ -0,0 +1,73 @@
+-- Tests of the Lua binding itself, run by `make test-lua`. The C tests cover
+-- the algorithms; these make sure the binding hands them sane buffers.
+local lsx = require "lsx"
+local unpack = unpack or table.unpack
+
+local failed = false
+local function check(ok, what)
+   if not ok then
+      io.stderr:write(what, " failed!\n")
+      failed = true
+   end
+end
+
+-- slow, obvious encoders to compare against
+local function hex(data)
+   return (data:gsub(".", function(c) return ("%02x"):format(c:byte()) end))
+end
+
+local b64_digits =
+   "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+local function base64(data)
+   local out = {}
+   for n = 1, #data, 3 do
+      local a, b, c = data:byte(n, n + 2)
+      local group = a * 65536 + (b or 0) * 256 + (c or 0)
+      for i = 1, 4 do
+         local digit = math.floor(group / 2^(24 - i * 6)) % 64
+         out[#out + 1] = b64_digits:sub(digit + 1, digit + 1)
+      end
+      if not b then out[#out - 1] = "=" end
+      if not c then out[#out] = "=" end
+   end
+   return table.concat(out)
+end
+
+-- long enough to go through the vector decoders, several times over
+for length = 0, 300 do
+   local bytes = {}
+   for n = 1, length do bytes[n] = (n * 97 + length) % 256 end
+   local data = string.char(unpack(bytes))
+   local h, b = lsx.hex_encode(data), lsx.base64_encode(data)
+   check(h == hex(data), "hex_encode of " .. length .. " bytes")
+   check(b == base64(data), "base64_encode of " .. length .. " bytes")
+   check(lsx.hex_decode(h) == data, "hex_decode of " .. length .. " bytes")
+   check(lsx.hex_decode(h:upper()) == data,
+         "uppercase hex_decode of " .. length .. " bytes")
+   check(lsx.base64_decode(b) == data,
+         "base64_decode of " .. length .. " bytes")
+end
+
+-- bad input gives nil and a message, even where the vector decoders stop
+for _, bad in ipairs{"0", "0g", ("00"):rep(40) .. "zz"} do
+   local data, err = lsx.hex_decode(bad)
+   check(data == nil and err == "invalid hex", "hex_decode of " .. bad)
+end
+for _, bad in ipairs{"QUJ", "QU=D", ("QUJD"):rep(20) .. "QU!D", "QR=="} do
+   local data, err = lsx.base64_decode(bad)
+   check(data == nil and err == "invalid base64", "base64_decode of " .. bad)
+end
+
+-- either policy gives the same hash, and nothing else is a policy
+local abc = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"
+check(lsx.sha256_sum("abc") == abc, "sha256_sum")
+for _, policy in ipairs{"secret", "public"} do
+   local state = lsx.sha256()
+   state:set_policy(policy)
+   state:input("a", "bc")
+   check(state:finish() == abc, "sha256 with the " .. policy .. " policy")
+end
+local state = lsx.sha256()
+check(not pcall(state.set_policy, state, "private"), "set_policy of a bad name")
+
+if failed then os.exit(1) end
@@ -0,0 +1,114 @@
+#include "lsx.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lsx_test_common.h"
+
+#define MAX_ANSWER_BYTES 300
+
+static const struct known_answer {
+  const char* password;
+  const char* salt;
+  uint32_t iterations;
+  size_t dklen;
+  uint8_t answer[MAX_ANSWER_BYTES];
+} known_answers[] = {
+#define PW_SALT(password, salt) password, salt
+  /* RFC 7914 section 11 */
+  {PW_SALT("passwd", "salt"), 1, 64,
+   {0x55,0xac,0x04,0x6e,0x56,0xe3,0x08,0x9f,0xec,0x16,0x91,0xc2,0x25,0x44,0xb6,0x05,0xf9,0x41,0x85,0x21,0x6d,0xde,0x04,0x65,0xe6,0x8b,0x9d,0x57,0xc2,0x0d,0xac,0xbc,0x49,0xca,0x9c,0xcc,0xf1,0x79,0xb6,0x45,0x99,0x16,0x64,0xb3,0x9d,0x77,0xef,0x31,0x7c,0x71,0xb8,0x45,0xb1,0xe3,0x0b,0xd5,0x09,0x11,0x20,0x41,0xd3,0xa1,0x97,0x83}},
+  {PW_SALT("Password", "NaCl"), 80000, 64,
+   {0x4d,0xdc,0xd8,0xf6,0x0b,0x98,0xbe,0x21,0x83,0x0c,0xee,0x5e,0xf2,0x27,0x01,0xf9,0x64,0x1a,0x44,0x18,0xd0,0x4c,0x04,0x14,0xae,0xff,0x08,0x87,0x6b,0x34,0xab,0x56,0xa1,0xd4,0x25,0xa1,0x22,0x58,0x33,0x54,0x9a,0xdb,0x84,0x1b,0x51,0xc9,0xb3,0x17,0x6a,0x27,0x2b,0xde,0xbb,0xa1,0xd0,0x78,0x47,0x8f,0x62,0xb3,0x97,0xf3,0x3c,0x8d}},
+  /* Known answers of my own */
+  {PW_SALT("password", "salt"), 4096, 32,
+   {0xc5,0xe4,0x78,0xd5,0x92,0x88,0xc8,0x41,0xaa,0x53,0x0d,0xb6,0x84,0x5c,0x4c,0x8d,0x96,0x28,0x93,0xa0,0x01,0xce,0x4e,0x11,0xa4,0x96,0x38,0x73,0xaa,0x98,0x13,0x4a}},
+  {PW_SALT("passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt"), 4096, 40,
+   {0x34,0x8c,0x89,0xdb,0xcb,0xd3,0x2b,0x2f,0x32,0xd8,0x14,0xb8,0x11,0x6e,0x84,0xcf,0x2b,0x17,0x34,0x7e,0xbc,0x18,0x00,0x18,0x1c,0x4e,0x2a,0x1f,0xb8,0xdd,0x53,0xe1,0xc6,0x35,0x51,0x8c,0x7d,0xac,0x47,0xe9}},
+  {PW_SALT("password", "salt"), 2, 300,
+   {0xae,0x4d,0x0c,0x95,0xaf,0x6b,0x46,0xd3,0x2d,0x0a,0xdf,0xf9,0x28,0xf0,0x6d,0xd0,0x2a,0x30,0x3f,0x8e,0xf3,0xc2,0x51,0xdf,0xd6,0xe2,0xd8,0x5a,0x95,0x47,0x4c,0x43,0x83,0x06,0x51,0xaf,0xcb,0x5c,0x86,0x2f,0x0b,0x24,0x9b,0xd0,0x31,0xf7,0xa6,0x75,0x20,0xd1,0x36,0x47,0x0f,0x5e,0xc2,0x71,0xec,0xe9,0x1c,0x07,0x77,0x32,0x53,0xd9,0x3e,0x67,0x6b,0x07,0x9c,0xae,0x12,0x19,0xa0,0x00,0xf8,0xb4,0xb1,0xa0,0xa3,0xba,0x5e,0xa6,0x59,0x02,0xf5,0x7c,0x39,0xe3,0x72,0x64,0xaf,0x9e,0x6c,0xe4,0xa2,0x82,0xb4,0x4c,0xd7,0x32,0xe0,0xd1,0x0a,0x08,0xd8,0x7b,0x60,0x4e,0xa8,0xa4,0xed,0x60,0xe6,0xe3,0x16,0x56,0x42,0xe4,0xf9,0xe2,0xbc,0x92,0x28,0x2a,0x1e,0x8f,0xa0,0x1b,0x13,0xe7,0x15,0x32,0x8e,0xc8,0x56,0xb6,0xd3,0x5f,0xf8,0xb2,0xf2,0x9f,0xd2,0xee,0x69,0x44,0xcf,0x39,0x2c,0xd1,0xec,0xda,0xbe,0xd4,0x02,0xd2,0xe5,0x8e,0x22,0xf7,0x86,0x25,0xeb,0x5b,0x15,0x4c,0xfd,0xd6,0x6a,0xc6,0x57,0xa8,0xc4,0xad,0x40,0x2d,0x8a,0x5a,0x30,0x17,0xe0,0x2b,0x50,0xe5,0xbe,0xa7,0x29,0x79,0x2f,0x1d,0x98,0x4a,0xe3,0x51,0x0c,0x68,0xdd,0xb8,0x39,0x87,0x9b,0x04,0xe6,0x8e,0xad,0x8b,0x9c,0xe7,0x43,0x7e,0x23,0xc9,0x99,0x54,0xb7,0x2f,0x3c,0x9b,0x18,0x46,0xc2,0xef,0x42,0x55,0x36,0x59,0xc2,0x1e,0x9a,0xc0,0x02,0x1c,0xe5,0x9c,0x3e,0x14,0x8f,0x50,0x40,0xc6,0xac,0x68,0x67,0x5a,0xa6,0x29,0x90,0x1e,0x3e,0xd9,0x8c,0x54,0xb7,0x25,0xf5,0xef,0x5f,0xf3,0x73,0xec,0x02,0x70,0x96,0x36,0xf7,0x35,0x28,0x50,0xf3,0x04,0x19,0xd5,0x1b,0x9e,0xf1,0x3b,0x9d,0x8f,0x0f,0xf1,0x01,0xd1,0x0d,0xa0,0x6b,0x24,0x57,0xc9,0xd0,0x40,0x2b,0xc5,0x22,0x74,0x35,0x6a,0x3a,0x55,0xcd,0x6c}},
+  {PW_SALT("xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx", ""), 1000, 20,
+   {0xc0,0xda,0x42,0x86,0xb1,0xae,0x4a,0xef,0xa2,0x41,0x60,0xb7,0xc9,0xaf,0xe6,0x29,0xdd,0x45,0xbc,0xe2}},
+};
+
+static int test_known() {
+  int ret = 0;
+  for(unsigned n = 0; n < elementcount(known_answers); ++n) {
+    const struct known_answer* el = known_answers + n;
+    uint8_t out[MAX_ANSWER_BYTES];
+    lsx_pbkdf2_hmac_sha256(el->password, strlen(el->password),
+                           el->salt, strlen(el->salt), el->iterations,
+                           out, el->dklen);
+    if(memcmp(out, el->answer, el->dklen)) {
+      fprintf(stderr, "PBKDF2-HMAC-SHA256 known answer %u failed!\n", n);
+      fprintf(stderr, "datum | kn | re\n");
+      for(unsigned i = 0; i < el->dklen; ++i) {
+        output_datum("k[%3u] | %02X | %02X\n", i, el->answer[i], out[i]);
+      }
+      plain();
+      ret = 1;
+    }
+  }
+  return ret;
+}
+
+/* the batch form must agree with the single form, on a batch that doesn't
+   fill a whole number of lanes */
+#define NUM_MANY 19
+#define MANY_ITERATIONS 100
+static int test_many() {
+  char passwords[NUM_MANY][40], salts[NUM_MANY][40];
+  const void* password_ptrs[NUM_MANY];
+  const void* salt_ptrs[NUM_MANY];
+  size_t password_lens[NUM_MANY], salt_lens[NUM_MANY];
+  uint8_t expected[NUM_MANY][SHA256_HASHBYTES];
+  uint8_t result[NUM_MANY][SHA256_HASHBYTES];
+  int matches[NUM_MANY];
+  for(unsigned n = 0; n < NUM_MANY; ++n) {
+    password_lens[n] = sprintf(passwords[n], "password %u", n * 37);
+    salt_lens[n] = sprintf(salts[n], "%.*s", (int)(n * 2), "salt salt salt salt salt salt salt");
+    password_ptrs[n] = passwords[n];
+    salt_ptrs[n] = salts[n];
+    lsx_pbkdf2_hmac_sha256(passwords[n], password_lens[n], salts[n],
+                           salt_lens[n], MANY_ITERATIONS, expected[n],
+                           SHA256_HASHBYTES);
+  }
+  lsx_pbkdf2_hmac_sha256_many(password_ptrs, password_lens, salt_ptrs,
+                              salt_lens, NUM_MANY, MANY_ITERATIONS, result);
+  for(unsigned n = 0; n < NUM_MANY; ++n) {
+    if(memcmp(result[n], expected[n], SHA256_HASHBYTES)) {
+      fprintf(stderr, "PBKDF2-HMAC-SHA256 (many) pair %u failed!\n", n);
+      return 1;
+    }
+  }
+  expected[5][7] ^= 1;
+  expected[NUM_MANY-1][0] ^= 0x40;
+  size_t count = lsx_verify_pbkdf2_hmac_sha256_many(password_ptrs,
+                                                    password_lens,
+                                                    salt_ptrs, salt_lens,
+                                                    NUM_MANY, MANY_ITERATIONS,
+                                                    (const uint8_t(*)[SHA256_HASHBYTES])expected,
+                                                    matches);
+  if(count != NUM_MANY - 2) {
+    fprintf(stderr, "PBKDF2-HMAC-SHA256 (verify) matched %u of %u, should "
+            "have matched %u!\n", (unsigned)count, NUM_MANY, NUM_MANY - 2);
+    return 1;
+  }
+  for(unsigned n = 0; n < NUM_MANY; ++n) {
+    if(!matches[n] != (n == 5 || n == NUM_MANY-1)) {
+      fprintf(stderr, "PBKDF2-HMAC-SHA256 (verify) got pair %u wrong!\n", n);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int test_kernel() {
+  return test_known() || test_many();
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  plain();
+  return for_each_sha256_many_impl(test_kernel);
+}
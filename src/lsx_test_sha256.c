@@ -52,11 +52,8 @@ static int test_easyish(unsigned count) {
   return ret;
 }
 
-int main(int argc, char* argv[]) {
-  (void)argc; (void)argv;
+static int test_lazy(void) {
   int ret = 0;
-  plain();
-  /* test the easiest interface */
   for(unsigned n = 0; n < elementcount(known_answers); ++n) {
     const struct known_answer* el = known_answers + n;
     uint8_t hash[SHA256_HASHBYTES];
@@ -71,6 +68,362 @@ int main(int argc, char* argv[]) {
     }
     ret = 1;
   }
+  return ret;
+}
+
+/* a message long enough that multi-block code paths get a workout */
+static uint8_t long_message[SHA256_BLOCKBYTES * 67 + 29];
+/* answers for several prefixes of it, computed with the scalar kernel */
+#define NUM_LONG_PREFIXES 16
+#define long_prefix_length(n) (sizeof(long_message) * ((n)+1) / NUM_LONG_PREFIXES)
+static uint8_t long_answers[NUM_LONG_PREFIXES][SHA256_HASHBYTES];
+
+static void make_long_message(void) {
+  fill_pseudorandom(long_message, sizeof(long_message), 1);
+  lsx_set_sha256_implementation(LSX_SHA256_IMPL_SCALAR);
+  for(unsigned n = 0; n < NUM_LONG_PREFIXES; ++n)
+    lsx_calculate_sha256(long_message, long_prefix_length(n), long_answers[n]);
+}
+
+static int test_long(void) {
+  int ret = 0;
+  for(unsigned n = 0; n < NUM_LONG_PREFIXES; ++n) {
+    uint8_t hash[SHA256_HASHBYTES];
+    lsx_calculate_sha256(long_message, long_prefix_length(n), hash);
+    if(memcmp(hash, long_answers[n], SHA256_HASHBYTES)) goto long_failed;
+    continue;
+  long_failed:
+    fprintf(stderr, "SHA-256 long message %u (%u bytes) failed!\n", n,
+            (unsigned)long_prefix_length(n));
+    fprintf(stderr, "datum | kn | re\n");
+    for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+      output_datum("h[%2u] | %02X | %02X\n", i, long_answers[n][i], hash[i]);
+    }
+    ret = 1;
+  }
+  return ret;
+}
+
+/* Skipping the wipes mustn't change any answers */
+static int test_policy(void) {
+  static const int policies[] = {LSX_POLICY_PUBLIC, LSX_POLICY_SECRET};
+  int ret = 0;
+  /* a zeroed context must fail safe */
+  if(LSX_POLICY_SECRET != 0) {
+    fprintf(stderr, "SHA-256 zeroed contexts aren't secret!\n");
+    return 1;
+  }
+  for(unsigned p = 0; p < elementcount(policies) && !ret; ++p) {
+    for(unsigned n = 0; n < elementcount(known_answers); ++n) {
+      const struct known_answer* el = known_answers + n;
+      uint8_t hash[SHA256_HASHBYTES];
+      lsx_calculate_sha256_policy(el->message, el->msglen, policies[p], hash);
+      if(memcmp(hash, el->answer, SHA256_HASHBYTES)) {
+        fprintf(stderr, "SHA-256 (policy %d) known answer %u failed!\n",
+                policies[p], n);
+        fprintf(stderr, "datum | kn | re\n");
+        for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+          output_datum("h[%2u] | %02X | %02X\n", i, el->answer[i], hash[i]);
+        }
+        ret = 1;
+      }
+    }
+    for(unsigned n = 0; n < NUM_LONG_PREFIXES; ++n) {
+      uint8_t hash[SHA256_HASHBYTES];
+      lsx_sha256_context ctx;
+      size_t len = long_prefix_length(n), at;
+      lsx_setup_sha256(&ctx);
+      lsx_set_sha256_policy(&ctx, policies[p]);
+      for(at = 0; at + 67 < len; at += 67)
+        lsx_input_sha256(&ctx, long_message + at, 67);
+      lsx_input_sha256(&ctx, long_message + at, len - at);
+      lsx_finish_sha256(&ctx, hash);
+      lsx_destroy_sha256(&ctx);
+      if(memcmp(hash, long_answers[n], SHA256_HASHBYTES)) {
+        fprintf(stderr, "SHA-256 (policy %d) long message %u failed!\n",
+                policies[p], n);
+        fprintf(stderr, "datum | kn | re\n");
+        for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+          output_datum("h[%2u] | %02X | %02X\n", i, long_answers[n][i],
+                       hash[i]);
+        }
+        ret = 1;
+      }
+    }
+  }
+  return ret;
+}
+
+/* Hash a prefix, save the state (by cloning, or by export and import into a
+   fresh context), and finish from the saved state */
+static int test_fork(void) {
+  int ret = 0;
+  for(unsigned n = 0; n < elementcount(known_answers); ++n) {
+    const struct known_answer* el = known_answers + n;
+    for(size_t split = 0; split <= el->msglen; split += 5) {
+      lsx_sha256_context ctx, fork;
+      uint8_t blob[LSX_SHA256_STATE_BYTES];
+      uint8_t hash[SHA256_HASHBYTES];
+      const char* how = "clone";
+      lsx_setup_sha256(&ctx);
+      lsx_input_sha256(&ctx, el->message, split);
+      lsx_clone_sha256(&fork, &ctx);
+      lsx_input_sha256(&fork, (const uint8_t*)el->message + split,
+                       el->msglen - split);
+      lsx_finish_sha256(&fork, hash);
+      if(memcmp(hash, el->answer, SHA256_HASHBYTES)) goto fork_failed;
+      how = "export";
+      lsx_export_sha256(&ctx, blob);
+      memset(&fork, 0xA5, sizeof(fork));
+      if(!lsx_import_sha256(&fork, blob, sizeof(blob))) goto fork_failed;
+      lsx_input_sha256(&fork, (const uint8_t*)el->message + split,
+                       el->msglen - split);
+      lsx_finish_sha256(&fork, hash);
+      if(memcmp(hash, el->answer, SHA256_HASHBYTES)) goto fork_failed;
+      continue;
+    fork_failed:
+      fprintf(stderr, "SHA-256 (%s at %u) known answer %u failed!\n", how,
+              (unsigned)split, n);
+      fprintf(stderr, "datum | kn | re\n");
+      for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+        output_datum("h[%2u] | %02X | %02X\n", i, el->answer[i], hash[i]);
+      }
+      ret = 1;
+    }
+  }
+  /* the expert interface, and the easy interface picking up an expert blob */
+  for(unsigned blocks = 0; blocks <= 4; ++blocks) {
+    lsx_sha256_expert_context expert;
+    lsx_sha256_context easy;
+    uint8_t blob[LSX_SHA256_EXPERT_STATE_BYTES];
+    uint8_t hash[SHA256_HASHBYTES];
+    lsx_setup_sha256_expert(&expert);
+    lsx_input_sha256_expert(&expert, long_message, blocks);
+    lsx_export_sha256_expert(&expert, blob);
+    lsx_setup_sha256_expert(&expert);
+    if(!lsx_import_sha256_expert(&expert, blob, sizeof(blob))
+       || !lsx_import_sha256(&easy, blob, sizeof(blob))) {
+      fprintf(stderr, "SHA-256 expert state %u failed to import!\n", blocks);
+      ret = 1;
+      continue;
+    }
+    lsx_finish_sha256_expert(&expert, long_message + blocks*SHA256_BLOCKBYTES,
+                             long_prefix_length(0) - blocks*SHA256_BLOCKBYTES,
+                             hash);
+    if(memcmp(hash, long_answers[0], SHA256_HASHBYTES)) {
+      fprintf(stderr, "SHA-256 expert state %u gave the wrong hash!\n",
+              blocks);
+      ret = 1;
+    }
+    lsx_input_sha256(&easy, long_message + blocks*SHA256_BLOCKBYTES,
+                     long_prefix_length(0) - blocks*SHA256_BLOCKBYTES);
+    lsx_finish_sha256(&easy, hash);
+    if(memcmp(hash, long_answers[0], SHA256_HASHBYTES)) {
+      fprintf(stderr, "SHA-256 expert state %u gave the wrong easy hash!\n",
+              blocks);
+      ret = 1;
+    }
+  }
+  /* damaged blobs must be refused */
+  {
+    lsx_sha256_context ctx;
+    uint8_t blob[LSX_SHA256_STATE_BYTES];
+    lsx_setup_sha256(&ctx);
+    lsx_input_sha256(&ctx, "abc", 3);
+    lsx_export_sha256(&ctx, blob);
+    static const unsigned bad_bytes[] = {0, 4, 5, 6, 7, 47};
+    for(unsigned n = 0; n < elementcount(bad_bytes); ++n) {
+      blob[bad_bytes[n]] ^= 0x41;
+      if(lsx_import_sha256(&ctx, blob, sizeof(blob))) {
+        fprintf(stderr, "SHA-256 import accepted a blob with byte %u "
+                "damaged!\n", bad_bytes[n]);
+        ret = 1;
+      }
+      blob[bad_bytes[n]] ^= 0x41;
+    }
+    if(lsx_import_sha256(&ctx, blob, sizeof(blob) - 1)
+       || lsx_import_sha256_expert(&ctx.expert, blob, sizeof(blob))) {
+      fprintf(stderr, "SHA-256 import accepted a blob of the wrong size or "
+              "kind!\n");
+      ret = 1;
+    }
+  }
+  return ret;
+}
+
+/* The fixed-length shortcuts must agree with the general-purpose code */
+#define NUM_FIXED 19
+static int test_fixed(void) {
+  uint8_t hash[NUM_FIXED][SHA256_HASHBYTES], expected[SHA256_HASHBYTES];
+  const uint8_t (*pairs)[SHA256_BLOCKBYTES]
+    = (const uint8_t (*)[SHA256_BLOCKBYTES])long_message;
+  static const uint64_t chain_lengths[] = {0, 1, 2, 100};
+  int ret = 0;
+  lsx_sha256_64to32_many(pairs, hash, NUM_FIXED);
+  for(unsigned n = 0; n < NUM_FIXED; ++n) {
+    lsx_calculate_sha256(pairs[n], SHA256_BLOCKBYTES, expected);
+    if(memcmp(hash[n], expected, SHA256_HASHBYTES)) {
+      fprintf(stderr, "SHA-256 64to32_many node %u failed!\n", n);
+      ret = 1;
+    }
+    lsx_sha256_64to32(pairs[n], hash[n]);
+    if(memcmp(hash[n], expected, SHA256_HASHBYTES)) {
+      fprintf(stderr, "SHA-256 64to32 node %u failed!\n", n);
+      ret = 1;
+    }
+  }
+  for(unsigned c = 0; c < elementcount(chain_lengths); ++c) {
+    const uint8_t (*seeds)[SHA256_HASHBYTES]
+      = (const uint8_t (*)[SHA256_HASHBYTES])long_message;
+    lsx_sha256_iterate_many(seeds, NUM_FIXED, chain_lengths[c], hash);
+    for(unsigned n = 0; n < NUM_FIXED; ++n) {
+      memcpy(expected, seeds[n], SHA256_HASHBYTES);
+      for(uint64_t i = 0; i < chain_lengths[c]; ++i)
+        lsx_calculate_sha256(expected, SHA256_HASHBYTES, expected);
+      if(memcmp(hash[n], expected, SHA256_HASHBYTES)) {
+        fprintf(stderr, "SHA-256 iterate_many chain %u (length %u) "
+                "failed!\n", n, (unsigned)chain_lengths[c]);
+        ret = 1;
+      }
+      lsx_sha256_iterate(seeds[n], chain_lengths[c], hash[n]);
+      if(memcmp(hash[n], expected, SHA256_HASHBYTES)) {
+        fprintf(stderr, "SHA-256 iterate chain %u (length %u) failed!\n",
+                n, (unsigned)chain_lengths[c]);
+        ret = 1;
+      }
+    }
+  }
+  return ret;
+}
+
+/* Scatter/gather input, with fragments of awkward sizes (including empty
+   ones) so that blocks straddle fragments in every way */
+static int test_iovec(void) {
+  static const size_t fragment_sizes[] = {1, 0, 5, 64, 3, 130, 61, 0, 200, 7};
+  lsx_iovec iov[SHA256_BLOCKBYTES * 67 + 29];
+  int ret = 0;
+  for(unsigned n = 0; n < NUM_LONG_PREFIXES; ++n) {
+    size_t len = long_prefix_length(n), pos = 0;
+    int cnt = 0;
+    while(pos < len) {
+      size_t size = fragment_sizes[cnt % elementcount(fragment_sizes)];
+      if(size > len - pos) size = len - pos;
+      iov[cnt].iov_base = long_message + pos;
+      iov[cnt].iov_len = size;
+      pos += size;
+      ++cnt;
+    }
+    uint8_t hash[SHA256_HASHBYTES];
+    lsx_sha256_context ctx;
+    lsx_setup_sha256(&ctx);
+    /* one fragment the old way, so the first block starts half full */
+    lsx_input_sha256(&ctx, iov[0].iov_base, iov[0].iov_len);
+    lsx_input_sha256v(&ctx, iov + 1, cnt - 1);
+    lsx_finish_sha256(&ctx, hash);
+    if(memcmp(hash, long_answers[n], SHA256_HASHBYTES)) {
+      fprintf(stderr, "SHA-256 (iovec) long message %u (%u bytes, %i "
+              "fragments) failed!\n", n, (unsigned)len, cnt);
+      fprintf(stderr, "datum | kn | re\n");
+      for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+        output_datum("h[%2u] | %02X | %02X\n", i, long_answers[n][i],
+                     hash[i]);
+      }
+      ret = 1;
+    }
+  }
+  return ret;
+}
+
+static int test_copy(void) {
+  static uint8_t copy[sizeof(long_message) + 3];
+  int ret = 0;
+  for(unsigned n = 0; n < NUM_LONG_PREFIXES; ++n) {
+    size_t len = long_prefix_length(n);
+    /* an odd split, so the copy starts with a partial block buffered */
+    size_t head = len < 7 ? len : 7;
+    uint8_t hash[SHA256_HASHBYTES];
+    lsx_sha256_context ctx;
+    memset(copy, 0xAA, sizeof(copy));
+    lsx_setup_sha256(&ctx);
+    lsx_sha256_copy_input(&ctx, copy + 1, long_message, head);
+    lsx_sha256_copy_input(&ctx, copy + 1 + head, long_message + head,
+                          len - head);
+    lsx_finish_sha256(&ctx, hash);
+    if(memcmp(hash, long_answers[n], SHA256_HASHBYTES)) {
+      fprintf(stderr, "SHA-256 (copy) long message %u (%u bytes) failed!\n",
+              n, (unsigned)len);
+      fprintf(stderr, "datum | kn | re\n");
+      for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+        output_datum("h[%2u] | %02X | %02X\n", i, long_answers[n][i],
+                     hash[i]);
+      }
+      ret = 1;
+    }
+    if(copy[0] != 0xAA || memcmp(copy + 1, long_message, len)
+       || copy[len + 1] != 0xAA) {
+      fprintf(stderr, "SHA-256 (copy) long message %u (%u bytes) copied "
+              "wrong!\n", n, (unsigned)len);
+      ret = 1;
+    }
+  }
+  return ret;
+}
+
+/* Every known answer and every long prefix, several times over in a jumbled
+   order, so that lanes finish at different times */
+static int test_many(void) {
+#define MANY_COPIES 5
+#define NUM_MANY ((elementcount(known_answers) + NUM_LONG_PREFIXES) * MANY_COPIES)
+  const void* msgs[NUM_MANY];
+  size_t lens[NUM_MANY];
+  const uint8_t* answers[NUM_MANY];
+  uint8_t out[NUM_MANY][SHA256_HASHBYTES];
+  int ret = 0;
+  unsigned n, m = 0;
+  for(unsigned copy = 0; copy < MANY_COPIES; ++copy) {
+    for(n = 0; n < elementcount(known_answers); ++n) {
+      msgs[m] = known_answers[n].message;
+      lens[m] = known_answers[n].msglen;
+      answers[m++] = known_answers[n].answer;
+      if(n < NUM_LONG_PREFIXES) {
+        unsigned p = (n * 7 + copy * 3) % NUM_LONG_PREFIXES;
+        msgs[m] = long_message;
+        lens[m] = long_prefix_length(p);
+        answers[m++] = long_answers[p];
+      }
+    }
+    for(; n < NUM_LONG_PREFIXES; ++n) {
+      msgs[m] = long_message;
+      lens[m] = long_prefix_length(n);
+      answers[m++] = long_answers[n];
+    }
+  }
+  /* all of them, and then a few short batches, one of them public */
+  lsx_calculate_sha256_many(msgs, lens, NUM_MANY, out);
+  lsx_calculate_sha256_many(msgs, lens, 0, NULL);
+  lsx_calculate_sha256_many(msgs + 3, lens + 3, 1, out + 3);
+  lsx_calculate_sha256_many(msgs + 5, lens + 5, 7, out + 5);
+  lsx_calculate_sha256_many_policy(msgs + 12, lens + 12, 9, LSX_POLICY_PUBLIC,
+                                   out + 12);
+  for(n = 0; n < NUM_MANY; ++n) {
+    if(memcmp(out[n], answers[n], SHA256_HASHBYTES)) goto many_failed;
+    continue;
+  many_failed:
+    fprintf(stderr, "SHA-256 (many) message %u (%u bytes) failed!\n", n,
+            (unsigned)lens[n]);
+    fprintf(stderr, "datum | kn | re\n");
+    for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+      output_datum("h[%2u] | %02X | %02X\n", i, answers[n][i], out[n][i]);
+    }
+    ret = 1;
+  }
+  return ret;
+}
+
+static int test_kernel(void) {
+  int ret = 0;
+  /* test the easiest interface */
+  ret = ret || test_lazy();
   /* test the easyish interface with various byte increments */
   ret = ret || test_easyish(1);
   ret = ret || test_easyish(3);
@@ -79,5 +432,30 @@ int main(int argc, char* argv[]) {
   ret = ret || test_easyish(32);
   ret = ret || test_easyish(64);
   ret = ret || test_easyish(67);
+  ret = ret || test_long();
+  ret = ret || test_policy();
+  ret = ret || test_fork();
+  ret = ret || test_fixed();
+  ret = ret || test_iovec();
+  ret = ret || test_copy();
+  return ret;
+}
+
+static int test_many_kernel(void) {
+  return test_many() || test_fixed();
+}
+
+static const char* const impl_names[] = {
+  "auto", "scalar", "SHA-NI", "SSSE3", "AVX2", "unrolled",
+};
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  int ret = 0;
+  plain();
+  make_long_message();
+  ret = for_each_impl(lsx_set_sha256_implementation, impl_names, "kernel",
+                      test_kernel) || ret;
+  ret = for_each_sha256_many_impl(test_many_kernel) || ret;
   return ret;
 }
@@ -0,0 +1,256 @@
+/* for fileno and lseek */
+#define _POSIX_C_SOURCE 200112L
+
+#include "lsx.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lsx_test_common.h"
+
+static uint8_t big_message[300000];
+
+/* Chunk lengths of `big_message`, from a separate implementation of my own */
+static const size_t known_8k[] = {
+  9026, 11688, 4950, 11420, 8378, 8558, 9679, 4255, 8548, 10732, 8547, 9899,
+  9607, 10674, 2606, 9050, 9880, 8730, 8734, 10014, 8898, 9556, 8531, 8982,
+  9535, 8951, 3785, 8454, 10179, 8632, 8845, 9758, 8503, 9348, 3068
+};
+static const size_t known_256[] = {
+  313, 283, 319, 402, 262, 338, 286, 263, 321, 306, 372, 489, 281, 243, 289,
+  280, 187, 332, 257, 577, 175, 271, 180, 298, 260, 166, 345, 302, 271, 358,
+  274, 147, 308, 311, 203, 188, 306, 264, 248, 396, 315, 207, 296, 394, 305,
+  113, 444, 283, 315, 277, 286, 283, 335, 109, 264, 384, 257, 260, 397, 347
+};
+#define KNOWN_256_COUNT 1042
+
+static const struct params {
+  size_t min_bytes, avg_bytes, max_bytes;
+  const size_t* known;
+  size_t known_count, total_count;
+} params[] = {
+  {2048, 8192, 65536, known_8k, elementcount(known_8k),
+   elementcount(known_8k)},
+  {64, 256, 1024, known_256, elementcount(known_256), KNOWN_256_COUNT},
+  /* fixed-size chunks */
+  {1000, 1000, 1000, NULL, 0, 300},
+  /* every byte its own chunk */
+  {1, 1, 1, NULL, 0, sizeof(big_message)},
+};
+
+/* how the stream is fed in */
+static const size_t splits[] = {1, 7, 4096, 65537, sizeof(big_message)};
+
+#define MAX_CHUNKS sizeof(big_message)
+struct collector {
+  lsx_sha256_cdc_chunk chunks[MAX_CHUNKS];
+  size_t count, calls;
+};
+static struct collector got, expected;
+
+static void collect(void* arg, const lsx_sha256_cdc_chunk* chunks,
+                    size_t count) {
+  struct collector* c = (struct collector*)arg;
+  ++c->calls;
+  if(c->count + count > MAX_CHUNKS) return;
+  memcpy(c->chunks + c->count, chunks, count * sizeof(*chunks));
+  c->count += count;
+}
+
+static int chunk_stream(const uint8_t* message, size_t bytes,
+                        const struct params* p, size_t split,
+                        struct collector* c) {
+  lsx_sha256_cdc ctx;
+  c->count = c->calls = 0;
+  if(!lsx_setup_sha256_cdc(&ctx, p->min_bytes, p->avg_bytes, p->max_bytes,
+                           collect, c)) {
+    fprintf(stderr, "SHA-256 CDC refused %u/%u/%u!\n",
+            (unsigned)p->min_bytes, (unsigned)p->avg_bytes,
+            (unsigned)p->max_bytes);
+    return 1;
+  }
+  /* the policy mustn't change the chunks, and must outlast chunks that span
+     calls */
+  if(split % 2) lsx_set_sha256_cdc_policy(&ctx, LSX_POLICY_PUBLIC);
+  for(size_t pos = 0; pos < bytes; pos += split)
+    lsx_input_sha256_cdc(&ctx, message + pos,
+                         bytes - pos < split ? bytes - pos : split);
+  if(lsx_sha256_cdc_policy(&ctx) != (split % 2 ? LSX_POLICY_PUBLIC
+                                     : LSX_DEFAULT_POLICY)) {
+    fprintf(stderr, "SHA-256 CDC forgot its policy!\n");
+    return 1;
+  }
+  lsx_finish_sha256_cdc(&ctx);
+  lsx_destroy_sha256_cdc(&ctx);
+  return 0;
+}
+
+/* Chunks must tile the message, respect the limits and hash correctly */
+static int check_chunks(const uint8_t* message, size_t bytes,
+                        const struct params* p, const struct collector* c) {
+  uint64_t offset = 0;
+  for(size_t n = 0; n < c->count; ++n) {
+    const lsx_sha256_cdc_chunk* chunk = c->chunks + n;
+    uint8_t known[SHA256_HASHBYTES];
+    if(chunk->offset != offset || chunk->bytes == 0
+       || chunk->bytes > p->max_bytes
+       || (chunk->bytes < p->min_bytes && n + 1 < c->count)
+       || chunk->offset + chunk->bytes > bytes) {
+      fprintf(stderr, "SHA-256 CDC chunk %u is out of place (%u bytes at %u)!"
+              "\n", (unsigned)n, (unsigned)chunk->bytes,
+              (unsigned)chunk->offset);
+      return 1;
+    }
+    lsx_calculate_sha256(message + offset, chunk->bytes, known);
+    if(memcmp(known, chunk->digest, SHA256_HASHBYTES)) {
+      fprintf(stderr, "SHA-256 CDC chunk %u's digest is wrong!\n",
+              (unsigned)n);
+      fprintf(stderr, "datum | kn | re\n");
+      for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+        output_datum("h[%2u] | %02X | %02X\n", i, known[i], chunk->digest[i]);
+      }
+      return 1;
+    }
+    offset += chunk->bytes;
+  }
+  if(offset != bytes) {
+    fprintf(stderr, "SHA-256 CDC chunks only covered %u of %u bytes!\n",
+            (unsigned)offset, (unsigned)bytes);
+    return 1;
+  }
+  return 0;
+}
+
+static int same_chunks(const struct collector* a, const struct collector* b) {
+  return a->count == b->count
+    && !memcmp(a->chunks, b->chunks, a->count * sizeof(*a->chunks));
+}
+
+static int test_known() {
+  for(unsigned n = 0; n < elementcount(params); ++n) {
+    const struct params* p = params + n;
+    if(chunk_stream(big_message, sizeof(big_message), p, sizeof(big_message),
+                    &expected)
+       || check_chunks(big_message, sizeof(big_message), p, &expected))
+      return 1;
+    if(expected.count != p->total_count) {
+      fprintf(stderr, "SHA-256 CDC %u made %u chunks, not %u!\n", n,
+              (unsigned)expected.count, (unsigned)p->total_count);
+      return 1;
+    }
+    for(size_t m = 0; m < p->known_count; ++m) {
+      if(expected.chunks[m].bytes != p->known[m]) {
+        fprintf(stderr, "SHA-256 CDC %u chunk %u is %u bytes, not %u!\n", n,
+                (unsigned)m, (unsigned)expected.chunks[m].bytes,
+                (unsigned)p->known[m]);
+        return 1;
+      }
+    }
+    /* how the stream is split up mustn't matter */
+    for(unsigned s = 0; s < elementcount(splits); ++s) {
+      if(chunk_stream(big_message, sizeof(big_message), p, splits[s], &got))
+        return 1;
+      if(!same_chunks(&expected, &got)) {
+        fprintf(stderr, "SHA-256 CDC %u changed when fed %u bytes at a time!"
+                "\n", n, (unsigned)splits[s]);
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+/* An inserted byte should only disturb the chunks around it */
+static int test_insert() {
+  static uint8_t changed[sizeof(big_message) + 1];
+  const size_t at = sizeof(big_message) / 2;
+  size_t shared = 0;
+  memcpy(changed, big_message, at);
+  changed[at] = 0x5A;
+  memcpy(changed + at + 1, big_message + at, sizeof(big_message) - at);
+  chunk_stream(big_message, sizeof(big_message), params, 4096, &expected);
+  chunk_stream(changed, sizeof(changed), params, 4096, &got);
+  if(check_chunks(changed, sizeof(changed), params, &got)) return 1;
+  for(size_t n = 0; n < got.count; ++n)
+    for(size_t m = 0; m < expected.count; ++m)
+      if(!memcmp(got.chunks[n].digest, expected.chunks[m].digest,
+                 SHA256_HASHBYTES)) {
+        ++shared;
+        break;
+      }
+  if(shared + 2 < expected.count) {
+    fprintf(stderr, "SHA-256 CDC only kept %u of %u chunks after an"
+            " insertion!\n", (unsigned)shared, (unsigned)expected.count);
+    return 1;
+  }
+  return 0;
+}
+
+static int test_fd() {
+  FILE* f = tmpfile();
+  lsx_sha256_cdc ctx;
+  if(f == NULL || fwrite(big_message, sizeof(big_message), 1, f) != 1
+     || fflush(f)) {
+    fprintf(stderr, "(skipping SHA-256 CDC file test, no temporary file)\n");
+    if(f != NULL) fclose(f);
+    return 0;
+  }
+  lseek(fileno(f), 0, SEEK_SET);
+  chunk_stream(big_message, sizeof(big_message), params, sizeof(big_message),
+               &expected);
+  got.count = got.calls = 0;
+  lsx_setup_sha256_cdc(&ctx, params->min_bytes, params->avg_bytes,
+                       params->max_bytes, collect, &got);
+  if(!lsx_input_sha256_cdc_fd(&ctx, fileno(f))) {
+    fprintf(stderr, "SHA-256 CDC couldn't read a file!\n");
+    fclose(f);
+    return 1;
+  }
+  lsx_finish_sha256_cdc(&ctx);
+  fclose(f);
+  if(!same_chunks(&expected, &got)) {
+    fprintf(stderr, "SHA-256 CDC changed when read from a file!\n");
+    return 1;
+  }
+  if(lsx_input_sha256_cdc_fd(&ctx, -1)) {
+    fprintf(stderr, "SHA-256 CDC ignored a read error!\n");
+    return 1;
+  }
+  return 0;
+}
+
+static int test_limits() {
+  lsx_sha256_cdc ctx;
+  if(lsx_setup_sha256_cdc(&ctx, 0, 8, 16, collect, &got)
+     || lsx_setup_sha256_cdc(&ctx, 16, 8, 16, collect, &got)
+     || lsx_setup_sha256_cdc(&ctx, 4, 16, 8, collect, &got)) {
+    fprintf(stderr, "SHA-256 CDC accepted bad sizes!\n");
+    return 1;
+  }
+  /* an empty stream has no chunks */
+  got.count = got.calls = 0;
+  lsx_setup_sha256_cdc(&ctx, 4, 8, 16, collect, &got);
+  lsx_input_sha256_cdc(&ctx, "", 0);
+  lsx_finish_sha256_cdc(&ctx);
+  if(got.calls != 0) {
+    fprintf(stderr, "SHA-256 CDC made chunks out of nothing!\n");
+    return 1;
+  }
+  return 0;
+}
+
+static int test_kernel() {
+  return test_known() || test_insert() || test_fd();
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  int ret = 0;
+  plain();
+  fill_pseudorandom(big_message, sizeof(big_message), 0x12345678);
+  ret = ret || test_limits();
+  /* chunks go through the multi-buffer kernels, so try all of them */
+  ret = for_each_sha256_many_impl(test_kernel) || ret;
+  return ret;
+}
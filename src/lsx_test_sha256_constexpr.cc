@@ -0,0 +1,72 @@
+#include "lsx.hh"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lsx_test_common.h"
+
+/* Every prefix of this gets hashed, so the padding lands in all the places it
+   can: alone in a block, split across two, and so on */
+static const char text[] = "Lorem ipsum dolor sit amet, consectetur adipisicing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud";
+#define NUM_PREFIXES (sizeof(text))
+
+typedef std::array<uint8_t, SHA256_HASHBYTES> digest;
+
+template<size_t... I>
+static constexpr std::array<digest, sizeof...(I)>
+prefix_sums(std::index_sequence<I...>) {
+  return {{lsx::sha256::ct_sum(text, I)...}};
+}
+
+/* all computed while compiling */
+static constexpr std::array<digest, NUM_PREFIXES> prefix_answers
+  = prefix_sums(std::make_index_sequence<NUM_PREFIXES>());
+
+/* Known answers from Wikipedia - http://en.wikipedia.org/wiki/SHA-2 */
+static_assert(lsx::sha256::digest_prefix64(lsx::sha256::ct_sum(""))
+              == 0xe3b0c44298fc1c14ULL, "constexpr SHA-256 of \"\" is wrong");
+static_assert(lsx::sha256::digest_prefix64(lsx::sha256::ct_sum(
+                "The quick brown fox jumps over the lazy dog"))
+              == 0xd7a8fbb307d78094ULL,
+              "constexpr SHA-256 of the quick brown fox is wrong");
+static constexpr digest fox
+  = lsx::sha256::ct_sum("The quick brown fox jumps over the lazy dog.");
+static_assert(fox[0] == 0xef && fox[31] == 0x6c,
+              "constexpr SHA-256 of the quick brown fox. is wrong");
+
+/* the point of the exercise */
+static int classify(const char* tag) {
+  uint8_t hash[SHA256_HASHBYTES];
+  lsx::sha256::sum(tag, strlen(tag), hash);
+  switch(lsx::sha256::digest_prefix64(hash)) {
+  case lsx::sha256::digest_prefix64(lsx::sha256::ct_sum("hello")): return 1;
+  case lsx::sha256::digest_prefix64(lsx::sha256::ct_sum("goodbye")): return 2;
+  default: return 0;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  int ret = 0;
+  plain();
+  for(unsigned n = 0; n < NUM_PREFIXES; ++n) {
+    uint8_t hash[SHA256_HASHBYTES];
+    lsx_calculate_sha256(text, n, hash);
+    if(memcmp(hash, prefix_answers[n].data(), SHA256_HASHBYTES)) {
+      fprintf(stderr, "SHA-256 constexpr prefix %u failed!\n", n);
+      fprintf(stderr, "datum | ct | rt\n");
+      for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+        output_datum("h[%2u] | %02X | %02X\n", i, prefix_answers[n][i],
+                     hash[i]);
+      }
+      plain();
+      ret = 1;
+    }
+  }
+  if(classify("hello") != 1 || classify("goodbye") != 2
+     || classify("hello?") != 0) {
+    fprintf(stderr, "SHA-256 constexpr digests made bad switch labels!\n");
+    ret = 1;
+  }
+  return ret;
+}
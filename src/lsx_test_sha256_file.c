@@ -0,0 +1,178 @@
+/* for fileno, fork, mkstemp... */
+#define _POSIX_C_SOURCE 200809L
+
+#include "lsx.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lsx_test_common.h"
+
+/* bigger than both read buffers together, and not a whole number of pages */
+static uint8_t big_message[(5 << 20) + 12345];
+static const size_t offsets[] = {0, 1, 4095, 4096, 5000, (1 << 20) + 3,
+                                 sizeof(big_message) - 1,
+                                 sizeof(big_message)};
+
+static int check(const char* what, size_t offset, const uint8_t* result) {
+  uint8_t known[SHA256_HASHBYTES];
+  lsx_calculate_sha256(big_message + offset, sizeof(big_message) - offset,
+                       known);
+  if(memcmp(known, result, SHA256_HASHBYTES)) {
+    fprintf(stderr, "SHA-256 %s, offset %u failed!\n", what,
+            (unsigned)offset);
+    fprintf(stderr, "datum | kn | re\n");
+    for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+      output_datum("h[%2u] | %02X | %02X\n", i, known[i], result[i]);
+    }
+    return 1;
+  }
+  return 0;
+}
+
+static int write_all(int fd, const uint8_t* p, size_t bytes) {
+  while(bytes > 0) {
+    ssize_t wrote = write(fd, p, bytes);
+    if(wrote < 0) {
+      if(errno == EINTR) continue;
+      return 0;
+    }
+    p += wrote;
+    bytes -= (size_t)wrote;
+  }
+  return 1;
+}
+
+/* A regular file, hashed from various starting points */
+static int test_regular() {
+  char path[] = "/tmp/lsx_test_sha256_file_XXXXXX";
+  uint8_t hash[SHA256_HASHBYTES];
+  int fd = mkstemp(path), ret = 0;
+  if(fd < 0) {
+    fprintf(stderr, "(skipping SHA-256 regular file test, no temporary"
+            " file)\n");
+    return 0;
+  }
+  if(!write_all(fd, big_message, sizeof(big_message))) {
+    fprintf(stderr, "(skipping SHA-256 regular file test, couldn't write)\n");
+    close(fd);
+    unlink(path);
+    return 0;
+  }
+  for(unsigned n = 0; n < elementcount(offsets) && !ret; ++n) {
+    lseek(fd, offsets[n], SEEK_SET);
+    if(!lsx_sha256_fd(fd, hash)) {
+      fprintf(stderr, "SHA-256 regular file, offset %u refused: %s\n",
+              (unsigned)offsets[n], strerror(errno));
+      ret = 1;
+    }
+    else if(check("regular file", offsets[n], hash)) ret = 1;
+    else if(lseek(fd, 0, SEEK_CUR) != (off_t)sizeof(big_message)) {
+      fprintf(stderr, "SHA-256 regular file left the offset wrong!\n");
+      ret = 1;
+    }
+  }
+  /* past the end, there's nothing to hash, and the offset stays put */
+  if(!ret) {
+    uint8_t known[SHA256_HASHBYTES];
+    lsx_calculate_sha256("", 0, known);
+    lseek(fd, sizeof(big_message) + 100, SEEK_SET);
+    if(!lsx_sha256_fd(fd, hash) || memcmp(known, hash, SHA256_HASHBYTES)
+       || lseek(fd, 0, SEEK_CUR) != (off_t)sizeof(big_message) + 100) {
+      fprintf(stderr, "SHA-256 regular file past the end failed!\n");
+      ret = 1;
+    }
+  }
+  close(fd);
+  if(!ret) {
+    if(!lsx_sha256_file(path, hash)) {
+      fprintf(stderr, "SHA-256 file by name refused: %s\n", strerror(errno));
+      ret = 1;
+    }
+    else ret = check("file by name", 0, hash);
+  }
+  unlink(path);
+  return ret;
+}
+
+/* A regular file whose size is reported as 0 but isn't, as in procfs */
+static int test_unsized() {
+  static const char path[] = "/proc/self/cmdline";
+  uint8_t buf[4096], known[SHA256_HASHBYTES], hash[SHA256_HASHBYTES];
+  size_t bytes;
+  FILE* f = fopen(path, "rb");
+  if(!f) {
+    fprintf(stderr, "(skipping SHA-256 unsized file test, no %s)\n", path);
+    return 0;
+  }
+  bytes = fread(buf, 1, sizeof(buf), f);
+  fclose(f);
+  lsx_calculate_sha256(buf, bytes, known);
+  if(!lsx_sha256_file(path, hash)) {
+    fprintf(stderr, "SHA-256 unsized file refused: %s\n", strerror(errno));
+    return 1;
+  }
+  if(memcmp(known, hash, SHA256_HASHBYTES)) {
+    fprintf(stderr, "SHA-256 unsized file failed!\n");
+    return 1;
+  }
+  return 0;
+}
+
+/* A pipe, fed by another process, so it goes through the reading thread */
+static int test_pipe() {
+  uint8_t hash[SHA256_HASHBYTES];
+  int fds[2], status, ok;
+  pid_t pid;
+  if(pipe(fds)) {
+    fprintf(stderr, "(skipping SHA-256 pipe test, no pipe)\n");
+    return 0;
+  }
+  pid = fork();
+  if(pid < 0) {
+    fprintf(stderr, "(skipping SHA-256 pipe test, couldn't fork)\n");
+    close(fds[0]);
+    close(fds[1]);
+    return 0;
+  }
+  if(pid == 0) {
+    close(fds[0]);
+    _exit(write_all(fds[1], big_message, sizeof(big_message)) ? 0 : 1);
+  }
+  close(fds[1]);
+  ok = lsx_sha256_fd(fds[0], hash);
+  close(fds[0]);
+  waitpid(pid, &status, 0);
+  if(!ok) {
+    fprintf(stderr, "SHA-256 pipe refused: %s\n", strerror(errno));
+    return 1;
+  }
+  return check("pipe", 0, hash);
+}
+
+static int test_errors() {
+  uint8_t hash[SHA256_HASHBYTES];
+  errno = 0;
+  if(lsx_sha256_file("/nonexistent/lsx_test_sha256_file", hash)
+     || errno != ENOENT) {
+    fprintf(stderr, "SHA-256 file didn't fail properly on a missing file!\n");
+    return 1;
+  }
+  errno = 0;
+  if(lsx_sha256_fd(-1, hash) || errno != EBADF) {
+    fprintf(stderr, "SHA-256 file didn't fail properly on a bad fd!\n");
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  plain();
+  fill_pseudorandom(big_message, sizeof(big_message), 0x12345678);
+  return test_errors() || test_regular() || test_unsized() || test_pipe();
+}
@@ -0,0 +1,310 @@
+#include "lsx.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lsx_test_common.h"
+
+static uint8_t object[SHA256_BLOCKBYTES * 700 + 33];
+static uint8_t storage[65536];
+static uint8_t saved[65536 + LSX_SHA256_MERKLE_HEADER_BYTES];
+static uint8_t other_storage[65536];
+
+static const size_t chunk_sizes[] = {1, 64, 100, 4096, sizeof(object),
+                                     sizeof(object) * 2};
+static const size_t object_sizes[] = {0, 1, 64, 65, 4096, 4097,
+                                      sizeof(object)};
+
+static uint32_t seed = 0x12345678;
+static uint32_t next_random() {
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+/* Reads straight from `object`, counting the calls. Fails on the chunk
+   numbered `fail_at`, if that isn't -1. */
+static size_t reads, fail_at;
+static const void* read_chunk(void* arg, size_t index, size_t bytes) {
+  size_t chunk_bytes = *(const size_t*)arg;
+  (void)bytes;
+  if(index == fail_at) return NULL;
+  ++reads;
+  return object + index * chunk_bytes;
+}
+
+static int check(const lsx_sha256_merkle* tree, size_t object_bytes,
+                 size_t chunk_bytes, const char* when) {
+  uint8_t known[SHA256_HASHBYTES], result[SHA256_HASHBYTES];
+  lsx_calculate_sha256_tree(object, object_bytes, chunk_bytes, 1, known);
+  if(!lsx_sha256_merkle_digest(tree, result)) {
+    fprintf(stderr, "SHA-256 Merkle tree (%u byte object, %u byte chunks) "
+            "refused to give a digest %s!\n", (unsigned)object_bytes,
+            (unsigned)chunk_bytes, when);
+    return 1;
+  }
+  if(memcmp(known, result, SHA256_HASHBYTES)) {
+    fprintf(stderr, "SHA-256 Merkle tree (%u byte object, %u byte chunks) "
+            "failed %s!\n", (unsigned)object_bytes, (unsigned)chunk_bytes,
+            when);
+    fprintf(stderr, "datum | kn | re\n");
+    for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+      output_datum("h[%2u] | %02X | %02X\n", i, known[i], result[i]);
+    }
+    return 1;
+  }
+  return 0;
+}
+
+static int test_one(size_t object_bytes, size_t chunk_bytes) {
+  lsx_sha256_merkle tree, loaded;
+  uint8_t dummy[SHA256_HASHBYTES];
+  size_t need = lsx_sha256_merkle_storage_bytes(object_bytes, chunk_bytes);
+  if(need == 0 || need > sizeof(storage)) {
+    fprintf(stderr, "SHA-256 Merkle tree (%u byte object, %u byte chunks) "
+            "wanted %u bytes of storage!\n", (unsigned)object_bytes,
+            (unsigned)chunk_bytes, (unsigned)need);
+    return 1;
+  }
+  if(lsx_setup_sha256_merkle(&tree, storage, need - 1, object_bytes,
+                             chunk_bytes)) {
+    fprintf(stderr, "SHA-256 Merkle tree accepted too little storage!\n");
+    return 1;
+  }
+  lsx_setup_sha256_merkle(&tree, storage, need, object_bytes, chunk_bytes);
+  if(lsx_sha256_merkle_digest(&tree, dummy)) {
+    fprintf(stderr, "SHA-256 Merkle tree gave a digest before its first "
+            "commit!\n");
+    return 1;
+  }
+  lsx_sha256_merkle_commit(&tree, NULL, object);
+  if(check(&tree, object_bytes, chunk_bytes, "after the first commit"))
+    return 1;
+  /* a few small writes; only their chunks should be read */
+  for(unsigned rep = 0; rep < 5 && object_bytes > 0; ++rep) {
+    size_t touched[3 * 8], num_touched = 0;
+    for(unsigned w = 0; w < 3; ++w) {
+      size_t offset = next_random() % object_bytes;
+      size_t bytes = next_random() % 8 + 1;
+      if(bytes > object_bytes - offset) bytes = object_bytes - offset;
+      for(size_t i = 0; i < bytes; ++i) object[offset + i] ^= 0x5A;
+      lsx_sha256_merkle_touch_range(&tree, offset, bytes);
+      for(size_t c = offset / chunk_bytes;
+          c <= (offset + bytes - 1) / chunk_bytes; ++c) {
+        unsigned dup = 0;
+        for(size_t i = 0; i < num_touched; ++i) dup |= touched[i] == c;
+        if(!dup) touched[num_touched++] = c;
+      }
+    }
+    if(lsx_sha256_merkle_digest(&tree, dummy)) {
+      fprintf(stderr, "SHA-256 Merkle tree gave a digest with uncommitted "
+              "changes!\n");
+      return 1;
+    }
+    /* fail partway through, then finish */
+    reads = 0;
+    fail_at = touched[num_touched - 1];
+    if(lsx_sha256_merkle_commit(&tree, read_chunk, &chunk_bytes)) {
+      fprintf(stderr, "SHA-256 Merkle tree commit ignored a failed read!\n");
+      return 1;
+    }
+    fail_at = (size_t)-1;
+    lsx_sha256_merkle_commit(&tree, read_chunk, &chunk_bytes);
+    if(reads != num_touched) {
+      fprintf(stderr, "SHA-256 Merkle tree (%u byte object, %u byte chunks) "
+              "read %u chunks after touching %u!\n", (unsigned)object_bytes,
+              (unsigned)chunk_bytes, (unsigned)reads, (unsigned)num_touched);
+      return 1;
+    }
+    if(check(&tree, object_bytes, chunk_bytes, "after an update")) return 1;
+  }
+  /* save with a change pending, load, and carry on */
+  if(object_bytes > 0) {
+    object[0] ^= 1;
+    lsx_sha256_merkle_touch(&tree, 0);
+  }
+  size_t saved_bytes = lsx_sha256_merkle_export_bytes(&tree);
+  lsx_sha256_merkle_export(&tree, saved);
+  saved[3] ^= 1;
+  if(lsx_sha256_merkle_import(&loaded, other_storage, sizeof(other_storage),
+                              saved, saved_bytes)) {
+    fprintf(stderr, "SHA-256 Merkle tree loaded a damaged blob!\n");
+    return 1;
+  }
+  saved[3] ^= 1;
+  if(lsx_sha256_merkle_import(&loaded, other_storage, sizeof(other_storage),
+                              saved, saved_bytes - 1)
+     || lsx_sha256_merkle_import(&loaded, other_storage, need - 1,
+                                 saved, saved_bytes)) {
+    fprintf(stderr, "SHA-256 Merkle tree loaded a blob it shouldn't have!\n");
+    return 1;
+  }
+  if(!lsx_sha256_merkle_import(&loaded, other_storage, sizeof(other_storage),
+                               saved, saved_bytes)) {
+    fprintf(stderr, "SHA-256 Merkle tree refused to load its own blob!\n");
+    return 1;
+  }
+  reads = 0;
+  lsx_sha256_merkle_commit(&loaded, read_chunk, &chunk_bytes);
+  if(reads != (object_bytes > 0)) {
+    fprintf(stderr, "SHA-256 Merkle tree read %u chunks after loading!\n",
+            (unsigned)reads);
+    return 1;
+  }
+  return check(&loaded, object_bytes, chunk_bytes, "after loading");
+}
+
+static int check_proof(const lsx_sha256_merkle* tree, size_t object_bytes,
+                       size_t chunk_bytes, size_t first, size_t count) {
+  uint8_t proof[LSX_SHA256_MERKLE_MAX_PROOF_BYTES + 1];
+  uint8_t digest[SHA256_HASHBYTES];
+  size_t proof_bytes, offset = first * chunk_bytes;
+  size_t bytes = count * chunk_bytes;
+  if(bytes > object_bytes - offset) bytes = object_bytes - offset;
+  lsx_sha256_merkle_digest(tree, digest);
+  if(!lsx_sha256_merkle_prove(tree, first, count, proof, &proof_bytes)) {
+    fprintf(stderr, "SHA-256 Merkle tree wouldn't prove chunks %u+%u!\n",
+            (unsigned)first, (unsigned)count);
+    return 1;
+  }
+  if(!lsx_sha256_merkle_verify(digest, object_bytes, chunk_bytes, first,
+                               object + offset, bytes, proof, proof_bytes)) {
+    fprintf(stderr, "SHA-256 Merkle tree (%u byte object, %u byte chunks) "
+            "proof of chunks %u+%u failed!\n", (unsigned)object_bytes,
+            (unsigned)chunk_bytes, (unsigned)first, (unsigned)count);
+    return 1;
+  }
+  /* anything wrong should fail */
+  int accepted = 0;
+  if(bytes > 0) {
+    object[offset + bytes / 2] ^= 0x10;
+    accepted |= lsx_sha256_merkle_verify(digest, object_bytes, chunk_bytes,
+                                         first, object + offset, bytes,
+                                         proof, proof_bytes);
+    object[offset + bytes / 2] ^= 0x10;
+  }
+  if(proof_bytes > 0) {
+    proof[proof_bytes - 1] ^= 1;
+    accepted |= lsx_sha256_merkle_verify(digest, object_bytes, chunk_bytes,
+                                         first, object + offset, bytes,
+                                         proof, proof_bytes);
+    proof[proof_bytes - 1] ^= 1;
+    accepted |= lsx_sha256_merkle_verify(digest, object_bytes, chunk_bytes,
+                                         first, object + offset, bytes,
+                                         proof, proof_bytes - 1);
+  }
+  accepted |= lsx_sha256_merkle_verify(digest, object_bytes, chunk_bytes,
+                                       first, object + offset, bytes,
+                                       proof, proof_bytes + 1);
+  if(first > 0)
+    accepted |= lsx_sha256_merkle_verify(digest, object_bytes, chunk_bytes,
+                                         first - 1, object + offset, bytes,
+                                         proof, proof_bytes);
+  if(bytes > 1)
+    accepted |= lsx_sha256_merkle_verify(digest, object_bytes, chunk_bytes,
+                                         first, object + offset, bytes - 1,
+                                         proof, proof_bytes);
+  digest[0] ^= 1;
+  accepted |= lsx_sha256_merkle_verify(digest, object_bytes, chunk_bytes,
+                                       first, object + offset, bytes,
+                                       proof, proof_bytes);
+  if(accepted) {
+    fprintf(stderr, "SHA-256 Merkle tree (%u byte object, %u byte chunks) "
+            "accepted a bad proof of chunks %u+%u!\n",
+            (unsigned)object_bytes, (unsigned)chunk_bytes, (unsigned)first,
+            (unsigned)count);
+    return 1;
+  }
+  return 0;
+}
+
+static int test_proofs(size_t object_bytes, size_t chunk_bytes) {
+  lsx_sha256_merkle tree;
+  lsx_setup_sha256_merkle(&tree, storage, sizeof(storage), object_bytes,
+                          chunk_bytes);
+  lsx_sha256_merkle_commit(&tree, NULL, object);
+  if(tree.chunks <= 20) {
+    /* every possible range */
+    for(size_t first = 0; first < tree.chunks; ++first) {
+      for(size_t count = 1; count <= tree.chunks - first; ++count) {
+        if(check_proof(&tree, object_bytes, chunk_bytes, first, count))
+          return 1;
+      }
+    }
+  }
+  else {
+    for(unsigned rep = 0; rep < 100; ++rep) {
+      size_t first = next_random() % tree.chunks;
+      size_t count = next_random() % (rep < 50 ? 9 : tree.chunks - first) + 1;
+      if(count > tree.chunks - first) count = tree.chunks - first;
+      if(check_proof(&tree, object_bytes, chunk_bytes, first, count))
+        return 1;
+    }
+    if(check_proof(&tree, object_bytes, chunk_bytes, 0, tree.chunks)
+       || check_proof(&tree, object_bytes, chunk_bytes, tree.chunks - 1, 1))
+      return 1;
+  }
+  uint8_t proof[LSX_SHA256_MERKLE_MAX_PROOF_BYTES];
+  size_t proof_bytes;
+  if(lsx_sha256_merkle_prove(&tree, 0, 0, proof, &proof_bytes)
+     || lsx_sha256_merkle_prove(&tree, tree.chunks, 1, proof, &proof_bytes)
+     || lsx_sha256_merkle_prove(&tree, 0, tree.chunks + 1, proof,
+                                &proof_bytes)) {
+    fprintf(stderr, "SHA-256 Merkle tree proved a range past the end!\n");
+    return 1;
+  }
+  lsx_sha256_merkle_touch(&tree, 0);
+  if(lsx_sha256_merkle_prove(&tree, 0, 1, proof, &proof_bytes)) {
+    fprintf(stderr, "SHA-256 Merkle tree proved a range with uncommitted "
+            "changes!\n");
+    return 1;
+  }
+  return 0;
+}
+
+static int test_limits() {
+  lsx_sha256_merkle tree;
+  if(lsx_sha256_merkle_storage_bytes(100, 0)
+     || lsx_setup_sha256_merkle(&tree, storage, sizeof(storage), 100, 0)) {
+    fprintf(stderr, "SHA-256 Merkle tree accepted zero-byte chunks!\n");
+    return 1;
+  }
+  lsx_setup_sha256_merkle(&tree, storage, sizeof(storage), 1000, 64);
+  if(lsx_sha256_merkle_touch(&tree, 16)
+     || lsx_sha256_merkle_touch_range(&tree, 990, 11)
+     || lsx_sha256_merkle_touch_range(&tree, 1001, 0)) {
+    fprintf(stderr, "SHA-256 Merkle tree touched past the end!\n");
+    return 1;
+  }
+  if(!lsx_sha256_merkle_touch(&tree, 15)
+     || !lsx_sha256_merkle_touch_range(&tree, 990, 10)
+     || !lsx_sha256_merkle_touch_range(&tree, 1000, 0)) {
+    fprintf(stderr, "SHA-256 Merkle tree refused to touch the end!\n");
+    return 1;
+  }
+  return 0;
+}
+
+static int test_kernel() {
+  int ret = 0;
+  for(unsigned c = 0; c < elementcount(chunk_sizes) && !ret; ++c) {
+    for(unsigned o = 0; o < elementcount(object_sizes) && !ret; ++o) {
+      /* one-byte chunks of the big object need too much storage */
+      if(chunk_sizes[c] == 1 && object_sizes[o] > 1000) continue;
+      ret = test_one(object_sizes[o], chunk_sizes[c])
+        || test_proofs(object_sizes[o], chunk_sizes[c]);
+    }
+  }
+  return ret;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  int ret = 0;
+  plain();
+  fail_at = (size_t)-1;
+  fill_pseudorandom(object, sizeof(object), 0x12345678);
+  ret = ret || test_limits();
+  /* interior nodes go through the multi-buffer kernels */
+  ret = for_each_sha256_many_impl(test_kernel) || ret;
+  return ret;
+}
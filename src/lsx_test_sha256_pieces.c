@@ -0,0 +1,246 @@
+/* for fileno and lseek */
+#define _POSIX_C_SOURCE 200112L
+
+#include "lsx.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lsx_test_common.h"
+
+static const unsigned thread_counts[] = {0, 1, 2, 3, 8, 64, 1000};
+
+static uint8_t big_message[SHA256_BLOCKBYTES * 3000 + 17];
+static const size_t piece_sizes[] = {1, 55, 64, 100, 4096, 65536,
+                                     sizeof(big_message),
+                                     sizeof(big_message) + 1};
+#define MAX_PIECES sizeof(big_message)
+
+static uint8_t known[MAX_PIECES][SHA256_HASHBYTES];
+static uint8_t result[MAX_PIECES][SHA256_HASHBYTES];
+
+/* One piece at a time, the slow way */
+static size_t reference_pieces(size_t bytes, size_t piece_bytes) {
+  size_t n = 0, start;
+  for(start = 0; start < bytes; start += piece_bytes, ++n) {
+    size_t len = bytes - start < piece_bytes ? bytes - start : piece_bytes;
+    lsx_calculate_sha256(big_message + start, len, known[n]);
+  }
+  return n;
+}
+
+static int check(const char* what, size_t piece_bytes, unsigned threads,
+                 size_t pieces) {
+  for(size_t n = 0; n < pieces; ++n) {
+    if(memcmp(known[n], result[n], SHA256_HASHBYTES)) {
+      fprintf(stderr, "SHA-256 pieces %s, piece size %u (%u threads), "
+              "piece %u failed!\n", what, (unsigned)piece_bytes, threads,
+              (unsigned)n);
+      fprintf(stderr, "datum | kn | re\n");
+      for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+        output_datum("h[%2u] | %02X | %02X\n", i, known[n][i], result[n][i]);
+      }
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int test_buffer() {
+  for(unsigned n = 0; n < elementcount(piece_sizes); ++n) {
+    /* a few lengths, so the last piece is sometimes short */
+    for(size_t bytes = sizeof(big_message) - 150; bytes <= sizeof(big_message);
+        bytes += 50) {
+      size_t pieces = reference_pieces(bytes, piece_sizes[n]);
+      if(pieces != lsx_sha256_count_pieces(bytes, piece_sizes[n])) {
+        fprintf(stderr, "SHA-256 pieces miscounted!\n");
+        return 1;
+      }
+      for(unsigned t = 0; t < elementcount(thread_counts); ++t) {
+        memset(result, 0, pieces * SHA256_HASHBYTES);
+        /* the policy mustn't change the answers */
+        lsx_sha256_pieces_policy(big_message, bytes, piece_sizes[n],
+                                 thread_counts[t], t % 2 ? LSX_POLICY_PUBLIC
+                                 : LSX_POLICY_SECRET, result);
+        if(check("buffer", piece_sizes[n], thread_counts[t], pieces))
+          return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+static int test_fd() {
+  static uint8_t buf[65536 * 3];
+  FILE* f = tmpfile();
+  int fd;
+  if(f == NULL) {
+    fprintf(stderr, "(skipping SHA-256 pieces file test, no temporary file)\n");
+    return 0;
+  }
+  if(fwrite(big_message, sizeof(big_message), 1, f) != 1 || fflush(f)) {
+    fprintf(stderr, "(skipping SHA-256 pieces file test, couldn't write)\n");
+    fclose(f);
+    return 0;
+  }
+  fd = fileno(f);
+  for(unsigned n = 0; n < elementcount(piece_sizes); ++n) {
+    size_t piece_bytes = piece_sizes[n];
+    size_t pieces = reference_pieces(sizeof(big_message), piece_bytes);
+    /* room for one piece, a few, and all of them */
+    const size_t buf_sizes[] = {piece_bytes, piece_bytes * 3 - 1, sizeof(buf)};
+    for(unsigned b = 0; b < elementcount(buf_sizes); ++b) {
+      if(buf_sizes[b] > sizeof(buf)) continue;
+      lseek(fd, 0, SEEK_SET);
+      memset(result, 0, pieces * SHA256_HASHBYTES);
+      if(lsx_sha256_pieces_fd(fd, piece_bytes, 3, buf, buf_sizes[b], result,
+                              MAX_PIECES) != pieces
+         || check("file", piece_bytes, 3, pieces)) {
+        fprintf(stderr, "(buffer size %u)\n", (unsigned)buf_sizes[b]);
+        fclose(f);
+        return 1;
+      }
+    }
+    if(pieces > 1) {
+      lseek(fd, 0, SEEK_SET);
+      if(lsx_sha256_pieces_fd(fd, piece_bytes, 1, buf, sizeof(buf), result,
+                              pieces - 1) != (size_t)-1) {
+        fprintf(stderr, "SHA-256 pieces overflowed its output!\n");
+        fclose(f);
+        return 1;
+      }
+    }
+  }
+  fclose(f);
+  if(lsx_sha256_pieces_fd(-1, 64, 1, buf, sizeof(buf), result, MAX_PIECES)
+     != (size_t)-1) {
+    fprintf(stderr, "SHA-256 pieces ignored a read error!\n");
+    return 1;
+  }
+  if(lsx_sha256_pieces_fd(0, 64, 1, buf, 63, result, MAX_PIECES)
+     != (size_t)-1) {
+    fprintf(stderr, "SHA-256 pieces accepted too small a buffer!\n");
+    return 1;
+  }
+  return 0;
+}
+
+/* Feed pieces in a scrambled order, some twice, stopping halfway to save
+   and resume */
+static int test_context() {
+  static uint8_t done[LSX_SHA256_PIECES_DONE_BYTES(MAX_PIECES)];
+  static const size_t sizes[] = {1, 100, 4096};
+  for(unsigned s = 0; s < elementcount(sizes); ++s) {
+    const size_t piece_bytes = sizes[s], bytes = sizeof(big_message) - 33;
+    size_t pieces = reference_pieces(bytes, piece_bytes), fed = 0;
+    lsx_sha256_pieces_context ctx;
+    uint32_t seed = 0xC0FFEE;
+    memset(result, 0, sizeof(result));
+    if(!lsx_setup_sha256_pieces(&ctx, result, done, bytes, piece_bytes)
+       || ctx.pieces != pieces || ctx.remaining != pieces) {
+      fprintf(stderr, "SHA-256 pieces context setup failed!\n");
+      return 1;
+    }
+    if(s % 2) lsx_set_sha256_pieces_policy(&ctx, LSX_POLICY_PUBLIC);
+    while(ctx.remaining > 0) {
+      size_t indices[11];
+      const void* data[11];
+      unsigned count;
+      seed = seed * 1103515245 + 12345;
+      count = (seed >> 16) % elementcount(indices) + 1;
+      for(unsigned i = 0; i < count; ++i) {
+        seed = seed * 1103515245 + 12345;
+        /* mostly pieces that aren't done yet, so this finishes */
+        size_t index = (size_t)(seed >> 8) % pieces;
+        while(i % 3 != 2 && lsx_sha256_piece_done(&ctx, index)
+              && index + 1 < pieces)
+          ++index;
+        indices[i] = index;
+        data[i] = big_message + index * piece_bytes;
+      }
+      if(count == 1) {
+        if(!lsx_input_sha256_piece(&ctx, indices[0], data[0],
+                                   lsx_sha256_piece_bytes(&ctx, indices[0])))
+        {
+          fprintf(stderr, "SHA-256 pieces refused a good piece!\n");
+          return 1;
+        }
+      }
+      else if(lsx_input_sha256_pieces(&ctx, indices, data, count) != count) {
+        fprintf(stderr, "SHA-256 pieces refused good pieces!\n");
+        return 1;
+      }
+      /* sweep up stragglers now and then */
+      if(ctx.remaining < 4) {
+        for(size_t n = 0; n < pieces; ++n)
+          if(!lsx_sha256_piece_done(&ctx, n))
+            lsx_input_sha256_piece(&ctx, n, big_message + n * piece_bytes,
+                                   lsx_sha256_piece_bytes(&ctx, n));
+      }
+      if(++fed == 20) {
+        size_t remaining = ctx.remaining;
+        if(!lsx_resume_sha256_pieces(&ctx, result, done, bytes, piece_bytes)
+           || ctx.remaining != remaining) {
+          fprintf(stderr, "SHA-256 pieces context resume failed!\n");
+          return 1;
+        }
+      }
+    }
+    if(check("context", piece_bytes, 1, pieces)) return 1;
+    /* bad pieces are refused */
+    {
+      size_t indices[2] = {pieces, 0};
+      const void* data[2] = {big_message, big_message};
+      size_t last = pieces - 1;
+      if(lsx_input_sha256_piece(&ctx, pieces, big_message, piece_bytes)
+         || (bytes % piece_bytes
+             && lsx_input_sha256_piece(&ctx, last,
+                                       big_message + last * piece_bytes,
+                                       piece_bytes))
+         || lsx_sha256_piece_bytes(&ctx, pieces) != 0
+         || lsx_input_sha256_pieces(&ctx, indices, data, 2) != 1) {
+        fprintf(stderr, "SHA-256 pieces accepted a bad piece!\n");
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+static int test_limits() {
+  uint8_t hash[1][SHA256_HASHBYTES];
+  uint8_t done[1];
+  lsx_sha256_pieces_context ctx;
+  if(lsx_sha256_pieces("abc", 3, 0, 1, hash)
+     || lsx_setup_sha256_pieces(&ctx, hash, done, 3, 0)) {
+    fprintf(stderr, "SHA-256 pieces accepted a piece size of zero!\n");
+    return 1;
+  }
+  if(!lsx_sha256_pieces("", 0, 64, 1, hash)
+     || !lsx_setup_sha256_pieces(&ctx, hash, done, 0, 64)
+     || ctx.pieces != 0 || ctx.remaining != 0) {
+    fprintf(stderr, "SHA-256 pieces mishandled an empty buffer!\n");
+    return 1;
+  }
+  if(lsx_setup_sha256_pieces(&ctx, hash, done, UINT64_MAX, 1)) {
+    fprintf(stderr, "SHA-256 pieces accepted too many pieces!\n");
+    return 1;
+  }
+  return 0;
+}
+
+static int test_kernel() {
+  return test_buffer() || test_fd() || test_context();
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  int ret = 0;
+  plain();
+  fill_pseudorandom(big_message, sizeof(big_message), 0x12345678);
+  ret = ret || test_limits();
+  /* pieces go through the multi-buffer kernels, so try all of them */
+  ret = for_each_sha256_many_impl(test_kernel) || ret;
+  return ret;
+}
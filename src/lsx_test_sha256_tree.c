@@ -0,0 +1,140 @@
+#include "lsx.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lsx_test_common.h"
+
+static const struct known_answer {
+  const char* message; /* NULL means `bytes` copies of 'a' */
+  size_t bytes, leaf_bytes;
+  uint8_t hash[SHA256_HASHBYTES];
+} known_answers[] = {
+  /* Answers of my own, checked against a separate implementation */
+  {"", 0, 1024, {0x46,0xe0,0x69,0x50,0xb7,0xe6,0x63,0xea,0xc2,0xfc,0x4c,0x04,0x47,0x7b,0xee,0xae,0x8b,0xc6,0x3e,0xf4,0xf4,0x63,0xcf,0xd2,0x33,0x82,0x12,0x15,0xdc,0x5d,0x7b,0x44}},
+  {"abc", 3, 1024, {0x8b,0x31,0x2d,0xca,0x23,0xaa,0x04,0xbe,0x1b,0x07,0x40,0x1c,0x8d,0x77,0x8f,0x3f,0xbb,0x36,0x82,0xa5,0x42,0x15,0xb1,0x0c,0xd1,0x17,0x33,0xbf,0x88,0xd3,0x9c,0x48}},
+  {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56, 16, {0xf7,0x60,0x29,0x94,0x10,0x39,0xad,0x01,0x8d,0x7e,0x3c,0xf5,0xce,0x7d,0x4d,0x88,0x56,0x98,0xb0,0x3b,0xab,0x9c,0x10,0xeb,0x75,0xfb,0xc0,0x71,0x20,0x48,0xfb,0x70}},
+  {NULL, 1000, 64, {0x2f,0x5b,0x03,0x2d,0x5d,0xc2,0xec,0xc6,0xde,0x27,0x7d,0xa2,0xbe,0x8b,0x5a,0xca,0xd9,0xc1,0xf7,0x3b,0x17,0x96,0x22,0xcf,0x4f,0x9e,0xac,0xbe,0xe3,0xa4,0x16,0xb2}},
+};
+
+static const unsigned thread_counts[] = {0, 1, 2, 3, 8, 64, 1000};
+
+/* Enough 64-byte leaves to need groups of more than one SIMD batch */
+static uint8_t big_message[SHA256_BLOCKBYTES * 3000 + 17];
+static const size_t big_leaf_sizes[] = {64, 100, 4096, 65536,
+                                        sizeof(big_message)};
+
+/* The format as README.md spells it out, the slow way */
+static void reference_root(const uint8_t* message, size_t bytes,
+                           size_t leaf_bytes, size_t first, size_t count,
+                           uint8_t out[SHA256_HASHBYTES]) {
+  if(count == 1) {
+    size_t start = first * leaf_bytes;
+    size_t len = bytes - start < leaf_bytes ? bytes - start : leaf_bytes;
+    lsx_calculate_sha256(message + start, len, out);
+  }
+  else {
+    uint8_t pair[SHA256_BLOCKBYTES];
+    size_t k = 1;
+    while(k * 2 < count) k *= 2;
+    reference_root(message, bytes, leaf_bytes, first, k, pair);
+    reference_root(message, bytes, leaf_bytes, first + k, count - k,
+                   pair + SHA256_HASHBYTES);
+    lsx_calculate_sha256(pair, sizeof(pair), out);
+  }
+}
+
+static void reference_tree(const uint8_t* message, size_t bytes,
+                           size_t leaf_bytes, uint8_t out[SHA256_HASHBYTES]) {
+  uint8_t final[SHA256_BLOCKBYTES];
+  size_t leaves = (bytes + leaf_bytes - 1) / leaf_bytes;
+  memcpy(final, "LSX-SHA256-TREE\x01", 16);
+  for(unsigned i = 0; i < 8; ++i) {
+    final[16 + i] = (uint8_t)((uint64_t)leaf_bytes >> (56 - i * 8));
+    final[24 + i] = (uint8_t)((uint64_t)bytes >> (56 - i * 8));
+  }
+  reference_root(message, bytes, leaf_bytes, 0, leaves ? leaves : 1,
+                 final + 32);
+  lsx_calculate_sha256(final, sizeof(final), out);
+}
+
+static int check(const char* what, unsigned n, unsigned threads,
+                 const uint8_t* known, const uint8_t* result) {
+  if(memcmp(known, result, SHA256_HASHBYTES)) {
+    fprintf(stderr, "SHA-256 tree %s %u (%u threads) failed!\n", what, n,
+            threads);
+    fprintf(stderr, "datum | kn | re\n");
+    for(unsigned i = 0; i < SHA256_HASHBYTES; ++i) {
+      output_datum("h[%2u] | %02X | %02X\n", i, known[i], result[i]);
+    }
+    return 1;
+  }
+  return 0;
+}
+
+static int test_known() {
+  uint8_t a_message[1000];
+  memset(a_message, 'a', sizeof(a_message));
+  for(unsigned n = 0; n < elementcount(known_answers); ++n) {
+    const struct known_answer* el = known_answers + n;
+    const void* message = el->message ? (const void*)el->message : a_message;
+    for(unsigned t = 0; t < elementcount(thread_counts); ++t) {
+      uint8_t hash[SHA256_HASHBYTES];
+      /* the policy mustn't change the answer */
+      if(!lsx_calculate_sha256_tree_policy(message, el->bytes, el->leaf_bytes,
+                                           thread_counts[t],
+                                           t % 2 ? LSX_POLICY_PUBLIC
+                                           : LSX_POLICY_SECRET, hash)) {
+        fprintf(stderr, "SHA-256 tree known answer %u refused!\n", n);
+        return 1;
+      }
+      if(check("known answer", n, thread_counts[t], el->hash, hash))
+        return 1;
+    }
+  }
+  return 0;
+}
+
+static int test_big() {
+  for(unsigned n = 0; n < elementcount(big_leaf_sizes); ++n) {
+    uint8_t known[SHA256_HASHBYTES];
+    /* a few lengths, so the last leaf is sometimes short */
+    for(size_t bytes = sizeof(big_message) - 150; bytes <= sizeof(big_message);
+        bytes += 50) {
+      reference_tree(big_message, bytes, big_leaf_sizes[n], known);
+      for(unsigned t = 0; t < elementcount(thread_counts); ++t) {
+        uint8_t hash[SHA256_HASHBYTES];
+        lsx_calculate_sha256_tree(big_message, bytes, big_leaf_sizes[n],
+                                  thread_counts[t], hash);
+        if(check("big message, leaf size", (unsigned)big_leaf_sizes[n],
+                 thread_counts[t], known, hash))
+          return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+static int test_limits() {
+  uint8_t hash[SHA256_HASHBYTES];
+  if(lsx_calculate_sha256_tree("abc", 3, 0, 1, hash)) {
+    fprintf(stderr, "SHA-256 tree accepted a leaf size of zero!\n");
+    return 1;
+  }
+  return 0;
+}
+
+static int test_kernel() {
+  return test_known() || test_big();
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  int ret = 0;
+  plain();
+  fill_pseudorandom(big_message, sizeof(big_message), 0x12345678);
+  ret = ret || test_limits();
+  /* leaves go through the multi-buffer kernels, so try all of them */
+  ret = for_each_sha256_many_impl(test_kernel) || ret;
+  return ret;
+}
@@ -0,0 +1,129 @@
+#include "lsx.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h> /* offsetof */
+
+#include "lsx_test_common.h"
+
+static const struct known_answer {
+  const void* message;
+  size_t msglen;
+  uint8_t answer512[SHA512_HASHBYTES];
+  uint8_t answer384[SHA384_HASHBYTES];
+  uint8_t answer512_256[SHA512_256_HASHBYTES];
+} known_answers[] = {
+#define KNOWN_ANSWER_STRING(str) str, sizeof(str)-1
+  {KNOWN_ANSWER_STRING(""),
+    {0xcf,0x83,0xe1,0x35,0x7e,0xef,0xb8,0xbd,0xf1,0x54,0x28,0x50,0xd6,0x6d,0x80,0x07,0xd6,0x20,0xe4,0x05,0x0b,0x57,0x15,0xdc,0x83,0xf4,0xa9,0x21,0xd3,0x6c,0xe9,0xce,0x47,0xd0,0xd1,0x3c,0x5d,0x85,0xf2,0xb0,0xff,0x83,0x18,0xd2,0x87,0x7e,0xec,0x2f,0x63,0xb9,0x31,0xbd,0x47,0x41,0x7a,0x81,0xa5,0x38,0x32,0x7a,0xf9,0x27,0xda,0x3e},
+    {0x38,0xb0,0x60,0xa7,0x51,0xac,0x96,0x38,0x4c,0xd9,0x32,0x7e,0xb1,0xb1,0xe3,0x6a,0x21,0xfd,0xb7,0x11,0x14,0xbe,0x07,0x43,0x4c,0x0c,0xc7,0xbf,0x63,0xf6,0xe1,0xda,0x27,0x4e,0xde,0xbf,0xe7,0x6f,0x65,0xfb,0xd5,0x1a,0xd2,0xf1,0x48,0x98,0xb9,0x5b},
+    {0xc6,0x72,0xb8,0xd1,0xef,0x56,0xed,0x28,0xab,0x87,0xc3,0x62,0x2c,0x51,0x14,0x06,0x9b,0xdd,0x3a,0xd7,0xb8,0xf9,0x73,0x74,0x98,0xd0,0xc0,0x1e,0xce,0xf0,0x96,0x7a}},
+  {KNOWN_ANSWER_STRING("abc"),
+    {0xdd,0xaf,0x35,0xa1,0x93,0x61,0x7a,0xba,0xcc,0x41,0x73,0x49,0xae,0x20,0x41,0x31,0x12,0xe6,0xfa,0x4e,0x89,0xa9,0x7e,0xa2,0x0a,0x9e,0xee,0xe6,0x4b,0x55,0xd3,0x9a,0x21,0x92,0x99,0x2a,0x27,0x4f,0xc1,0xa8,0x36,0xba,0x3c,0x23,0xa3,0xfe,0xeb,0xbd,0x45,0x4d,0x44,0x23,0x64,0x3c,0xe8,0x0e,0x2a,0x9a,0xc9,0x4f,0xa5,0x4c,0xa4,0x9f},
+    {0xcb,0x00,0x75,0x3f,0x45,0xa3,0x5e,0x8b,0xb5,0xa0,0x3d,0x69,0x9a,0xc6,0x50,0x07,0x27,0x2c,0x32,0xab,0x0e,0xde,0xd1,0x63,0x1a,0x8b,0x60,0x5a,0x43,0xff,0x5b,0xed,0x80,0x86,0x07,0x2b,0xa1,0xe7,0xcc,0x23,0x58,0xba,0xec,0xa1,0x34,0xc8,0x25,0xa7},
+    {0x53,0x04,0x8e,0x26,0x81,0x94,0x1e,0xf9,0x9b,0x2e,0x29,0xb7,0x6b,0x4c,0x7d,0xab,0xe4,0xc2,0xd0,0xc6,0x34,0xfc,0x6d,0x46,0xe0,0xe2,0xf1,0x31,0x07,0xe7,0xaf,0x23}},
+  {KNOWN_ANSWER_STRING("The quick brown fox jumps over the lazy dog"),
+    {0x07,0xe5,0x47,0xd9,0x58,0x6f,0x6a,0x73,0xf7,0x3f,0xba,0xc0,0x43,0x5e,0xd7,0x69,0x51,0x21,0x8f,0xb7,0xd0,0xc8,0xd7,0x88,0xa3,0x09,0xd7,0x85,0x43,0x6b,0xbb,0x64,0x2e,0x93,0xa2,0x52,0xa9,0x54,0xf2,0x39,0x12,0x54,0x7d,0x1e,0x8a,0x3b,0x5e,0xd6,0xe1,0xbf,0xd7,0x09,0x78,0x21,0x23,0x3f,0xa0,0x53,0x8f,0x3d,0xb8,0x54,0xfe,0xe6},
+    {0xca,0x73,0x7f,0x10,0x14,0xa4,0x8f,0x4c,0x0b,0x6d,0xd4,0x3c,0xb1,0x77,0xb0,0xaf,0xd9,0xe5,0x16,0x93,0x67,0x54,0x4c,0x49,0x40,0x11,0xe3,0x31,0x7d,0xbf,0x9a,0x50,0x9c,0xb1,0xe5,0xdc,0x1e,0x85,0xa9,0x41,0xbb,0xee,0x3d,0x7f,0x2a,0xfb,0xc9,0xb1},
+    {0xdd,0x9d,0x67,0xb3,0x71,0x51,0x9c,0x33,0x9e,0xd8,0xdb,0xd2,0x5a,0xf9,0x0e,0x97,0x6a,0x1e,0xee,0xfd,0x4a,0xd3,0xd8,0x89,0x00,0x5e,0x53,0x2f,0xc5,0xbe,0xf0,0x4d}},
+  {KNOWN_ANSWER_STRING("This string has exactly 111 characters, and is padded out with dots............................................"),
+    {0x40,0xd5,0x23,0x21,0x22,0x20,0x31,0x31,0x0f,0x1f,0x44,0xac,0x76,0xc0,0x55,0x1d,0xc0,0x0a,0x97,0xeb,0x32,0x06,0x4a,0x9c,0xce,0xd9,0x31,0x84,0x3b,0xbb,0xb2,0xcc,0x1c,0xc7,0xa3,0x6c,0xdb,0xed,0x52,0xb0,0x0e,0xb9,0x56,0xf1,0x23,0x90,0x38,0x65,0x48,0xd7,0x0e,0xbc,0xa9,0xc6,0x6f,0x7e,0xdf,0x49,0x9f,0xe2,0xa8,0x9f,0x55,0x9b},
+    {0x26,0x50,0xf6,0x70,0xca,0xe3,0xb3,0x06,0x3a,0x00,0x40,0x60,0xdc,0x3a,0xa1,0xae,0xe1,0x2a,0x0b,0xad,0x42,0x75,0x0a,0x50,0xc6,0x56,0x0a,0x68,0xfa,0x6b,0x8a,0x8c,0x72,0xed,0xae,0x6d,0xac,0xe2,0xca,0xa5,0x62,0x4f,0xfb,0xa8,0xd5,0x5b,0x1f,0x8b},
+    {0x17,0x5c,0x29,0x50,0x6e,0xee,0x76,0x76,0x72,0xc9,0xdf,0x9e,0x83,0xb5,0x9d,0x0b,0xeb,0xae,0x03,0x4b,0x3b,0x04,0x2e,0xef,0x8d,0x73,0xff,0xd5,0xea,0x80,0xcd,0xbf}},
+  {KNOWN_ANSWER_STRING("This string has exactly 112 characters, and is padded out with dots............................................."),
+    {0x97,0xd7,0x74,0xa0,0xc5,0xa8,0xc2,0x6d,0xd0,0x11,0x9f,0x00,0x10,0xd4,0x55,0xcd,0xea,0xd3,0xef,0x6c,0x89,0xd7,0xa1,0x88,0x29,0xdc,0x7e,0x08,0xc9,0x10,0x90,0xd7,0x1e,0x28,0x84,0xf8,0x88,0x8c,0xba,0x5d,0x9b,0xd1,0x49,0xec,0x80,0x54,0x91,0xb7,0x0d,0x76,0x8a,0x5e,0x03,0x63,0xe8,0x28,0x85,0x6d,0x53,0x9f,0x2d,0x27,0xc7,0x3c},
+    {0x0c,0x71,0x86,0xe0,0x6a,0x6d,0xaf,0x60,0x19,0x3d,0x3e,0xbc,0xd7,0xf6,0xf6,0xd3,0x25,0x6c,0x16,0x73,0xbb,0x92,0x3f,0x34,0xd9,0x82,0xac,0x86,0x32,0x33,0x54,0x25,0xd7,0xa9,0xaf,0x77,0x52,0xa0,0x48,0x06,0xa8,0xc9,0x4b,0x78,0x29,0xce,0x8b,0xf7},
+    {0x13,0x17,0x2b,0x9b,0x31,0xe3,0x6d,0x8e,0x9d,0x10,0xc3,0x0a,0xd7,0xb4,0xf2,0x7d,0x49,0xf6,0xeb,0x60,0x2a,0x66,0x1a,0xad,0xca,0x2b,0xe6,0xcc,0x12,0xa3,0xa4,0x07}},
+  {KNOWN_ANSWER_STRING("This string has exactly 128 characters, and is padded out with dots............................................................."),
+    {0x71,0x9f,0xd7,0x29,0x94,0xe9,0x72,0x30,0x3a,0x73,0x29,0x81,0x06,0xed,0x75,0xb1,0x7b,0x89,0x09,0x64,0x2d,0xce,0x0b,0xac,0x60,0x2a,0xa9,0xb8,0xb6,0x25,0x0e,0xd9,0xd8,0x5c,0x56,0xde,0xc0,0xda,0x97,0x91,0x71,0xd1,0xba,0x9a,0xbf,0xd6,0x18,0x74,0x84,0x13,0xc2,0xe4,0xcd,0x29,0xeb,0x26,0x79,0x46,0xb8,0x1d,0x2b,0x7e,0x47,0x79},
+    {0x22,0xb8,0x2d,0x1c,0x4e,0x13,0x5d,0x31,0x46,0x18,0x3a,0x9f,0x83,0x8f,0x87,0x45,0x3a,0xd9,0xe6,0x56,0xd8,0x72,0x61,0x53,0xb7,0xb3,0x83,0xef,0x0d,0x9a,0x45,0x44,0x5e,0x6d,0x55,0xa2,0x51,0x87,0x08,0x00,0x0c,0xfb,0xf7,0xb6,0x98,0x85,0x33,0x75},
+    {0x59,0x67,0xbb,0x75,0x75,0xc7,0x6f,0x28,0xc0,0xd5,0x74,0xfd,0x13,0x61,0xed,0xf9,0x60,0xf0,0xc3,0x16,0xed,0x30,0x04,0x2d,0x5a,0x68,0x19,0xd2,0x5e,0x1a,0xf3,0x98}},
+  {KNOWN_ANSWER_STRING("This string has exactly 240 characters, and is padded out with dots............................................................................................................................................................................."),
+    {0xfb,0xa8,0x4c,0x3f,0x27,0x8d,0xc0,0xef,0x80,0xf2,0xbe,0x95,0xa8,0xc1,0x0a,0xd4,0x11,0x31,0x7d,0xfe,0x71,0x2d,0xec,0x1a,0x39,0x05,0x59,0x30,0x77,0x2c,0x09,0x67,0x1e,0x8c,0x5a,0xba,0x50,0x4e,0x3c,0xe1,0x8f,0x96,0x5f,0xb2,0xab,0x80,0x0c,0xef,0x43,0x26,0xbf,0xd2,0xcf,0xb0,0x0c,0xe9,0x6e,0xd2,0x27,0x6e,0x90,0xdb,0xe1,0xa6},
+    {0x51,0x40,0x6c,0xf7,0x51,0x28,0x71,0xae,0x81,0x77,0xc9,0xcd,0x5b,0x07,0x4f,0xaf,0x0b,0x2c,0xf3,0x49,0xbb,0x05,0xd1,0x39,0x72,0x79,0x80,0xd3,0x27,0x93,0xe2,0xa9,0xa9,0xba,0x5d,0x84,0x7b,0x51,0x44,0xd5,0x7e,0xa9,0x8e,0x0d,0x98,0x06,0x31,0x21},
+    {0x3f,0x51,0x72,0x3f,0x20,0x28,0xf1,0x57,0x6c,0x14,0x16,0xe1,0x4b,0xd0,0x0a,0x38,0xeb,0x64,0x1d,0x14,0x0a,0x77,0xdf,0x89,0x5b,0xc0,0x77,0x1c,0x38,0xe0,0xfb,0x64}},
+  {KNOWN_ANSWER_STRING("Lorem ipsum dolor sit amet, consectetur adipisicing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat. Duis aute irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla pariatur. Excepteur sint occaecat cupidatat non proident, sunt in culpa qui officia deserunt mollit anim id est laborum."),
+    {0xf4,0x1d,0x92,0xbc,0x9f,0xc1,0x15,0x7a,0x0d,0x13,0x87,0xe6,0x7f,0x3d,0x08,0x93,0xb7,0x0f,0x70,0x39,0xd3,0xd4,0x6d,0x81,0x15,0xb5,0x07,0x9d,0x45,0xad,0x60,0x11,0x59,0x39,0x8c,0x79,0xc2,0x81,0x68,0x1e,0x2d,0xa0,0x9b,0xf7,0xd9,0xf8,0xc2,0x3b,0x41,0xd1,0xa0,0xa3,0xc5,0xb5,0x28,0xa7,0xf2,0x73,0x59,0x33,0xa4,0x35,0x31,0x94},
+    {0x63,0x98,0x0f,0xd0,0x42,0x5c,0xd2,0xc3,0xd8,0xa4,0x00,0xee,0x0f,0x26,0x71,0xef,0x13,0x5d,0xb0,0x3b,0x94,0x7e,0xc1,0xaf,0x21,0xb6,0xe2,0x8f,0x19,0xc1,0x6c,0xa2,0x72,0x03,0x64,0x69,0x54,0x1f,0x4d,0x8e,0x33,0x6a,0xc6,0xd1,0xda,0x50,0x58,0x0f},
+    {0x94,0x23,0xe3,0x86,0x3e,0xbb,0x6f,0x22,0xb9,0x46,0x4a,0xeb,0x87,0x3a,0x39,0xd7,0x57,0xef,0x6b,0x6a,0x87,0xc4,0xbc,0x55,0x64,0x2f,0x69,0x05,0x27,0x41,0xfc,0x43}},
+};
+
+static const struct variant {
+  const char* name;
+  void(*setup_func)(lsx_sha512_context* ctx);
+  void(*calculate_func)(const void* message, size_t bytes, uint8_t* out);
+  size_t answer_offset;
+  unsigned hash_bytes;
+} variants[] = {
+  {"SHA-512", lsx_setup_sha512, lsx_calculate_sha512,
+   offsetof(struct known_answer, answer512), SHA512_HASHBYTES},
+  {"SHA-384", lsx_setup_sha384, lsx_calculate_sha384,
+   offsetof(struct known_answer, answer384), SHA384_HASHBYTES},
+  {"SHA-512/256", lsx_setup_sha512_256, lsx_calculate_sha512_256,
+   offsetof(struct known_answer, answer512_256), SHA512_256_HASHBYTES},
+};
+
+static int check(const struct variant* var, const struct known_answer* el,
+                 const uint8_t* hash, const char* how, unsigned n) {
+  const uint8_t* answer = (const uint8_t*)el + var->answer_offset;
+  if(!memcmp(hash, answer, var->hash_bytes)) return 0;
+  fprintf(stderr, "%s (%s) known answer %u failed!\n", var->name, how, n);
+  fprintf(stderr, "datum | kn | re\n");
+  for(unsigned i = 0; i < var->hash_bytes; ++i) {
+    output_datum("h[%2u] | %02X | %02X\n", i, answer[i], hash[i]);
+  }
+  plain();
+  return 1;
+}
+
+static int test_easyish(const struct variant* var, unsigned count,
+                        int policy) {
+  int ret = 0;
+  for(unsigned n = 0; n < elementcount(known_answers); ++n) {
+    const struct known_answer* el = known_answers + n;
+    uint8_t hash[SHA512_HASHBYTES];
+    lsx_sha512_context ctx;
+    var->setup_func(&ctx);
+    lsx_set_sha512_policy(&ctx, policy);
+    const uint8_t* p = el->message;
+    size_t rem = el->msglen;
+    while(rem >= count) {
+      lsx_input_sha512(&ctx, p, count);
+      p += count; rem -= count;
+    }
+    if(rem > 0) lsx_input_sha512(&ctx, p, rem);
+    lsx_finish_sha512(&ctx, hash);
+    lsx_destroy_sha512(&ctx);
+    if(check(var, el, hash,
+             policy == LSX_POLICY_PUBLIC ? "easy, public" : "easy", n))
+      ret = 1;
+  }
+  return ret;
+}
+
+int main(int argc, char* argv[]) {
+  (void)argc; (void)argv;
+  int ret = 0;
+  plain();
+  for(unsigned v = 0; v < elementcount(variants); ++v) {
+    const struct variant* var = variants + v;
+    /* test the easiest interface */
+    for(unsigned n = 0; n < elementcount(known_answers); ++n) {
+      const struct known_answer* el = known_answers + n;
+      uint8_t hash[SHA512_HASHBYTES];
+      var->calculate_func(el->message, el->msglen, hash);
+      if(check(var, el, hash, "lazy", n)) ret = 1;
+    }
+    /* test the easyish interface with various byte increments */
+    ret = ret || test_easyish(var, 1, LSX_POLICY_SECRET);
+    ret = ret || test_easyish(var, 3, LSX_POLICY_SECRET);
+    ret = ret || test_easyish(var, 7, LSX_POLICY_SECRET);
+    ret = ret || test_easyish(var, 64, LSX_POLICY_SECRET);
+    ret = ret || test_easyish(var, 128, LSX_POLICY_SECRET);
+    ret = ret || test_easyish(var, 131, LSX_POLICY_SECRET);
+    /* skipping the wipes mustn't change any answers */
+    ret = ret || test_easyish(var, 3, LSX_POLICY_PUBLIC);
+    ret = ret || test_easyish(var, 131, LSX_POLICY_PUBLIC);
+  }
+  return ret;
+}
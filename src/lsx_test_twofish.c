@@ -5,6 +5,7 @@
 #include "lsx.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "gpg_twofish_tables.h"
@@ -137,6 +138,171 @@ static const struct ecb_tbl_entry {
   },
 };
 
+/* The modes of operation, against the same thing done a block at a time */
+#define MODE_BLOCKS 40
+static void reference_counter(const uint8_t nonce[16], uint64_t n,
+                              uint8_t out[16]) {
+  /* plain schoolbook addition, the low eight bytes and then the carry */
+  uint64_t lo = 0, hi = 0;
+  for(int i = 0; i < 8; ++i) {
+    hi = hi << 8 | nonce[i];
+    lo = lo << 8 | nonce[i+8];
+  }
+  if(lo + n < lo) ++hi;
+  lo += n;
+  for(int i = 7; i >= 0; --i) {
+    out[i] = (uint8_t)hi; hi >>= 8;
+    out[i+8] = (uint8_t)lo; lo >>= 8;
+  }
+}
+
+static int test_modes(const struct ecb_ival_entry* key) {
+  static const uint8_t nonces[][16] = {
+    {0},
+    {1,2,3,4,5,6,7,8,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xF0},
+    {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+     0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFE},
+  };
+  lsx_twofish_context ctx;
+  uint8_t pt[MODE_BLOCKS*16], known[MODE_BLOCKS*16], ours[MODE_BLOCKS*16];
+  uint8_t iv[16], iv2[16];
+  key->setup_func(&ctx, key->in_key);
+  for(unsigned i = 0; i < sizeof(pt); ++i) pt[i] = (uint8_t)(i * 131 + 7);
+  for(size_t blocks = 0; blocks <= MODE_BLOCKS; ++blocks) {
+    /* ECB, out of place and in place */
+    for(size_t n = 0; n < blocks; ++n)
+      lsx_encrypt_twofish(&ctx, pt + n*16, known + n*16);
+    lsx_twofish_ecb_encrypt(&ctx, pt, ours, blocks);
+    if(memcmp(known, ours, blocks*16)) goto ecb_failed;
+    lsx_twofish_ecb_decrypt(&ctx, ours, ours, blocks);
+    if(memcmp(pt, ours, blocks*16)) goto ecb_failed;
+    /* CBC, in one call and then split in two */
+    memset(iv, 0xA5, 16);
+    for(size_t n = 0; n < blocks; ++n) {
+      for(int i = 0; i < 16; ++i) iv[i] ^= pt[n*16+i];
+      lsx_encrypt_twofish(&ctx, iv, iv);
+      memcpy(known + n*16, iv, 16);
+    }
+    memset(iv, 0xA5, 16);
+    lsx_twofish_cbc_encrypt(&ctx, iv, pt, ours, blocks / 3);
+    lsx_twofish_cbc_encrypt(&ctx, iv, pt + blocks / 3 * 16,
+                            ours + blocks / 3 * 16, blocks - blocks / 3);
+    if(memcmp(known, ours, blocks*16)
+       || (blocks && memcmp(iv, known + (blocks-1)*16, 16)))
+      goto cbc_failed;
+    memset(iv2, 0xA5, 16);
+    lsx_twofish_cbc_decrypt(&ctx, iv2, ours, ours, blocks - blocks / 3);
+    lsx_twofish_cbc_decrypt(&ctx, iv2, ours + (blocks - blocks / 3) * 16,
+                            ours + (blocks - blocks / 3) * 16, blocks / 3);
+    if(memcmp(pt, ours, blocks*16) || memcmp(iv, iv2, 16)) goto cbc_failed;
+  }
+  /* CTR, for every length, and across every kind of carry */
+  for(unsigned k = 0; k < elementcount(nonces); ++k) {
+    for(size_t n = 0; n < MODE_BLOCKS; ++n) {
+      reference_counter(nonces[k], n + 5, known + n*16);
+      lsx_encrypt_twofish(&ctx, known + n*16, known + n*16);
+    }
+    for(size_t n = 0; n < sizeof(pt); ++n) known[n] ^= pt[n];
+    for(size_t bytes = 0; bytes <= sizeof(pt); ++bytes) {
+      memset(ours, 0, sizeof(ours));
+      lsx_twofish_ctr_xor(&ctx, nonces[k], 5, pt, ours, bytes);
+      if(memcmp(known, ours, bytes) || (bytes < sizeof(ours) && ours[bytes]))
+        goto ctr_failed;
+    }
+    /* in place, continued in a second call */
+    memcpy(ours, pt, sizeof(ours));
+    lsx_twofish_ctr_xor(&ctx, nonces[k], 5, ours, ours, 7 * 16);
+    lsx_twofish_ctr_xor(&ctx, nonces[k], 12, ours + 7 * 16, ours + 7 * 16,
+                        sizeof(ours) - 7 * 16);
+    if(memcmp(known, ours, sizeof(ours))) goto ctr_failed;
+  }
+  lsx_destroy_twofish(&ctx);
+  return 0;
+ ecb_failed:
+  fprintf(stderr, "ECB mode failed!\n");
+  goto failed;
+ cbc_failed:
+  fprintf(stderr, "CBC mode failed!\n");
+  goto failed;
+ ctr_failed:
+  fprintf(stderr, "CTR mode failed!\n");
+ failed:
+  lsx_destroy_twofish(&ctx);
+  return 1;
+}
+
+/* Threaded CTR, against serial CTR, for every way of splitting the work */
+#define PARALLEL_BYTES (20 * 4096 + 9)
+static int test_parallel_ctr(void) {
+  static const uint8_t key[TWOFISH256_KEYBYTES] = {0x42};
+  static const uint8_t nonce[16] = {
+    9,8,7,6,5,4,3,2,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x00,
+  };
+  static const unsigned thread_counts[] = {0, 1, 2, 3, 4, LSX_MAX_THREADS+1};
+  static const size_t span_sizes[] = {0, 1, 16, 100, 4096, PARALLEL_BYTES};
+  static const size_t lengths[] = {0, 15, 4096, PARALLEL_BYTES};
+  /* the second wraps the 64-bit counter partway through, which must carry
+     into the nonce */
+  static const uint64_t counters[] = {100, UINT64_MAX - 1};
+  lsx_twofish_context ctx;
+  uint8_t* pt = malloc(PARALLEL_BYTES);
+  uint8_t* known = malloc(PARALLEL_BYTES);
+  uint8_t* ours = malloc(PARALLEL_BYTES);
+  int ret = 0;
+  if(!pt || !known || !ours) {
+    fprintf(stderr, "Out of memory!\n");
+    ret = 1;
+    goto out;
+  }
+  lsx_setup_twofish256(&ctx, key);
+  for(size_t i = 0; i < PARALLEL_BYTES; ++i) pt[i] = (uint8_t)(i * 29 + 3);
+  for(unsigned c = 0; c < elementcount(counters) && !ret; ++c) {
+    lsx_twofish_ctr_xor(&ctx, nonce, counters[c], pt, known, PARALLEL_BYTES);
+    for(unsigned l = 0; l < elementcount(lengths) && !ret; ++l) {
+      for(unsigned t = 0; t < elementcount(thread_counts) && !ret; ++t) {
+        for(unsigned s = 0; s < elementcount(span_sizes) && !ret; ++s) {
+          memcpy(ours, pt, PARALLEL_BYTES);
+          lsx_twofish_ctr_xor_parallel(&ctx, nonce, counters[c], ours, ours,
+                                       lengths[l], thread_counts[t],
+                                       span_sizes[s]);
+          if(memcmp(known, ours, lengths[l])
+             || memcmp(pt + lengths[l], ours + lengths[l],
+                       PARALLEL_BYTES - lengths[l])) {
+            fprintf(stderr, "Parallel CTR mode failed! (counter %llu, %u"
+                    " bytes, %u threads, %u byte spans)\n",
+                    (unsigned long long)counters[c], (unsigned)lengths[l],
+                    thread_counts[t], (unsigned)span_sizes[s]);
+            ret = 1;
+          }
+        }
+      }
+    }
+  }
+  lsx_destroy_twofish(&ctx);
+ out:
+  free(pt);
+  free(known);
+  free(ours);
+  return ret;
+}
+
+/* the bulk modes, with every size of key */
+static int test_bulk(void) {
+  int ret = 0;
+  for(unsigned n = 0; n < elementcount(ecb_ival_entries); ++n) {
+    if(test_modes(ecb_ival_entries + n)) {
+      fprintf(stderr, "(the above failure was with the %s)\n",
+              ecb_ival_entries[n].who);
+      ret = 1;
+    }
+  }
+  return test_parallel_ctr() || ret;
+}
+
+static const char* const impl_names[] = {
+  "auto", "scalar", "AVX2", "AVX-512",
+};
+
 int main(int argc, char* argv[]) {
   (void)argc; (void)argv;
   int ret = 0;
@@ -232,6 +398,9 @@ int main(int argc, char* argv[]) {
     lsx_destroy_twofish(&ctx);
     ret = 1;
   }
+  /* every implementation of the bulk modes */
+  ret = for_each_impl(lsx_set_twofish_implementation, impl_names,
+                      "Twofish implementation", test_bulk) || ret;
   plain();
   return ret;
 }
@@ -0,0 +1,243 @@
+#include "lsx_thread.h"
+
+#if !defined(LSX_NO_THREADS) && defined(_WIN32)
+#include <windows.h>
+#define LSX_WIN32_THREADS 1
+#elif !defined(LSX_NO_THREADS)
+#include <pthread.h>
+#define LSX_POSIX_THREADS 1
+#endif
+
+struct parallel {
+  lsx_parallel_func func;
+  void* arg;
+  size_t next, count;
+#if LSX_WIN32_THREADS
+  CRITICAL_SECTION lock;
+#elif LSX_POSIX_THREADS
+  pthread_mutex_t lock;
+#endif
+};
+
+static int take_index(struct parallel* p, size_t* index) {
+  int ret;
+#if LSX_WIN32_THREADS
+  EnterCriticalSection(&p->lock);
+#elif LSX_POSIX_THREADS
+  pthread_mutex_lock(&p->lock);
+#endif
+  ret = p->next < p->count;
+  if(ret) *index = p->next++;
+#if LSX_WIN32_THREADS
+  LeaveCriticalSection(&p->lock);
+#elif LSX_POSIX_THREADS
+  pthread_mutex_unlock(&p->lock);
+#endif
+  return ret;
+}
+
+static void work(struct parallel* p) {
+  size_t index;
+  while(take_index(p, &index)) p->func(p->arg, index);
+}
+
+#if LSX_WIN32_THREADS
+static DWORD WINAPI worker(LPVOID p) {
+  work((struct parallel*)p);
+  return 0;
+}
+#elif LSX_POSIX_THREADS
+static void* worker(void* p) {
+  work((struct parallel*)p);
+  return NULL;
+}
+#endif
+
+void lsx_parallel_for(size_t count, unsigned threads,
+                      lsx_parallel_func func, void* arg) {
+  struct parallel p;
+#if LSX_WIN32_THREADS
+  HANDLE handles[LSX_MAX_THREADS - 1];
+#elif LSX_POSIX_THREADS
+  pthread_t handles[LSX_MAX_THREADS - 1];
+#endif
+  unsigned started = 0, n;
+  size_t index;
+  p.func = func;
+  p.arg = arg;
+  p.next = 0;
+  p.count = count;
+  if(threads > LSX_MAX_THREADS) threads = LSX_MAX_THREADS;
+  /* no point starting threads that would find nothing to do */
+  if(threads > count) threads = (unsigned)count;
+  if(threads <= 1) {
+    for(index = 0; index < count; ++index) func(arg, index);
+    return;
+  }
+#if LSX_WIN32_THREADS
+  InitializeCriticalSection(&p.lock);
+  for(n = 0; n < threads - 1; ++n) {
+    handles[started] = CreateThread(NULL, 0, worker, &p, 0, NULL);
+    if(handles[started] == NULL) break;
+    ++started;
+  }
+#elif LSX_POSIX_THREADS
+  if(pthread_mutex_init(&p.lock, NULL)) {
+    for(index = 0; index < count; ++index) func(arg, index);
+    return;
+  }
+  for(n = 0; n < threads - 1; ++n) {
+    if(pthread_create(&handles[started], NULL, worker, &p)) break;
+    ++started;
+  }
+#endif
+  work(&p);
+#if LSX_WIN32_THREADS
+  for(n = 0; n < started; ++n) {
+    WaitForSingleObject(handles[n], INFINITE);
+    CloseHandle(handles[n]);
+  }
+  DeleteCriticalSection(&p.lock);
+#elif LSX_POSIX_THREADS
+  for(n = 0; n < started; ++n) pthread_join(handles[n], NULL);
+  pthread_mutex_destroy(&p.lock);
+#endif
+  (void)n;
+  (void)started;
+}
+
+/* marks a buffer that's waiting to be filled */
+#define RELAY_EMPTY ((size_t)-2)
+
+struct relay {
+  void* const* bufs;
+  size_t bytes;
+  lsx_fill_func fill;
+  void* arg;
+  size_t filled[2];
+#if LSX_WIN32_THREADS
+  CRITICAL_SECTION lock;
+  CONDITION_VARIABLE cond;
+#elif LSX_POSIX_THREADS
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+#endif
+};
+
+static int take_turns(void* const bufs[2], size_t bytes, lsx_fill_func fill,
+                      lsx_drain_func drain, void* arg) {
+  size_t got;
+  while((got = fill(arg, bufs[0], bytes)) != 0) {
+    if(got == (size_t)-1) return 0;
+    drain(arg, bufs[0], got);
+  }
+  return 1;
+}
+
+#if LSX_WIN32_THREADS || LSX_POSIX_THREADS
+#if LSX_WIN32_THREADS
+#define relay_lock(r) EnterCriticalSection(&(r)->lock)
+#define relay_unlock(r) LeaveCriticalSection(&(r)->lock)
+#define relay_wait(r) SleepConditionVariableCS(&(r)->cond, &(r)->lock, \
+                                               INFINITE)
+#define relay_wake(r) WakeConditionVariable(&(r)->cond)
+#else
+#define relay_lock(r) pthread_mutex_lock(&(r)->lock)
+#define relay_unlock(r) pthread_mutex_unlock(&(r)->lock)
+#define relay_wait(r) pthread_cond_wait(&(r)->cond, &(r)->lock)
+#define relay_wake(r) pthread_cond_signal(&(r)->cond)
+#endif
+
+static void relay_fill(struct relay* r) {
+  unsigned i = 0;
+  size_t got;
+  do {
+    relay_lock(r);
+    while(r->filled[i] != RELAY_EMPTY) relay_wait(r);
+    relay_unlock(r);
+    got = r->fill(r->arg, r->bufs[i], r->bytes);
+    relay_lock(r);
+    r->filled[i] = got;
+    relay_wake(r);
+    relay_unlock(r);
+    i ^= 1;
+  } while(got != 0 && got != (size_t)-1);
+}
+
+#if LSX_WIN32_THREADS
+static DWORD WINAPI filler(LPVOID r) {
+  relay_fill((struct relay*)r);
+  return 0;
+}
+#else
+static void* filler(void* r) {
+  relay_fill((struct relay*)r);
+  return NULL;
+}
+#endif
+#endif
+
+int lsx_double_buffer(void* const bufs[2], size_t bytes,
+                      lsx_fill_func fill, lsx_drain_func drain, void* arg) {
+#if LSX_WIN32_THREADS || LSX_POSIX_THREADS
+  struct relay r;
+  unsigned i = 0;
+  size_t got;
+#if LSX_WIN32_THREADS
+  HANDLE handle;
+#else
+  pthread_t handle;
+#endif
+  r.bufs = bufs;
+  r.bytes = bytes;
+  r.fill = fill;
+  r.arg = arg;
+  r.filled[0] = r.filled[1] = RELAY_EMPTY;
+#if LSX_WIN32_THREADS
+  InitializeCriticalSection(&r.lock);
+  InitializeConditionVariable(&r.cond);
+  handle = CreateThread(NULL, 0, filler, &r, 0, NULL);
+  if(handle == NULL) {
+    DeleteCriticalSection(&r.lock);
+    return take_turns(bufs, bytes, fill, drain, arg);
+  }
+#else
+  if(pthread_mutex_init(&r.lock, NULL))
+    return take_turns(bufs, bytes, fill, drain, arg);
+  if(pthread_cond_init(&r.cond, NULL)) {
+    pthread_mutex_destroy(&r.lock);
+    return take_turns(bufs, bytes, fill, drain, arg);
+  }
+  if(pthread_create(&handle, NULL, filler, &r)) {
+    pthread_cond_destroy(&r.cond);
+    pthread_mutex_destroy(&r.lock);
+    return take_turns(bufs, bytes, fill, drain, arg);
+  }
+#endif
+  for(;;) {
+    relay_lock(&r);
+    while(r.filled[i] == RELAY_EMPTY) relay_wait(&r);
+    got = r.filled[i];
+    relay_unlock(&r);
+    if(got == 0 || got == (size_t)-1) break;
+    drain(arg, bufs[i], got);
+    relay_lock(&r);
+    r.filled[i] = RELAY_EMPTY;
+    relay_wake(&r);
+    relay_unlock(&r);
+    i ^= 1;
+  }
+#if LSX_WIN32_THREADS
+  WaitForSingleObject(handle, INFINITE);
+  CloseHandle(handle);
+  DeleteCriticalSection(&r.lock);
+#else
+  pthread_join(handle, NULL);
+  pthread_cond_destroy(&r.cond);
+  pthread_mutex_destroy(&r.lock);
+#endif
+  return got != (size_t)-1;
+#else
+  return take_turns(bufs, bytes, fill, drain, arg);
+#endif
+}
@@ -0,0 +1,292 @@
+/* Twofish kernels that use x86 instruction set extensions. Nothing in here is
+   called unless lsx_cpu_features() says the CPU can run it. Each one runs a
+   vector's worth of blocks through the rounds side by side, one block per
+   32-bit element, looking up the key-dependent S-boxes with gathers. */
+
+#include "lsx_twofish_kernels.h"
+
+#if LSX_X86
+
+#include <immintrin.h>
+
+/*** AVX2 ***/
+
+/* Transpose the 4x4 matrix of words in each 128-bit lane. Four vectors of
+   whole blocks become four vectors of word 0, 1, 2, and 3 of each block, and
+   vice versa. (Within each vector, the blocks end up in an odd order, but
+   it's the same order both ways.) */
+__attribute__((target("avx2")))
+static inline void transpose_avx2(__m256i* a, __m256i* b, __m256i* c,
+                                  __m256i* d) {
+  __m256i t0 = _mm256_unpacklo_epi32(*a, *b);
+  __m256i t1 = _mm256_unpackhi_epi32(*a, *b);
+  __m256i t2 = _mm256_unpacklo_epi32(*c, *d);
+  __m256i t3 = _mm256_unpackhi_epi32(*c, *d);
+  *a = _mm256_unpacklo_epi64(t0, t2);
+  *b = _mm256_unpackhi_epi64(t0, t2);
+  *c = _mm256_unpacklo_epi64(t1, t3);
+  *d = _mm256_unpackhi_epi64(t1, t3);
+}
+
+/* ctx->s[table][byte `shift` / 8 of each element of `x`] */
+#define lookup_avx2(ctx, table, x, shift) \
+  _mm256_i32gather_epi32((const int*)(ctx)->s[table], \
+                         _mm256_and_si256(_mm256_srli_epi32(x, shift), \
+                                          _mm256_set1_epi32(0xFF)), 4)
+
+/* g(x), and g(x <<< 8) without the rotate */
+__attribute__((target("avx2")))
+static inline __m256i g_avx2(lsx_twofish_context* ctx, __m256i x) {
+  return _mm256_xor_si256(_mm256_xor_si256(lookup_avx2(ctx, 0, x, 0),
+                                           lookup_avx2(ctx, 1, x, 8)),
+                          _mm256_xor_si256(lookup_avx2(ctx, 2, x, 16),
+                                           lookup_avx2(ctx, 3, x, 24)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i g_rotated_avx2(lsx_twofish_context* ctx, __m256i x) {
+  return _mm256_xor_si256(_mm256_xor_si256(lookup_avx2(ctx, 0, x, 24),
+                                           lookup_avx2(ctx, 1, x, 0)),
+                          _mm256_xor_si256(lookup_avx2(ctx, 2, x, 8),
+                                           lookup_avx2(ctx, 3, x, 16)));
+}
+
+#define rotl1_avx2(x) \
+  _mm256_or_si256(_mm256_slli_epi32(x, 1), _mm256_srli_epi32(x, 31))
+#define rotr1_avx2(x) \
+  _mm256_or_si256(_mm256_srli_epi32(x, 1), _mm256_slli_epi32(x, 31))
+#define key_avx2(ctx, i) _mm256_set1_epi32((int)(ctx)->K[i])
+#define white_avx2(ctx, i) _mm256_set1_epi32((int)(ctx)->W[i])
+
+__attribute__((target("avx2")))
+size_t lsx_twofish_encrypt_avx2(lsx_twofish_context* ctx, const uint8_t* in,
+                                uint8_t* out, size_t blocks) {
+  size_t n;
+  for(n = 0; n + 8 <= blocks; n += 8) {
+    __m256i R0 = _mm256_loadu_si256((const __m256i*)(in + n*16));
+    __m256i R1 = _mm256_loadu_si256((const __m256i*)(in + n*16 + 32));
+    __m256i R2 = _mm256_loadu_si256((const __m256i*)(in + n*16 + 64));
+    __m256i R3 = _mm256_loadu_si256((const __m256i*)(in + n*16 + 96));
+    __m256i T0, T1;
+    unsigned round;
+    transpose_avx2(&R0, &R1, &R2, &R3);
+    R0 = _mm256_xor_si256(R0, white_avx2(ctx, 0));
+    R1 = _mm256_xor_si256(R1, white_avx2(ctx, 1));
+    R2 = _mm256_xor_si256(R2, white_avx2(ctx, 2));
+    R3 = _mm256_xor_si256(R3, white_avx2(ctx, 3));
+    for(round = 0; round < 16; round += 2) {
+      T0 = g_avx2(ctx, R0);
+      T1 = g_rotated_avx2(ctx, R1);
+      T0 = _mm256_add_epi32(T0, T1);
+      R2 = _mm256_xor_si256(R2, _mm256_add_epi32(T0, key_avx2(ctx, round*2)));
+      R2 = rotr1_avx2(R2);
+      T1 = _mm256_add_epi32(_mm256_add_epi32(T0, T1),
+                            key_avx2(ctx, round*2+1));
+      R3 = _mm256_xor_si256(rotl1_avx2(R3), T1);
+      T0 = g_avx2(ctx, R2);
+      T1 = g_rotated_avx2(ctx, R3);
+      T0 = _mm256_add_epi32(T0, T1);
+      R0 = _mm256_xor_si256(R0, _mm256_add_epi32(T0, key_avx2(ctx, round*2+2)));
+      R0 = rotr1_avx2(R0);
+      T1 = _mm256_add_epi32(_mm256_add_epi32(T0, T1),
+                            key_avx2(ctx, round*2+3));
+      R1 = _mm256_xor_si256(rotl1_avx2(R1), T1);
+    }
+    T0 = _mm256_xor_si256(R2, white_avx2(ctx, 4));
+    T1 = _mm256_xor_si256(R3, white_avx2(ctx, 5));
+    R0 = _mm256_xor_si256(R0, white_avx2(ctx, 6));
+    R1 = _mm256_xor_si256(R1, white_avx2(ctx, 7));
+    transpose_avx2(&T0, &T1, &R0, &R1);
+    _mm256_storeu_si256((__m256i*)(out + n*16), T0);
+    _mm256_storeu_si256((__m256i*)(out + n*16 + 32), T1);
+    _mm256_storeu_si256((__m256i*)(out + n*16 + 64), R0);
+    _mm256_storeu_si256((__m256i*)(out + n*16 + 96), R1);
+  }
+  return n;
+}
+
+__attribute__((target("avx2")))
+size_t lsx_twofish_decrypt_avx2(lsx_twofish_context* ctx, const uint8_t* in,
+                                uint8_t* out, size_t blocks) {
+  size_t n;
+  for(n = 0; n + 8 <= blocks; n += 8) {
+    __m256i R2 = _mm256_loadu_si256((const __m256i*)(in + n*16));
+    __m256i R3 = _mm256_loadu_si256((const __m256i*)(in + n*16 + 32));
+    __m256i R0 = _mm256_loadu_si256((const __m256i*)(in + n*16 + 64));
+    __m256i R1 = _mm256_loadu_si256((const __m256i*)(in + n*16 + 96));
+    __m256i T0, T1;
+    int round;
+    transpose_avx2(&R2, &R3, &R0, &R1);
+    R2 = _mm256_xor_si256(R2, white_avx2(ctx, 4));
+    R3 = _mm256_xor_si256(R3, white_avx2(ctx, 5));
+    R0 = _mm256_xor_si256(R0, white_avx2(ctx, 6));
+    R1 = _mm256_xor_si256(R1, white_avx2(ctx, 7));
+    for(round = 14; round >= 0; round -= 2) {
+      T0 = g_avx2(ctx, R2);
+      T1 = g_rotated_avx2(ctx, R3);
+      T0 = _mm256_add_epi32(T0, T1);
+      R0 = _mm256_xor_si256(rotl1_avx2(R0),
+                            _mm256_add_epi32(T0, key_avx2(ctx, round*2+2)));
+      T1 = _mm256_add_epi32(_mm256_add_epi32(T0, T1),
+                            key_avx2(ctx, round*2+3));
+      R1 = rotr1_avx2(_mm256_xor_si256(R1, T1));
+      T0 = g_avx2(ctx, R0);
+      T1 = g_rotated_avx2(ctx, R1);
+      T0 = _mm256_add_epi32(T0, T1);
+      R2 = _mm256_xor_si256(rotl1_avx2(R2),
+                            _mm256_add_epi32(T0, key_avx2(ctx, round*2)));
+      T1 = _mm256_add_epi32(_mm256_add_epi32(T0, T1),
+                            key_avx2(ctx, round*2+1));
+      R3 = rotr1_avx2(_mm256_xor_si256(R3, T1));
+    }
+    R0 = _mm256_xor_si256(R0, white_avx2(ctx, 0));
+    R1 = _mm256_xor_si256(R1, white_avx2(ctx, 1));
+    R2 = _mm256_xor_si256(R2, white_avx2(ctx, 2));
+    R3 = _mm256_xor_si256(R3, white_avx2(ctx, 3));
+    transpose_avx2(&R0, &R1, &R2, &R3);
+    _mm256_storeu_si256((__m256i*)(out + n*16), R0);
+    _mm256_storeu_si256((__m256i*)(out + n*16 + 32), R1);
+    _mm256_storeu_si256((__m256i*)(out + n*16 + 64), R2);
+    _mm256_storeu_si256((__m256i*)(out + n*16 + 96), R3);
+  }
+  return n;
+}
+
+/*** AVX-512 ***/
+
+/* The same as the above, sixteen blocks at a time, with real rotates */
+__attribute__((target("avx512f")))
+static inline void transpose_avx512(__m512i* a, __m512i* b, __m512i* c,
+                                    __m512i* d) {
+  __m512i t0 = _mm512_unpacklo_epi32(*a, *b);
+  __m512i t1 = _mm512_unpackhi_epi32(*a, *b);
+  __m512i t2 = _mm512_unpacklo_epi32(*c, *d);
+  __m512i t3 = _mm512_unpackhi_epi32(*c, *d);
+  *a = _mm512_unpacklo_epi64(t0, t2);
+  *b = _mm512_unpackhi_epi64(t0, t2);
+  *c = _mm512_unpacklo_epi64(t1, t3);
+  *d = _mm512_unpackhi_epi64(t1, t3);
+}
+
+#define lookup_avx512(ctx, table, x, shift) \
+  _mm512_i32gather_epi32(_mm512_and_si512(_mm512_srli_epi32(x, shift), \
+                                          _mm512_set1_epi32(0xFF)), \
+                         (const int*)(ctx)->s[table], 4)
+
+__attribute__((target("avx512f")))
+static inline __m512i g_avx512(lsx_twofish_context* ctx, __m512i x) {
+  return _mm512_xor_si512(_mm512_xor_si512(lookup_avx512(ctx, 0, x, 0),
+                                           lookup_avx512(ctx, 1, x, 8)),
+                          _mm512_xor_si512(lookup_avx512(ctx, 2, x, 16),
+                                           lookup_avx512(ctx, 3, x, 24)));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i g_rotated_avx512(lsx_twofish_context* ctx, __m512i x) {
+  return _mm512_xor_si512(_mm512_xor_si512(lookup_avx512(ctx, 0, x, 24),
+                                           lookup_avx512(ctx, 1, x, 0)),
+                          _mm512_xor_si512(lookup_avx512(ctx, 2, x, 8),
+                                           lookup_avx512(ctx, 3, x, 16)));
+}
+
+#define key_avx512(ctx, i) _mm512_set1_epi32((int)(ctx)->K[i])
+#define white_avx512(ctx, i) _mm512_set1_epi32((int)(ctx)->W[i])
+
+/* these finish up with the AVX2 kernels */
+__attribute__((target("avx512f")))
+size_t lsx_twofish_encrypt_avx512(lsx_twofish_context* ctx, const uint8_t* in,
+                                  uint8_t* out, size_t blocks) {
+  size_t n;
+  for(n = 0; n + 16 <= blocks; n += 16) {
+    __m512i R0 = _mm512_loadu_si512(in + n*16);
+    __m512i R1 = _mm512_loadu_si512(in + n*16 + 64);
+    __m512i R2 = _mm512_loadu_si512(in + n*16 + 128);
+    __m512i R3 = _mm512_loadu_si512(in + n*16 + 192);
+    __m512i T0, T1;
+    unsigned round;
+    transpose_avx512(&R0, &R1, &R2, &R3);
+    R0 = _mm512_xor_si512(R0, white_avx512(ctx, 0));
+    R1 = _mm512_xor_si512(R1, white_avx512(ctx, 1));
+    R2 = _mm512_xor_si512(R2, white_avx512(ctx, 2));
+    R3 = _mm512_xor_si512(R3, white_avx512(ctx, 3));
+    for(round = 0; round < 16; round += 2) {
+      T0 = g_avx512(ctx, R0);
+      T1 = g_rotated_avx512(ctx, R1);
+      T0 = _mm512_add_epi32(T0, T1);
+      R2 = _mm512_xor_si512(R2, _mm512_add_epi32(T0,
+                                                 key_avx512(ctx, round*2)));
+      R2 = _mm512_ror_epi32(R2, 1);
+      T1 = _mm512_add_epi32(_mm512_add_epi32(T0, T1),
+                            key_avx512(ctx, round*2+1));
+      R3 = _mm512_xor_si512(_mm512_rol_epi32(R3, 1), T1);
+      T0 = g_avx512(ctx, R2);
+      T1 = g_rotated_avx512(ctx, R3);
+      T0 = _mm512_add_epi32(T0, T1);
+      R0 = _mm512_xor_si512(R0, _mm512_add_epi32(T0,
+                                                 key_avx512(ctx, round*2+2)));
+      R0 = _mm512_ror_epi32(R0, 1);
+      T1 = _mm512_add_epi32(_mm512_add_epi32(T0, T1),
+                            key_avx512(ctx, round*2+3));
+      R1 = _mm512_xor_si512(_mm512_rol_epi32(R1, 1), T1);
+    }
+    T0 = _mm512_xor_si512(R2, white_avx512(ctx, 4));
+    T1 = _mm512_xor_si512(R3, white_avx512(ctx, 5));
+    R0 = _mm512_xor_si512(R0, white_avx512(ctx, 6));
+    R1 = _mm512_xor_si512(R1, white_avx512(ctx, 7));
+    transpose_avx512(&T0, &T1, &R0, &R1);
+    _mm512_storeu_si512(out + n*16, T0);
+    _mm512_storeu_si512(out + n*16 + 64, T1);
+    _mm512_storeu_si512(out + n*16 + 128, R0);
+    _mm512_storeu_si512(out + n*16 + 192, R1);
+  }
+  return n + lsx_twofish_encrypt_avx2(ctx, in + n*16, out + n*16, blocks - n);
+}
+
+__attribute__((target("avx512f")))
+size_t lsx_twofish_decrypt_avx512(lsx_twofish_context* ctx, const uint8_t* in,
+                                  uint8_t* out, size_t blocks) {
+  size_t n;
+  for(n = 0; n + 16 <= blocks; n += 16) {
+    __m512i R2 = _mm512_loadu_si512(in + n*16);
+    __m512i R3 = _mm512_loadu_si512(in + n*16 + 64);
+    __m512i R0 = _mm512_loadu_si512(in + n*16 + 128);
+    __m512i R1 = _mm512_loadu_si512(in + n*16 + 192);
+    __m512i T0, T1;
+    int round;
+    transpose_avx512(&R2, &R3, &R0, &R1);
+    R2 = _mm512_xor_si512(R2, white_avx512(ctx, 4));
+    R3 = _mm512_xor_si512(R3, white_avx512(ctx, 5));
+    R0 = _mm512_xor_si512(R0, white_avx512(ctx, 6));
+    R1 = _mm512_xor_si512(R1, white_avx512(ctx, 7));
+    for(round = 14; round >= 0; round -= 2) {
+      T0 = g_avx512(ctx, R2);
+      T1 = g_rotated_avx512(ctx, R3);
+      T0 = _mm512_add_epi32(T0, T1);
+      R0 = _mm512_xor_si512(_mm512_rol_epi32(R0, 1),
+                            _mm512_add_epi32(T0, key_avx512(ctx, round*2+2)));
+      T1 = _mm512_add_epi32(_mm512_add_epi32(T0, T1),
+                            key_avx512(ctx, round*2+3));
+      R1 = _mm512_ror_epi32(_mm512_xor_si512(R1, T1), 1);
+      T0 = g_avx512(ctx, R0);
+      T1 = g_rotated_avx512(ctx, R1);
+      T0 = _mm512_add_epi32(T0, T1);
+      R2 = _mm512_xor_si512(_mm512_rol_epi32(R2, 1),
+                            _mm512_add_epi32(T0, key_avx512(ctx, round*2)));
+      T1 = _mm512_add_epi32(_mm512_add_epi32(T0, T1),
+                            key_avx512(ctx, round*2+1));
+      R3 = _mm512_ror_epi32(_mm512_xor_si512(R3, T1), 1);
+    }
+    R0 = _mm512_xor_si512(R0, white_avx512(ctx, 0));
+    R1 = _mm512_xor_si512(R1, white_avx512(ctx, 1));
+    R2 = _mm512_xor_si512(R2, white_avx512(ctx, 2));
+    R3 = _mm512_xor_si512(R3, white_avx512(ctx, 3));
+    transpose_avx512(&R0, &R1, &R2, &R3);
+    _mm512_storeu_si512(out + n*16, R0);
+    _mm512_storeu_si512(out + n*16 + 64, R1);
+    _mm512_storeu_si512(out + n*16 + 128, R2);
+    _mm512_storeu_si512(out + n*16 + 192, R3);
+  }
+  return n + lsx_twofish_decrypt_avx2(ctx, in + n*16, out + n*16, blocks - n);
+}
+
+#endif
@@ -2,6 +2,7 @@
 
 #include <lua.h>
 #include <lauxlib.h>
+#include <errno.h>
 #include <string.h>
 
 #if LUA_VERSION_NUM < 502
@@ -16,68 +17,113 @@
 #define bytes_to_int64(p) (((uint64_t)(p)[0] << 56) | ((uint64_t)(p)[1] << 48) | ((uint64_t)(p)[2] << 40) | ((uint64_t)(p)[3] << 32) | ((uint64_t)(p)[4] << 24) | ((uint64_t)(p)[5] << 16) | ((uint64_t)(p)[6] << 8) | (uint64_t)(p)[7])
 #define int64_to_bytes(word, p) ((p)[0] = (uint8_t)(word), (p)[1] = (uint8_t)((word)>>8), (p)[2] = (uint8_t)((word)>>16), (p)[3] = (uint8_t)((word)>>24), (p)[4] = (uint8_t)((word)>>32), (p)[5] = (uint8_t)((word)>>40), (p)[6] = (uint8_t)((word)>>48), (p)[7] = (uint8_t)((word)>>56))
 
-static const char digits[16] = {'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f'};
-
-static int f_sha256_sum(lua_State* L) {
-  unsigned n, i;
+/* hash every argument, a batch at a time so that the multi-buffer kernels can
+   work on several at once */
+#define SUM_BATCH 8
+static int sha256_sum_args(lua_State* L, int binary) {
+  unsigned n, m;
   unsigned argcount = lua_gettop(L);
-  for(n = 1; n <= argcount; ++n) {
-    size_t length;
-    const char* message = luaL_checklstring(L, n, &length);
-    uint8_t hash[SHA256_HASHBYTES];
-    lsx_calculate_sha256(message, length, hash);
-    char buf[SHA256_HASHBYTES*2];
-    for(i = 0; i < SHA256_HASHBYTES; ++i) {
-      buf[i*2] = digits[hash[i]>>4];
-      buf[i*2+1] = digits[hash[i]&15];
+  for(n = 1; n <= argcount; n += SUM_BATCH) {
+    const void* messages[SUM_BATCH];
+    size_t lengths[SUM_BATCH];
+    uint8_t hashes[SUM_BATCH][SHA256_HASHBYTES];
+    unsigned count = argcount - n + 1;
+    if(count > SUM_BATCH) count = SUM_BATCH;
+    for(m = 0; m < count; ++m)
+      messages[m] = luaL_checklstring(L, n + m, &lengths[m]);
+    lsx_calculate_sha256_many(messages, lengths, count, hashes);
+    if(binary) {
+      for(m = 0; m < count; ++m)
+        lua_pushlstring(L, (const char*)hashes[m], SHA256_HASHBYTES);
+    }
+    else {
+      char buf[SUM_BATCH][LSX_HEX_CHARS(SHA256_HASHBYTES)];
+      lsx_hex_encode_many(hashes, SHA256_HASHBYTES, count, buf[0]);
+      for(m = 0; m < count; ++m)
+        lua_pushlstring(L, buf[m], sizeof(buf[m]));
     }
-    lua_pushlstring(L, buf, sizeof(buf));
   }
   return argcount;
 }
 
+static int f_sha256_sum(lua_State* L) {
+  return sha256_sum_args(L, 0);
+}
+
 static int f_sha256_sum_binary(lua_State* L) {
-  unsigned n, i;
-  unsigned argcount = lua_gettop(L);
-  for(n = 1; n <= argcount; ++n) {
-    size_t length;
-    const char* message = luaL_checklstring(L, n, &length);
-    uint8_t hash[SHA256_HASHBYTES];
-    lsx_calculate_sha256(message, length, hash);
-    lua_pushlstring(L, hash, sizeof(hash));
+  return sha256_sum_args(L, 1);
+}
+
+/* fails the way io.open does: nil, message, errno */
+static int sha256_file(lua_State* L, int binary) {
+  const char* path = luaL_checkstring(L, 1);
+  uint8_t hash[SHA256_HASHBYTES];
+  if(!lsx_sha256_file(path, hash)) {
+    int error = errno;
+    lua_pushnil(L);
+    lua_pushfstring(L, "%s: %s", path, strerror(error));
+    lua_pushinteger(L, error);
+    return 3;
   }
-  return argcount;
+  if(binary)
+    lua_pushlstring(L, (const char*)hash, SHA256_HASHBYTES);
+  else {
+    char buf[LSX_HEX_CHARS(SHA256_HASHBYTES)];
+    lsx_hex_encode(hash, SHA256_HASHBYTES, buf);
+    lua_pushlstring(L, buf, sizeof(buf));
+  }
+  return 1;
+}
+
+static int f_sha256_file(lua_State* L) {
+  return sha256_file(L, 0);
+}
+
+static int f_sha256_file_binary(lua_State* L) {
+  return sha256_file(L, 1);
 }
 
+/* the names `set_policy` takes, in the order of their LSX_POLICY_ values */
+static const char* const policy_names[] = {"secret", "public", NULL};
+
 static int f_sha256_setup(lua_State* L) {
   lsx_sha256_context* ctx = (lsx_sha256_context*)luaL_checkudata(L, 1, "lsx_sha256_context");
   lsx_setup_sha256(ctx);
   return 0;
 }
 
+static int f_sha256_set_policy(lua_State* L) {
+  lsx_sha256_context* ctx = (lsx_sha256_context*)luaL_checkudata(L, 1, "lsx_sha256_context");
+  lsx_set_sha256_policy(ctx, luaL_checkoption(L, 2, NULL, policy_names));
+  return 0;
+}
+
 static int f_sha256_input(lua_State* L) {
   lsx_sha256_context* ctx = (lsx_sha256_context*)luaL_checkudata(L, 1, "lsx_sha256_context");
   unsigned n;
+  lsx_iovec iov[16];
+  int cnt = 0;
   if(ctx->expert.bytes_so_far == IMPOSSIBLE_BYTES_OUT) return luaL_error(L, "lsx_sha256_context not currently initalized; you must call :setup() at the beginning of every message");
   for(n = 2; n <= lua_gettop(L); ++n) {
     size_t length;
-    const char* input = luaL_checklstring(L, n, &length);
-    lsx_input_sha256(ctx, input, length);
+    iov[cnt].iov_base = (void*)luaL_checklstring(L, n, &length);
+    iov[cnt].iov_len = length;
+    if(++cnt == 16) {
+      lsx_input_sha256v(ctx, iov, cnt);
+      cnt = 0;
+    }
   }
+  if(cnt > 0) lsx_input_sha256v(ctx, iov, cnt);
   return 0;
 }
 
 static int f_sha256_finish(lua_State* L) {
   lsx_sha256_context* ctx = (lsx_sha256_context*)luaL_checkudata(L, 1, "lsx_sha256_context");
   uint8_t hash[SHA256_HASHBYTES];
-  unsigned i;
   if(ctx->expert.bytes_so_far == IMPOSSIBLE_BYTES_OUT) return luaL_error(L, "lsx_sha256_context not currently initalized; you must call :setup() at the beginning of every message");
   lsx_finish_sha256(ctx, hash);
-  char buf[SHA256_HASHBYTES*2];
-  for(i = 0; i < SHA256_HASHBYTES; ++i) {
-    buf[i*2] = digits[hash[i]>>4];
-    buf[i*2+1] = digits[hash[i]&15];
-  }
+  char buf[LSX_HEX_CHARS(SHA256_HASHBYTES)];
+  lsx_hex_encode(hash, SHA256_HASHBYTES, buf);
   lua_pushlstring(L, buf, sizeof(buf));
   ctx->expert.bytes_so_far = IMPOSSIBLE_BYTES_OUT;
   return 1;
@@ -100,13 +146,44 @@ static int f_sha256_destroy(lua_State* L) {
   return 0;
 }
 
+static int f_sha256_clone(lua_State* L) {
+  lsx_sha256_context* ctx = (lsx_sha256_context*)luaL_checkudata(L, 1, "lsx_sha256_context");
+  lsx_sha256_context* clone = (lsx_sha256_context*)lua_newuserdata(L, sizeof(lsx_sha256_context));
+  lsx_clone_sha256(clone, ctx);
+  luaL_getmetatable(L, "lsx_sha256_context");
+  lua_setmetatable(L, -2);
+  return 1;
+}
+
+static int f_sha256_export(lua_State* L) {
+  lsx_sha256_context* ctx = (lsx_sha256_context*)luaL_checkudata(L, 1, "lsx_sha256_context");
+  uint8_t blob[LSX_SHA256_STATE_BYTES];
+  if(ctx->expert.bytes_so_far == IMPOSSIBLE_BYTES_OUT) return luaL_error(L, "lsx_sha256_context not currently initalized; you must call :setup() at the beginning of every message");
+  lsx_export_sha256(ctx, blob);
+  lua_pushlstring(L, (const char*)blob, sizeof(blob));
+  lsx_explicit_bzero(blob, sizeof(blob));
+  return 1;
+}
+
+static int f_sha256_import(lua_State* L) {
+  lsx_sha256_context* ctx = (lsx_sha256_context*)luaL_checkudata(L, 1, "lsx_sha256_context");
+  size_t length;
+  const char* blob = luaL_checklstring(L, 2, &length);
+  if(!lsx_import_sha256(ctx, (const uint8_t*)blob, length)) return luaL_error(L, "not a valid exported SHA-256 state");
+  return 0;
+}
+
 static const struct luaL_Reg sha256_methods[] = {
   {"setup",f_sha256_setup},
+  {"set_policy",f_sha256_set_policy},
   {"input",f_sha256_input},
   {"finish",f_sha256_finish},
   {"finish_binary",f_sha256_finish_binary},
   {"destroy",f_sha256_destroy}, // this is a bit pointless, isn't it?
   {"sanitize",f_sha256_destroy},
+  {"clone",f_sha256_clone},
+  {"export",f_sha256_export},
+  {"import",f_sha256_import},
   {NULL, NULL},
 };
 
@@ -132,6 +209,426 @@ static int f_sha256(lua_State* L) {
   return 1;
 }
 
+static void push_hash(lua_State* L, const uint8_t* hash, unsigned hash_bytes,
+                      int binary) {
+  if(binary)
+    lua_pushlstring(L, (const char*)hash, hash_bytes);
+  else {
+    char buf[LSX_HEX_CHARS(SHA512_HASHBYTES)];
+    lsx_hex_encode(hash, hash_bytes, buf);
+    lua_pushlstring(L, buf, LSX_HEX_CHARS(hash_bytes));
+  }
+}
+
+/* one userdata type for all three variants; `setup` remembers which one */
+typedef struct lua_sha512_context {
+  lsx_sha512_context ctx;
+  void(*setup_func)(lsx_sha512_context* ctx);
+  unsigned hash_bytes;
+} lua_sha512_context;
+
+static int sha512_sum_args(lua_State* L,
+                           void(*calculate_func)(const void*, size_t,
+                                                 uint8_t*),
+                           unsigned hash_bytes, int binary) {
+  unsigned n;
+  unsigned argcount = lua_gettop(L);
+  for(n = 1; n <= argcount; ++n) {
+    size_t length;
+    const char* message = luaL_checklstring(L, n, &length);
+    uint8_t hash[SHA512_HASHBYTES];
+    calculate_func(message, length, hash);
+    push_hash(L, hash, hash_bytes, binary);
+  }
+  return argcount;
+}
+
+static int f_sha512_sum(lua_State* L) {
+  return sha512_sum_args(L, lsx_calculate_sha512, SHA512_HASHBYTES, 0);
+}
+
+static int f_sha512_sum_binary(lua_State* L) {
+  return sha512_sum_args(L, lsx_calculate_sha512, SHA512_HASHBYTES, 1);
+}
+
+static int f_sha384_sum(lua_State* L) {
+  return sha512_sum_args(L, lsx_calculate_sha384, SHA384_HASHBYTES, 0);
+}
+
+static int f_sha384_sum_binary(lua_State* L) {
+  return sha512_sum_args(L, lsx_calculate_sha384, SHA384_HASHBYTES, 1);
+}
+
+static int f_sha512_256_sum(lua_State* L) {
+  return sha512_sum_args(L, lsx_calculate_sha512_256, SHA512_256_HASHBYTES, 0);
+}
+
+static int f_sha512_256_sum_binary(lua_State* L) {
+  return sha512_sum_args(L, lsx_calculate_sha512_256, SHA512_256_HASHBYTES, 1);
+}
+
+static int f_sha512_setup(lua_State* L) {
+  lua_sha512_context* ctx = (lua_sha512_context*)luaL_checkudata(L, 1, "lsx_sha512_context");
+  ctx->setup_func(&ctx->ctx);
+  return 0;
+}
+
+static int f_sha512_set_policy(lua_State* L) {
+  lua_sha512_context* ctx = (lua_sha512_context*)luaL_checkudata(L, 1, "lsx_sha512_context");
+  lsx_set_sha512_policy(&ctx->ctx, luaL_checkoption(L, 2, NULL, policy_names));
+  return 0;
+}
+
+static int f_sha512_input(lua_State* L) {
+  lua_sha512_context* ctx = (lua_sha512_context*)luaL_checkudata(L, 1, "lsx_sha512_context");
+  unsigned n;
+  if(ctx->ctx.expert.bytes_so_far == IMPOSSIBLE_BYTES_OUT) return luaL_error(L, "lsx_sha512_context not currently initalized; you must call :setup() at the beginning of every message");
+  for(n = 2; n <= lua_gettop(L); ++n) {
+    size_t length;
+    const char* input = luaL_checklstring(L, n, &length);
+    lsx_input_sha512(&ctx->ctx, input, length);
+  }
+  return 0;
+}
+
+static int sha512_finish(lua_State* L, int binary) {
+  lua_sha512_context* ctx = (lua_sha512_context*)luaL_checkudata(L, 1, "lsx_sha512_context");
+  uint8_t hash[SHA512_HASHBYTES];
+  if(ctx->ctx.expert.bytes_so_far == IMPOSSIBLE_BYTES_OUT) return luaL_error(L, "lsx_sha512_context not currently initalized; you must call :setup() at the beginning of every message");
+  lsx_finish_sha512(&ctx->ctx, hash);
+  push_hash(L, hash, ctx->hash_bytes, binary);
+  ctx->ctx.expert.bytes_so_far = IMPOSSIBLE_BYTES_OUT;
+  return 1;
+}
+
+static int f_sha512_finish(lua_State* L) {
+  return sha512_finish(L, 0);
+}
+
+static int f_sha512_finish_binary(lua_State* L) {
+  return sha512_finish(L, 1);
+}
+
+static int f_sha512_destroy(lua_State* L) {
+  lua_sha512_context* ctx = (lua_sha512_context*)luaL_checkudata(L, 1, "lsx_sha512_context");
+  lsx_sanitize_sha512(&ctx->ctx);
+  ctx->ctx.expert.bytes_so_far = IMPOSSIBLE_BYTES_OUT;
+  return 0;
+}
+
+static const struct luaL_Reg sha512_methods[] = {
+  {"setup",f_sha512_setup},
+  {"set_policy",f_sha512_set_policy},
+  {"input",f_sha512_input},
+  {"finish",f_sha512_finish},
+  {"finish_binary",f_sha512_finish_binary},
+  {"destroy",f_sha512_destroy},
+  {"sanitize",f_sha512_destroy},
+  {NULL, NULL},
+};
+
+static int new_sha512(lua_State* L,
+                      void(*setup_func)(lsx_sha512_context* ctx),
+                      unsigned hash_bytes) {
+  int initialize = lua_gettop(L) >= 1 ? lua_toboolean(L, 1) : 1;
+  lua_sha512_context* ctx = (lua_sha512_context*)lua_newuserdata(L, sizeof(lua_sha512_context));
+  ctx->setup_func = setup_func;
+  ctx->hash_bytes = hash_bytes;
+  if(initialize) setup_func(&ctx->ctx);
+  else ctx->ctx.expert.bytes_so_far = IMPOSSIBLE_BYTES_OUT;
+  if(luaL_newmetatable(L, "lsx_sha512_context")) {
+    lua_pushliteral(L, "__index");
+    lua_newtable(L);
+#if LUA_VERSION_NUM < 502
+    luaL_register(L, NULL, sha512_methods);
+#else
+    luaL_setfuncs(L, sha512_methods, 0);
+#endif
+    lua_settable(L, -3);
+    lua_pushliteral(L, "__gc");
+    lua_pushcfunction(L, f_sha512_destroy);
+    lua_settable(L, -3);
+  }
+  lua_setmetatable(L, -2);
+  return 1;
+}
+
+static int f_sha512(lua_State* L) {
+  return new_sha512(L, lsx_setup_sha512, SHA512_HASHBYTES);
+}
+
+static int f_sha384(lua_State* L) {
+  return new_sha512(L, lsx_setup_sha384, SHA384_HASHBYTES);
+}
+
+static int f_sha512_256(lua_State* L) {
+  return new_sha512(L, lsx_setup_sha512_256, SHA512_256_HASHBYTES);
+}
+
+static int f_hmac_sha256_setup(lua_State* L) {
+  lsx_hmac_sha256_key* key = (lsx_hmac_sha256_key*)luaL_checkudata(L, 1, "lsx_hmac_sha256_key");
+  size_t length;
+  const char* key_data = luaL_checklstring(L, 2, &length);
+  lsx_setup_hmac_sha256_key(key, key_data, length);
+  return 0;
+}
+
+static lsx_hmac_sha256_key* check_hmac_sha256_key(lua_State* L, int index) {
+  lsx_hmac_sha256_key* key = (lsx_hmac_sha256_key*)luaL_checkudata(L, index, "lsx_hmac_sha256_key");
+  if(key->inner.bytes_so_far == IMPOSSIBLE_BYTES_OUT) luaL_error(L, "lsx_hmac_sha256_key not currently initialized; you must call :setup(key) first");
+  return key;
+}
+
+static int hmac_sha256_sum_args(lua_State* L, int binary) {
+  lsx_hmac_sha256_key* key = check_hmac_sha256_key(L, 1);
+  unsigned n;
+  unsigned argcount = lua_gettop(L);
+  for(n = 2; n <= argcount; ++n) {
+    size_t length;
+    const char* message = luaL_checklstring(L, n, &length);
+    uint8_t mac[SHA256_HASHBYTES];
+    lsx_calculate_hmac_sha256(key, message, length, mac);
+    push_hash(L, mac, SHA256_HASHBYTES, binary);
+  }
+  return argcount - 1;
+}
+
+static int f_hmac_sha256_sum(lua_State* L) {
+  return hmac_sha256_sum_args(L, 0);
+}
+
+static int f_hmac_sha256_sum_binary(lua_State* L) {
+  return hmac_sha256_sum_args(L, 1);
+}
+
+static int f_hmac_sha256_verify(lua_State* L) {
+  lsx_hmac_sha256_key* key = check_hmac_sha256_key(L, 1);
+  size_t length, mac_length;
+  const char* message = luaL_checklstring(L, 2, &length);
+  const char* mac = luaL_checklstring(L, 3, &mac_length);
+  if(mac_length != SHA256_HASHBYTES) return luaL_error(L, "HMAC-SHA256 MACs are %d bytes long", SHA256_HASHBYTES);
+  lua_pushboolean(L, lsx_verify_hmac_sha256(key, message, length, (const uint8_t*)mac));
+  return 1;
+}
+
+static int f_hmac_sha256_destroy(lua_State* L) {
+  lsx_hmac_sha256_key* key = (lsx_hmac_sha256_key*)luaL_checkudata(L, 1, "lsx_hmac_sha256_key");
+  lsx_sanitize_hmac_sha256_key(key);
+  key->inner.bytes_so_far = IMPOSSIBLE_BYTES_OUT;
+  return 0;
+}
+
+static int f_hmac_sha256_message_input(lua_State* L) {
+  lsx_hmac_sha256_context* ctx = (lsx_hmac_sha256_context*)luaL_checkudata(L, 1, "lsx_hmac_sha256_context");
+  unsigned n;
+  if(ctx->inner.expert.bytes_so_far == IMPOSSIBLE_BYTES_OUT) return luaL_error(L, "lsx_hmac_sha256_context not currently initalized; you must call :setup(key) at the beginning of every message");
+  for(n = 2; n <= lua_gettop(L); ++n) {
+    size_t length;
+    const char* input = luaL_checklstring(L, n, &length);
+    lsx_input_hmac_sha256(ctx, input, length);
+  }
+  return 0;
+}
+
+static int hmac_sha256_message_finish(lua_State* L, int binary) {
+  lsx_hmac_sha256_context* ctx = (lsx_hmac_sha256_context*)luaL_checkudata(L, 1, "lsx_hmac_sha256_context");
+  uint8_t mac[SHA256_HASHBYTES];
+  if(ctx->inner.expert.bytes_so_far == IMPOSSIBLE_BYTES_OUT) return luaL_error(L, "lsx_hmac_sha256_context not currently initalized; you must call :setup(key) at the beginning of every message");
+  lsx_finish_hmac_sha256(ctx, mac);
+  push_hash(L, mac, SHA256_HASHBYTES, binary);
+  lsx_sanitize_hmac_sha256(ctx);
+  ctx->inner.expert.bytes_so_far = IMPOSSIBLE_BYTES_OUT;
+  return 1;
+}
+
+static int f_hmac_sha256_message_finish(lua_State* L) {
+  return hmac_sha256_message_finish(L, 0);
+}
+
+static int f_hmac_sha256_message_finish_binary(lua_State* L) {
+  return hmac_sha256_message_finish(L, 1);
+}
+
+static int f_hmac_sha256_message_setup(lua_State* L) {
+  lsx_hmac_sha256_context* ctx = (lsx_hmac_sha256_context*)luaL_checkudata(L, 1, "lsx_hmac_sha256_context");
+  lsx_setup_hmac_sha256(ctx, check_hmac_sha256_key(L, 2));
+  return 0;
+}
+
+static int f_hmac_sha256_message_destroy(lua_State* L) {
+  lsx_hmac_sha256_context* ctx = (lsx_hmac_sha256_context*)luaL_checkudata(L, 1, "lsx_hmac_sha256_context");
+  lsx_sanitize_hmac_sha256(ctx);
+  ctx->inner.expert.bytes_so_far = IMPOSSIBLE_BYTES_OUT;
+  return 0;
+}
+
+static const struct luaL_Reg hmac_sha256_message_methods[] = {
+  {"setup",f_hmac_sha256_message_setup},
+  {"input",f_hmac_sha256_message_input},
+  {"finish",f_hmac_sha256_message_finish},
+  {"finish_binary",f_hmac_sha256_message_finish_binary},
+  {"destroy",f_hmac_sha256_message_destroy},
+  {"sanitize",f_hmac_sha256_message_destroy},
+  {NULL, NULL},
+};
+
+static int f_hmac_sha256_message(lua_State* L) {
+  lsx_hmac_sha256_key* key = check_hmac_sha256_key(L, 1);
+  lsx_hmac_sha256_context* ctx = (lsx_hmac_sha256_context*)lua_newuserdata(L, sizeof(lsx_hmac_sha256_context));
+  lsx_setup_hmac_sha256(ctx, key);
+  if(luaL_newmetatable(L, "lsx_hmac_sha256_context")) {
+    lua_pushliteral(L, "__index");
+    lua_newtable(L);
+#if LUA_VERSION_NUM < 502
+    luaL_register(L, NULL, hmac_sha256_message_methods);
+#else
+    luaL_setfuncs(L, hmac_sha256_message_methods, 0);
+#endif
+    lua_settable(L, -3);
+    lua_pushliteral(L, "__gc");
+    lua_pushcfunction(L, f_hmac_sha256_message_destroy);
+    lua_settable(L, -3);
+  }
+  lua_setmetatable(L, -2);
+  return 1;
+}
+
+static const struct luaL_Reg hmac_sha256_methods[] = {
+  {"setup",f_hmac_sha256_setup},
+  {"sum",f_hmac_sha256_sum},
+  {"sum_binary",f_hmac_sha256_sum_binary},
+  {"verify",f_hmac_sha256_verify},
+  {"message",f_hmac_sha256_message},
+  {"destroy",f_hmac_sha256_destroy},
+  {"sanitize",f_hmac_sha256_destroy},
+  {NULL, NULL},
+};
+
+static int f_hmac_sha256(lua_State* L) {
+  size_t length;
+  const char* key_data = lua_isnoneornil(L, 1) ? NULL : luaL_checklstring(L, 1, &length);
+  lsx_hmac_sha256_key* key = (lsx_hmac_sha256_key*)lua_newuserdata(L, sizeof(lsx_hmac_sha256_key));
+  if(key_data) lsx_setup_hmac_sha256_key(key, key_data, length);
+  else key->inner.bytes_so_far = IMPOSSIBLE_BYTES_OUT;
+  if(luaL_newmetatable(L, "lsx_hmac_sha256_key")) {
+    lua_pushliteral(L, "__index");
+    lua_newtable(L);
+#if LUA_VERSION_NUM < 502
+    luaL_register(L, NULL, hmac_sha256_methods);
+#else
+    luaL_setfuncs(L, hmac_sha256_methods, 0);
+#endif
+    lua_settable(L, -3);
+    lua_pushliteral(L, "__gc");
+    lua_pushcfunction(L, f_hmac_sha256_destroy);
+    lua_settable(L, -3);
+  }
+  lua_setmetatable(L, -2);
+  return 1;
+}
+
+static int f_pbkdf2_hmac_sha256(lua_State* L) {
+  size_t password_length, salt_length;
+  const char* password = luaL_checklstring(L, 1, &password_length);
+  const char* salt = luaL_checklstring(L, 2, &salt_length);
+  lua_Integer iterations = luaL_checkinteger(L, 3);
+  lua_Integer length = luaL_optinteger(L, 4, SHA256_HASHBYTES);
+  uint8_t* out;
+  if(iterations < 1 || (uint64_t)iterations > 0xFFFFFFFF) return luaL_error(L, "iteration count out of range");
+  if(length < 1 || (uint64_t)length > (uint64_t)SHA256_HASHBYTES * 0xFFFFFFFF) return luaL_error(L, "key length out of range");
+  out = (uint8_t*)lua_newuserdata(L, length);
+  lsx_pbkdf2_hmac_sha256(password, password_length, salt, salt_length,
+                         (uint32_t)iterations, out, length);
+  lua_pushlstring(L, (const char*)out, length);
+  lsx_explicit_bzero(out, length);
+  return 1;
+}
+
+static lsx_hkdf_sha256_prk* check_hkdf_sha256_prk(lua_State* L, int index) {
+  lsx_hkdf_sha256_prk* prk = (lsx_hkdf_sha256_prk*)luaL_checkudata(L, index, "lsx_hkdf_sha256_prk");
+  if(prk->inner.bytes_so_far == IMPOSSIBLE_BYTES_OUT) luaL_error(L, "lsx_hkdf_sha256_prk not currently initialized; you must call :extract(salt, ikm) first");
+  return prk;
+}
+
+static int f_hkdf_sha256_extract(lua_State* L) {
+  lsx_hkdf_sha256_prk* prk = (lsx_hkdf_sha256_prk*)luaL_checkudata(L, 1, "lsx_hkdf_sha256_prk");
+  size_t salt_length = 0, ikm_length;
+  const char* salt = lua_isnil(L, 2) ? NULL : luaL_checklstring(L, 2, &salt_length);
+  const char* ikm = luaL_checklstring(L, 3, &ikm_length);
+  lsx_hkdf_sha256_extract(prk, salt, salt_length, ikm, ikm_length);
+  return 0;
+}
+
+static int f_hkdf_sha256_expand(lua_State* L) {
+  lsx_hkdf_sha256_prk* prk = check_hkdf_sha256_prk(L, 1);
+  size_t info_length;
+  const char* info = luaL_checklstring(L, 2, &info_length);
+  lua_Integer length = luaL_checkinteger(L, 3);
+  uint8_t* out;
+  if(length < 1 || length > LSX_HKDF_SHA256_MAX_BYTES) return luaL_error(L, "HKDF-SHA256 can only expand 1 to %d bytes", LSX_HKDF_SHA256_MAX_BYTES);
+  out = (uint8_t*)lua_newuserdata(L, length);
+  lsx_hkdf_sha256_expand(prk, info, info_length, out, length);
+  lua_pushlstring(L, (const char*)out, length);
+  lsx_explicit_bzero(out, length);
+  return 1;
+}
+
+static int f_hkdf_sha256_setup_twofish(lua_State* L) {
+  lsx_hkdf_sha256_prk* prk = check_hkdf_sha256_prk(L, 1);
+  lsx_twofish_context* ctx = (lsx_twofish_context*)luaL_checkudata(L, 2, "lsx_twofish_context");
+  size_t info_length;
+  const char* info = luaL_checklstring(L, 3, &info_length);
+  lua_Integer key_bytes = luaL_optinteger(L, 4, TWOFISH256_KEYBYTES);
+  if(key_bytes < 0 || !lsx_hkdf_sha256_expand_twofish(prk, info, info_length, ctx, key_bytes))
+    return luaL_error(L, "Twofish keys must be 16, 24, or 32 bytes in length");
+  return 0;
+}
+
+static int f_hkdf_sha256_destroy(lua_State* L) {
+  lsx_hkdf_sha256_prk* prk = (lsx_hkdf_sha256_prk*)luaL_checkudata(L, 1, "lsx_hkdf_sha256_prk");
+  lsx_sanitize_hkdf_sha256_prk(prk);
+  prk->inner.bytes_so_far = IMPOSSIBLE_BYTES_OUT;
+  return 0;
+}
+
+static const struct luaL_Reg hkdf_sha256_methods[] = {
+  {"extract",f_hkdf_sha256_extract},
+  {"expand",f_hkdf_sha256_expand},
+  {"setup_twofish",f_hkdf_sha256_setup_twofish},
+  {"destroy",f_hkdf_sha256_destroy},
+  {"sanitize",f_hkdf_sha256_destroy},
+  {NULL, NULL},
+};
+
+static int f_hkdf_sha256(lua_State* L) {
+  lsx_hkdf_sha256_prk* prk;
+  int extract = lua_gettop(L) >= 2;
+  prk = (lsx_hkdf_sha256_prk*)lua_newuserdata(L, sizeof(lsx_hkdf_sha256_prk));
+  prk->inner.bytes_so_far = IMPOSSIBLE_BYTES_OUT;
+  if(luaL_newmetatable(L, "lsx_hkdf_sha256_prk")) {
+    lua_pushliteral(L, "__index");
+    lua_newtable(L);
+#if LUA_VERSION_NUM < 502
+    luaL_register(L, NULL, hkdf_sha256_methods);
+#else
+    luaL_setfuncs(L, hkdf_sha256_methods, 0);
+#endif
+    lua_settable(L, -3);
+    lua_pushliteral(L, "__gc");
+    lua_pushcfunction(L, f_hkdf_sha256_destroy);
+    lua_settable(L, -3);
+  }
+  lua_setmetatable(L, -2);
+  if(extract) {
+    lua_pushcfunction(L, f_hkdf_sha256_extract);
+    lua_pushvalue(L, -2);
+    lua_pushvalue(L, 1);
+    lua_pushvalue(L, 2);
+    lua_call(L, 3, 0);
+  }
+  return 1;
+}
+
 static int f_twofish_setup(lua_State* L) {
   lsx_twofish_context* ctx = (lsx_twofish_context*)luaL_checkudata(L, 1, "lsx_twofish_context");
   size_t length;
@@ -302,6 +799,74 @@ static int f_xor(lua_State* L) {
   return 1;
 }
 
+/* encode every argument */
+static int encode_args(lua_State* L, void(*encode_func)(const void*, size_t,
+                                                        char*),
+                       size_t(*chars_func)(size_t)) {
+  int n;
+  int argcount = lua_gettop(L);
+  for(n = 1; n <= argcount; ++n) {
+    size_t length;
+    const char* in = luaL_checklstring(L, n, &length);
+    char* out = malloc(chars_func(length) + 1);
+    if(!out)
+      return luaL_error(L, "malloc error");
+    encode_func(in, length, out);
+    lua_pushlstring(L, out, chars_func(length));
+    free(out);
+  }
+  return argcount;
+}
+
+static size_t hex_chars(size_t bytes) { return LSX_HEX_CHARS(bytes); }
+static size_t base64_chars(size_t bytes) { return LSX_BASE64_CHARS(bytes); }
+
+static int f_hex_encode(lua_State* L) {
+  return encode_args(L, lsx_hex_encode, hex_chars);
+}
+
+static int f_base64_encode(lua_State* L) {
+  return encode_args(L, lsx_base64_encode, base64_chars);
+}
+
+/* fails with nil, message; `max_bytes` is the most `decode_func` writes for
+   `length` characters */
+static int decode_arg(lua_State* L, size_t(*decode_func)(const char*, size_t,
+                                                         void*),
+                      size_t(*max_bytes)(size_t length), const char* what) {
+  size_t length, bytes;
+  const char* in = luaL_checklstring(L, 1, &length);
+  char* out = malloc(max_bytes(length) + 1);
+  if(!out)
+    return luaL_error(L, "malloc error");
+  bytes = decode_func(in, length, out);
+  if(bytes == (size_t)-1) {
+    free(out);
+    lua_pushnil(L);
+    lua_pushfstring(L, "invalid %s", what);
+    return 2;
+  }
+  lua_pushlstring(L, out, bytes);
+  free(out);
+  return 1;
+}
+
+static size_t hex_max_bytes(size_t length) {
+  return length / 2;
+}
+
+static size_t base64_max_bytes(size_t length) {
+  return length / 4 * 3;
+}
+
+static int f_hex_decode(lua_State* L) {
+  return decode_arg(L, lsx_hex_decode, hex_max_bytes, "hex");
+}
+
+static int f_base64_decode(lua_State* L) {
+  return decode_arg(L, lsx_base64_decode, base64_max_bytes, "base64");
+}
+
 static int f_get_random(lua_State* L) {
   lua_Integer count = luaL_checkinteger(L,1);
   char* ret = malloc(count);
@@ -327,9 +892,27 @@ static int f_get_extremely_random(lua_State* L) {
 static const struct luaL_Reg regs[] = {
   {"sha256_sum",f_sha256_sum},
   {"sha256_sum_binary",f_sha256_sum_binary},
+  {"sha256_file",f_sha256_file},
+  {"sha256_file_binary",f_sha256_file_binary},
   {"sha256",f_sha256},
+  {"sha512_sum",f_sha512_sum},
+  {"sha512_sum_binary",f_sha512_sum_binary},
+  {"sha512",f_sha512},
+  {"sha384_sum",f_sha384_sum},
+  {"sha384_sum_binary",f_sha384_sum_binary},
+  {"sha384",f_sha384},
+  {"sha512_256_sum",f_sha512_256_sum},
+  {"sha512_256_sum_binary",f_sha512_256_sum_binary},
+  {"sha512_256",f_sha512_256},
+  {"hmac_sha256",f_hmac_sha256},
+  {"pbkdf2_hmac_sha256",f_pbkdf2_hmac_sha256},
+  {"hkdf_sha256",f_hkdf_sha256},
   {"twofish",f_twofish},
   {"xor",f_xor},
+  {"hex_encode",f_hex_encode},
+  {"hex_decode",f_hex_decode},
+  {"base64_encode",f_base64_encode},
+  {"base64_decode",f_base64_decode},
   {"get_random",f_get_random},
   {"get_extremely_random",f_get_extremely_random},
   {NULL, NULL},